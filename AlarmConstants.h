@@ -13,11 +13,43 @@ static const uint32_t ARM_PERIOD_MILLIS = 8000;
 static const uint32_t REARM_WAIT_PERIOD_MILLIS = 2000;
 
 static const uint32_t ALARMING_DURATION_MILLIS = 3 * 60 * 1000;
+static const uint32_t ALARMING_MIN_DURATION_MILLIS = 30 * 1000;
 
 static const uint32_t MIN_RUN_PERIOD_MILLIS = 2;
+
 static const uint32_t EARLY_WARNING_PERIOD_MILLIS = 1000 + MOVEMENT_PERIOD_MILLIS + TRANSITION_GRACE_PERIOD_MILLIS;
 static const uint32_t EARLY_WARNING_SKIP_MILLIS = 30000 + EARLY_WARNING_PERIOD_MILLIS;
 
+// Sensor Constants.
+// Motion interrupts within this window are reported as one event.
+static const uint32_t MOTION_COALESCE_WINDOW_MILLIS = 200;
+
+// Peak rotation rate (sum of all axes) that confirms an accelerometer wake as rolling or turning.
+static const uint16_t GYRO_CONFIRMATION_THRESHOLD_DPS = 15;
+
 // Output Constants.
 static const uint32_t ARMED_FLASH_PERIOD_MILLIS = 2500;
+
+// Below this energy level, outputs start saving power.
+static const uint8_t LOW_ENERGY_LEVEL = 128;
+
+// Battery Constants.
+static const uint32_t BATTERY_SAMPLE_PERIOD_MILLIS = 60000;
+static const uint16_t BATTERY_FULL_MILLIVOLTS = 3300;
+static const uint16_t BATTERY_EMPTY_MILLIVOLTS = 2900;
+
+// Diagnostics Constants.
+static const uint16_t MEMORY_HEADROOM_WARNING_BYTES = 128;
+static const uint16_t PERSISTENT_LOG_EEPROM_ADDRESS = 0;
+static const uint8_t PERSISTENT_LOG_CAPACITY = 32;
+static const uint32_t DIAGNOSTIC_IDLE_TIMEOUT_MILLIS = 10000;
+
+// Notification Constants.
+static const uint32_t NOTIFY_BAUD_RATE = 9600;
+// State changes within this window are sent as one frame, the last one wins.
+static const uint32_t NOTIFY_COALESCE_MILLIS = 1500;
+static const uint32_t NOTIFY_ACK_TIMEOUT_MILLIS = 100;
+static const uint32_t NOTIFY_RETRY_PERIOD_MILLIS = 5000;
+static const uint8_t NOTIFY_MAX_ATTEMPTS = 4;
+static const uint8_t NOTIFY_QUEUE_CAPACITY = 4;
 #endif
\ No newline at end of file
@@ -8,23 +8,45 @@
 #include <TaskSchedulerDeclarations.h>
 
 #include "IMovementSensor.h"
+#include "IBatteryMonitor.h"
 #include "IAlarmOutput.h"
 #include "IEventListener.h"
+#include "IInputReader.h"
+#include "Event/DeadlineQueue.h"
+
+#include "Diagnostics/MemoryMonitor.h"
+#include "Diagnostics/PersistentLog.h"
+#include "Diagnostics/TraceLog.h"
+#include "Diagnostics/SchedulingMonitor.h"
+#include "Watchdog/WatchdogRecovery.h"
+#include "Escalation/EscalationLadder.h"
+#include "Escalation/EscalationLadders.h"
 
 #include "AlarmConstants.h"
 
+#include "Timebase/Timebase.h"
+
 
 class AlarmManager : Task, public virtual IEventListener
 {
 private:
-	IAlarmOutput* Buzzer = nullptr;
-
-	IAlarmOutput* Light = nullptr;
+	// Every alarm output, usually an AlarmOutputGroup.
+	IAlarmOutput* Outputs = nullptr;
 
 	IMovementSensor* MovementDetector = nullptr;
 
 	IInputReader* InputReader = nullptr;
 
+	IBatteryMonitor* Battery = nullptr;
+
+	PersistentLog* Log = nullptr;
+
+	WatchdogRecovery* Recovery = nullptr;
+
+	MemoryMonitor Memory;
+
+	EscalationLadder Ladder;
+
 	enum StateEnum : uint8_t
 	{
 		Disabled,
@@ -33,47 +55,83 @@ private:
 		Arming,
 		ArmingFailed,
 		Armed,
-		ArmingEarlyWarning,
-		EarlyWarning,
-		Alarming,
 		StateCount
 	};
 
 	StateEnum State = StateEnum::Disabled;
 
+	// Pending timeouts, only the current state's are set.
+	enum DeadlineEnum : uint8_t
+	{
+		ArmComplete,
+		RearmWait,
+		LadderStep,
+		DeadlineCount
+	};
+
+	DeadlineQueue<DeadlineEnum::DeadlineCount> Deadlines;
+
 	uint32_t StateStartedTimestamp = 0;
-	uint32_t LastWarningTimestamp = 0;
+
+	bool MemoryWarning = false;
+
+	// Worst case time from an event to its handling pass, per state.
+	uint16_t MaxEventLatency[StateEnum::StateCount];
+	uint32_t EventTimestamp = 0;
+	bool EventPending = false;
+
+	// Armed and the next motion event is known to climb the ladder.
+	bool ReflexArmed = false;
+
+	// Motion event count as of the last ladder step, events are shared by all sources.
+	uint16_t SeenMotionEvents = 0;
 
 public:
-	AlarmManager(Scheduler* scheduler)
+	AlarmManager(Scheduler* scheduler
+		, const EscalationRung* escalationLadder = DefaultLadder
+		, const uint8_t escalationLadderSize = ESCALATION_LADDER_SIZE(DefaultLadder))
 		: Task(0, TASK_FOREVER, scheduler, false)
 		, IEventListener()
+		, Ladder(escalationLadder, escalationLadderSize)
 	{
+		for (uint8_t i = 0; i < StateEnum::StateCount; i++)
+		{
+			MaxEventLatency[i] = 0;
+		}
+
 		pinMode(LED_BUILTIN, OUTPUT);
 		digitalWrite(LED_BUILTIN, LOW);
 	}
 
-	bool Setup(IAlarmOutput* buzzer, IAlarmOutput* light, IMovementSensor* movementSensor
-		, IInputReader* inputReader)
+	bool Setup(IAlarmOutput* outputs, IMovementSensor* movementSensor
+		, IInputReader* inputReader, IBatteryMonitor* battery
+		, PersistentLog* persistentLog, WatchdogRecovery* recovery)
 	{
 		bool Success = true;
 
-		Buzzer = buzzer;
-		Light = light;
+		Outputs = outputs;
 		MovementDetector = movementSensor;
 		InputReader = inputReader;
+		Battery = battery;
+		Log = persistentLog;
+		Recovery = recovery;
 
-		if (Buzzer == nullptr ||
-			Light == nullptr ||
+		if (Outputs == nullptr ||
 			MovementDetector == nullptr ||
-			InputReader == nullptr)
+			InputReader == nullptr ||
+			Battery == nullptr ||
+			Log == nullptr ||
+			Recovery == nullptr)
 		{
 			Success = false;
 		}
 
 		if (Success)
 		{
-			UpdateState(StateEnum::WakingUp);
+			if (!Resume())
+			{
+				UpdateState(StateEnum::WakingUp);
+			}
 
 			return true;
 		}
@@ -85,16 +143,91 @@ public:
 		}
 	}
 
+	// Scans the stack high-water mark and trips the memory warning if headroom is low.
+	// Runs on every state transition, can also be called on demand.
+	uint16_t CheckMemory()
+	{
+		const uint16_t Headroom = Memory.GetStackHeadroom();
+
+#if defined(DEBUG_LOG) && defined(DEBUG_MEMORY)
+		TraceLog::Write<TraceEnum::MemoryStatus>(Headroom, Memory.GetFreeRam());
+#endif
+
+		if (!MemoryWarning && Headroom < MEMORY_HEADROOM_WARNING_BYTES)
+		{
+			MemoryWarning = true;
+			if (Log != nullptr)
+			{
+				Log->Write(PersistentLog::CodeEnum::MemoryWarning, State, Headroom);
+			}
+
+#ifdef DEBUG_LOG
+			TraceLog::Write<TraceEnum::MemoryWarning>();
+#endif
+		}
+
+		return Headroom;
+	}
+
+	bool HasMemoryWarning()
+	{
+		return MemoryWarning;
+	}
+
+	uint8_t GetState()
+	{
+		return State;
+	}
+
+	uint8_t GetEscalationRung()
+	{
+		return Ladder.GetRung();
+	}
+
+	uint32_t GetStateElapsed()
+	{
+		return Timebase::Millis() - StateStartedTimestamp;
+	}
+
+	// Returns false if state is out of range.
+	bool GetMaxEventLatency(const uint8_t state, uint16_t& latency)
+	{
+		if (state >= StateEnum::StateCount)
+		{
+			return false;
+		}
+
+		latency = MaxEventLatency[state];
+
+		return true;
+	}
+
 	virtual void OnEvent()
 	{
-		switch (State)
+		// Battery level is applied without a pass.
+		if (State != StateEnum::Disabled)
 		{
-		case StateEnum::Disabled:
-			break;
-		default:
-			Task::enableIfNot();
-			Task::forceNextIteration();
-			break;
+			UpdateEnergyLevel();
+		}
+
+		if (IsEventRelevant())
+		{
+			// Latency counts from the first of coalesced events.
+			if (!EventPending)
+			{
+				EventTimestamp = Timebase::Millis();
+				EventPending = true;
+			}
+
+			if (ReflexArmed && InputReader->IsArmSignalOn())
+			{
+				Reflex();
+			}
+			else
+			{
+				Task::enableIfNot();
+				Task::forceNextIteration();
+			}
 		}
 	}
 
@@ -103,77 +236,58 @@ public:
 		if (State != state)
 		{
 #if defined(DEBUG_LOG) && defined(DEBUG_STATE)
-			Serial.print(millis());
-			Serial.print(F(" - Alarm State("));
-			Serial.print(millis() - StateStartedTimestamp);
-			Serial.print(F("): "));
-			Serial.println(state);
+			TraceLog::Write<TraceEnum::AlarmState>(Timebase::Millis() - StateStartedTimestamp, (uint8_t)state);
 #endif
 
-			StateStartedTimestamp = millis();
+			StateStartedTimestamp = Timebase::Millis();
 			State = state;
 
+			Deadlines.Clear();
+
+			CheckMemory();
+			SaveRecoveryState();
+			UpdateEnergyLevel();
+
 			switch (state)
 			{
 			case StateEnum::Disabled:
 				MovementDetector->Disable();
 				InputReader->Disable();
 
-				Light->PlayError();
-				Buzzer->PlayError();
+				Outputs->PlayError();
 				break;
 			case StateEnum::WakingUp:
 				MovementDetector->Disable();
 				InputReader->Enable();
 
-				Light->Stop();
-				Buzzer->Stop();
+				Outputs->Stop();
 				break;
 			case StateEnum::NotArmed:
 				InputReader->Enable();
 				MovementDetector->Disable();
 
-				Light->PlayNotArmed();
-				Buzzer->PlayNotArmed();
+				Outputs->PlayNotArmed();
 				break;
 			case StateEnum::Arming:
 				InputReader->Enable();
 				MovementDetector->Enable();
 
-				Light->PlayArming();
-				Buzzer->PlayArming();
+				Outputs->PlayArming();
+
+				Deadlines.Set(DeadlineEnum::ArmComplete, StateStartedTimestamp, ARM_PERIOD_MILLIS);
 				break;
 			case StateEnum::ArmingFailed:
 				InputReader->Enable();
 				MovementDetector->Disable();
 
-				Light->PlayArmingFailed();
-				Buzzer->PlayArmingFailed();
-				break;
-			case StateEnum::Armed:
-				InputReader->Enable();
-				MovementDetector->Enable();
-
-				Light->PlayArmed();
-				Buzzer->PlayArmed();
-				break;
-			case StateEnum::ArmingEarlyWarning:
-				InputReader->Enable();
-				MovementDetector->Enable();
+				Outputs->PlayArmingFailed();
 
-				Light->PlayEarlyWarning();
-				Buzzer->PlayEarlyWarning();
-				break;
-			case StateEnum::EarlyWarning:
-				InputReader->Enable();
-				MovementDetector->Enable();
+				Deadlines.Set(DeadlineEnum::RearmWait, StateStartedTimestamp, REARM_WAIT_PERIOD_MILLIS + 1);
 				break;
-			case StateEnum::Alarming:
-				MovementDetector->Disable();
+			case StateEnum::Armed:
+				// Ladder was entered or resumed by the caller, so the snapshot above has its rung.
 				InputReader->Enable();
-
-				Light->PlayAlarm();
-				Buzzer->PlayAlarm();
+				UpdateRung();
 				break;
 			case StateEnum::StateCount:
 				break;
@@ -195,7 +309,14 @@ public:
 
 	bool Callback()
 	{
-		uint32_t StateElapsed = millis() - StateStartedTimestamp;
+#ifdef SCHEDULING_MONITOR
+		SchedulingMonitor::Record(SchedulingMonitor::LayerEnum::High, Task::getStartDelay());
+#endif
+
+		const uint32_t Now = Timebase::Millis();
+		const StateEnum PassState = State;
+
+		UpdateEventLatency();
 
 		switch (State)
 		{
@@ -206,11 +327,7 @@ public:
 			if (InputReader->IsArmSignalOn())
 			{
 				UpdateState(StateEnum::Arming);
-				LastWarningTimestamp = millis() - INT32_MAX; // Clear last warning weariness.
-			}
-			else
-			{
-				Task::disable();
+				Ladder.Reset(Now); // Clear last warning weariness.
 			}
 			break;
 		case StateEnum::Arming:
@@ -218,7 +335,7 @@ public:
 			{
 				UpdateState(StateEnum::NotArmed);
 			}
-			else if (StateElapsed >= ARM_PERIOD_MILLIS)
+			else if (Deadlines.Expire(DeadlineEnum::ArmComplete, Now))
 			{
 				if (MovementDetector->HasRecentSignificantMotion(ARM_PERIOD_MILLIS - TRANSITION_GRACE_PERIOD_MILLIS))
 				{
@@ -226,106 +343,45 @@ public:
 				}
 				else
 				{
+					Ladder.Enter(0, Now, MovementDetector->GetMotionEventCount());
 					UpdateState(StateEnum::Armed);
 				}
 			}
-			else
-			{
-				Task::delay(ARM_PERIOD_MILLIS - StateElapsed);
-			}
 			break;
 		case StateEnum::ArmingFailed:
 			if (!InputReader->IsArmSignalOn())
 			{
 				UpdateState(StateEnum::NotArmed);
 			}
-			else if (StateElapsed > REARM_WAIT_PERIOD_MILLIS)
+			else if (Deadlines.Expire(DeadlineEnum::RearmWait, Now))
 			{
 				UpdateState(StateEnum::Arming);
 			}
-			else
-			{
-				Task::delay(REARM_WAIT_PERIOD_MILLIS - StateElapsed);
-			}
 			break;
 		case StateEnum::Armed:
 			if (!InputReader->IsArmSignalOn())
 			{
 				UpdateState(StateEnum::NotArmed);
 			}
-			else if (MovementDetector->HasRecentSignificantMotion(MOVEMENT_PERIOD_MILLIS))
-			{
-				if (millis() - LastWarningTimestamp > EARLY_WARNING_SKIP_MILLIS)
-				{
-					LastWarningTimestamp = millis();
-					UpdateState(StateEnum::ArmingEarlyWarning, TRANSITION_GRACE_PERIOD_MILLIS);
-				}
-				else
-				{
-					UpdateState(StateEnum::Alarming);
-				}
-			}
-			else
-			{
-				Task::disable();
-			}
-			break;
-		case StateEnum::ArmingEarlyWarning:
-			if (!InputReader->IsArmSignalOn())
-			{
-				UpdateState(StateEnum::NotArmed);
-			}
-			else if (StateElapsed > (TRANSITION_GRACE_PERIOD_MILLIS + MOVEMENT_PERIOD_MILLIS)
-				&& MovementDetector->HasRecentSignificantMotion(MOVEMENT_PERIOD_MILLIS))
-			{
-				UpdateState(StateEnum::Alarming);
-			}
-			else if (StateElapsed > EARLY_WARNING_PERIOD_MILLIS)
-			{
-				UpdateState(StateEnum::EarlyWarning);
-			}
-			else
-			{
-				Task::delay(EARLY_WARNING_PERIOD_MILLIS - StateElapsed);
-			}
-			break;
-		case StateEnum::EarlyWarning:
-			if (!InputReader->IsArmSignalOn())
-			{
-				UpdateState(StateEnum::NotArmed);
-			}
-			else if (MovementDetector->HasRecentSignificantMotion(MOVEMENT_PERIOD_MILLIS))
-			{
-				UpdateState(StateEnum::Alarming);
-			}
-			else
-			{
-				UpdateState(StateEnum::Armed);
-			}
-			break;
-		case StateEnum::Alarming:
-			if (!InputReader->IsArmSignalOn())
-			{
-				UpdateState(StateEnum::NotArmed);
-			}
-			else if (StateElapsed > ALARMING_DURATION_MILLIS)
-			{
-				LastWarningTimestamp = millis();
-				UpdateState(StateEnum::ArmingEarlyWarning);
-			}
 			else
 			{
-				Task::delay(ALARMING_DURATION_MILLIS - StateElapsed);
+				StepLadder(Now);
 			}
 			break;
 		case StateEnum::Disabled:
-			Task::disable();
-			break;
 		default:
-			Task::disable();
 			break;
 		}
 
+		// A transition already scheduled its own pass.
+		if (State == PassState)
+		{
+			ScheduleNextPass(Now);
+		}
+
+		SaveRecoveryState();
+		UpdateReflex(Now);
+
 		return true;
 	}
 
@@ -333,5 +389,225 @@ public:
 	{
 		return State != StateEnum::Disabled;
 	}
+
+private:
+	// After a watchdog or brown-out reset, skip WakingUp/NotArmed and go straight back to the protecting state.
+	bool Resume()
+	{
+		uint8_t SavedState = StateEnum::Disabled;
+		uint8_t SavedRung = 0;
+		uint32_t RungElapsed = 0;
+
+		if (!Recovery->Restore(SavedState, SavedRung, RungElapsed))
+		{
+			return false;
+		}
+
+		if (Recovery->WasWatchdogReset())
+		{
+			Log->Write(PersistentLog::CodeEnum::WatchdogReset, SavedState, 0);
+		}
+		else
+		{
+			Log->Write(PersistentLog::CodeEnum::BrownOutReset, SavedState, 0);
+		}
+
+		if (SavedState != StateEnum::Armed)
+		{
+			return false;
+		}
+
+#ifdef DEBUG_LOG
+		TraceLog::Write<TraceEnum::ResumingRung>(SavedRung);
+#endif
+
+		// All cool-downs are considered active, a reset while escalated is suspicious.
+		// Resumed before the state, every snapshot saved on the way keeps the rung.
+		Ladder.Resume(SavedRung, Timebase::Millis() - RungElapsed, MovementDetector->GetMotionEventCount());
+		UpdateState(StateEnum::Armed);
+
+		return true;
+	}
+
+	// Sleeps until the next deadline, or until a relevant event.
+	void ScheduleNextPass(const uint32_t now)
+	{
+		uint32_t Delay = 0;
+
+		if (State == StateEnum::Disabled || !Deadlines.GetNextDelay(now, Delay))
+		{
+			Task::disable();
+		}
+		else if (Delay == 0)
+		{
+			Task::forceNextIteration();
+		}
+		else
+		{
+			Task::delay(Delay);
+		}
+	}
+
+	/* Armed reflex: the step outcome is already known, so the ladder is stepped
+		straight from the event, in the same pass as the sensor, instead of on the next pass.
+		Outputs are primed meanwhile, so they start without setup. */
+	void Reflex()
+	{
+		const uint32_t Now = Timebase::Millis();
+
+		UpdateEventLatency();
+		StepLadder(Now);
+		ScheduleNextPass(Now);
+		SaveRecoveryState();
+		UpdateReflex(Now);
+	}
+
+	void UpdateReflex(const uint32_t now)
+	{
+		const bool Ready = State == StateEnum::Armed && Ladder.ClimbsOnNextEvent(now);
+
+		if (Ready != ReflexArmed)
+		{
+			ReflexArmed = Ready;
+			Outputs->SetPrimed(Ready);
+		}
+	}
+
+	// Events only wake the task if the current state reacts to them.
+	bool IsEventRelevant()
+	{
+		switch (State)
+		{
+		case StateEnum::NotArmed:
+			return InputReader->IsArmSignalOn();
+		case StateEnum::Arming:
+		case StateEnum::ArmingFailed:
+			// Motion while arming is checked at the deadline.
+			return !InputReader->IsArmSignalOn();
+		case StateEnum::Armed:
+			// Only new motion steps the ladder, battery events don't.
+			return !InputReader->IsArmSignalOn()
+				|| (Ladder.NeedsMotionDetection() && MovementDetector->GetMotionEventCount() != SeenMotionEvents);
+		case StateEnum::WakingUp:
+			// Pass already scheduled.
+		case StateEnum::Disabled:
+		default:
+			return false;
+		}
+	}
+
+	void UpdateEventLatency()
+	{
+		if (!EventPending)
+		{
+			return;
+		}
+
+		EventPending = false;
+
+		const uint32_t Latency = Timebase::Millis() - EventTimestamp;
+		const uint16_t Clamped = Latency > UINT16_MAX ? UINT16_MAX : Latency;
+
+		if (Clamped > MaxEventLatency[State])
+		{
+			MaxEventLatency[State] = Clamped;
+
+#if defined(DEBUG_LOG) && defined(DEBUG_STATE)
+			TraceLog::Write<TraceEnum::EventLatency>((uint8_t)State, Clamped);
+#endif
+		}
+	}
+
+	void UpdateEnergyLevel()
+	{
+		const uint8_t EnergyLevel = Battery->GetEnergyLevel();
+
+		Outputs->SetEnergyLevel(EnergyLevel);
+	}
+
+	void StepLadder(const uint32_t now)
+	{
+		uint32_t NextStepMillis = 0;
+
+		SeenMotionEvents = MovementDetector->GetMotionEventCount();
+
+		if (Ladder.Step(now, MovementDetector, GetRungDuration(), NextStepMillis))
+		{
+			UpdateRung();
+			SaveRecoveryState();
+
+			// Step the new rung shortly, for its deadlines.
+			Deadlines.Set(DeadlineEnum::LadderStep, now, MIN_RUN_PERIOD_MILLIS);
+		}
+		else if (NextStepMillis > 0)
+		{
+			Deadlines.Set(DeadlineEnum::LadderStep, now, NextStepMillis);
+		}
+		else
+		{
+			// Wait for events.
+			Deadlines.Cancel(DeadlineEnum::LadderStep);
+		}
+	}
+
+	// Applies the outputs of the current rung.
+	void UpdateRung()
+	{
+#if defined(DEBUG_LOG) && defined(DEBUG_STATE)
+		TraceLog::Write<TraceEnum::EscalationRung>(Ladder.GetRung());
+#endif
+
+		if (Ladder.NeedsMotionDetection())
+		{
+			MovementDetector->Enable();
+		}
+		else
+		{
+			MovementDetector->Disable();
+		}
+
+		switch (Ladder.GetPattern())
+		{
+		case EscalationPatternEnum::PatternArmed:
+			Outputs->PlayArmed();
+			break;
+		case EscalationPatternEnum::PatternEarlyWarning:
+			Outputs->PlayEarlyWarning();
+			break;
+		case EscalationPatternEnum::PatternAlarm:
+			Outputs->PlayAlarm();
+			break;
+		default:
+			break;
+		}
+
+		Task::enableIfNot();
+		Task::delay(MIN_RUN_PERIOD_MILLIS);
+	}
+
+	// Shorter alarms on low battery, so the pack isn't flattened before the owner is back.
+	uint32_t GetRungDuration()
+	{
+		if (Ladder.GetPattern() != EscalationPatternEnum::PatternAlarm)
+		{
+			return Ladder.GetDuration();
+		}
+
+		const uint32_t Scaled = (Ladder.GetDuration() * Battery->GetEnergyLevel()) / IBatteryMonitor::EnergyLevelFull;
+
+		if (Scaled > ALARMING_MIN_DURATION_MILLIS)
+		{
+			return Scaled;
+		}
+		else
+		{
+			return ALARMING_MIN_DURATION_MILLIS;
+		}
+	}
+
+	void SaveRecoveryState()
+	{
+		Recovery->Save(State, Ladder.GetRung(), Ladder.GetRungElapsed(Timebase::Millis()));
+	}
 };
 #endif
\ No newline at end of file
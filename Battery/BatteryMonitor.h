@@ -0,0 +1,188 @@
+// BatteryMonitor.h
+
+#ifndef _BATTERYMONITOR_h
+#define _BATTERYMONITOR_h
+
+#define _TASK_OO_CALLBACKS
+#include <TaskSchedulerDeclarations.h>
+
+#include <Arduino.h>
+
+#include "../IBatteryMonitor.h"
+#include "../Event/EventTask.h"
+#include "../AlarmConstants.h"
+#include "../Timebase/ClockGovernor.h"
+#include "../Hal/Hal.h"
+#include "../Diagnostics/TraceLog.h"
+
+// Measures VCC against the internal 1.1 V bandgap.
+// The ADC is only powered for a couple of milliseconds per sample.
+// With a regulated supply, the drop is only seen once the regulator is in dropout.
+template<typename EventBus = RuntimeEventBus>
+class BatteryMonitor : EventTask<EventBus>, public virtual IBatteryMonitor
+{
+private:
+	static const uint32_t BandgapSettleMillis = 2;
+	static const uint32_t BandgapMilliVolts = 1100;
+
+	// Exponential filter, keeps (average << FilterShift).
+	static const uint8_t FilterShift = 2;
+
+	// Only notify listener on significant changes.
+	static const uint8_t EnergyLevelHysteresis = 16;
+
+	// Bandgap against AVcc reference, MUX 1110.
+	static const uint8_t BandgapMux = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
+
+	// 125 kHz ADC clock: 8 MHz / 64, or 1 MHz / 8 when the CPU is slowed.
+	static const uint8_t AdcPrescalerLog2 = 6;
+
+	enum StateEnum : uint8_t
+	{
+		Disabled,
+		PoweringUp,
+		Sampling
+	};
+
+	StateEnum State = StateEnum::Disabled;
+
+	uint32_t FilteredMilliVolts = 0;
+	uint8_t EnergyLevel = EnergyLevelFull;
+	uint8_t LastEmittedLevel = EnergyLevelFull;
+
+public:
+	BatteryMonitor(Scheduler* scheduler)
+		: EventTask<EventBus>(scheduler)
+		, IBatteryMonitor()
+	{
+	}
+
+	virtual bool Setup(IEventListener* eventListener = nullptr)
+	{
+		if (!EventTask<EventBus>::Setup(eventListener))
+		{
+			return false;
+		}
+
+		State = StateEnum::PoweringUp;
+		Task::enable();
+
+		return true;
+	}
+
+	virtual uint16_t GetMilliVolts()
+	{
+		return FilteredMilliVolts >> FilterShift;
+	}
+
+	virtual uint8_t GetEnergyLevel()
+	{
+		return EnergyLevel;
+	}
+
+	bool Callback()
+	{
+		switch (State)
+		{
+		case StateEnum::PoweringUp:
+			HalPower::Enable(PeripheralEnum::Adc);
+			ADCSRA = _BV(ADEN);
+			ADMUX = BandgapMux;
+			State = StateEnum::Sampling;
+
+			// Let the bandgap and reference settle without blocking.
+			Task::delay(BandgapSettleMillis);
+			break;
+		case StateEnum::Sampling:
+			{
+				const uint16_t MilliVolts = Sample();
+
+				// A clock change during the conversion leaves it out of spec, the next sample counts.
+				if (MilliVolts != 0)
+				{
+					UpdateFilter(MilliVolts);
+				}
+			}
+
+			ADCSRA = 0;
+			HalPower::Disable(PeripheralEnum::Adc);
+
+			UpdateEnergyLevel();
+
+			State = StateEnum::PoweringUp;
+			Task::delay(BATTERY_SAMPLE_PERIOD_MILLIS);
+			break;
+		case StateEnum::Disabled:
+		default:
+			Task::disable();
+			break;
+		}
+
+		return true;
+	}
+
+private:
+	// Returns 0 when the reading is discarded.
+	uint16_t Sample()
+	{
+		// The clock may have changed since PoweringUp, so the prescaler is set right before the start.
+		// Single conversion takes 13 ADC clocks, ~104 us.
+		const uint8_t Shift = ClockGovernor::GetShift();
+		ADCSRA = _BV(ADEN) | (AdcPrescalerLog2 - Shift) | _BV(ADSC);
+		while (ADCSRA & _BV(ADSC))
+		{
+		}
+
+		const uint16_t Reading = ADC;
+		if (Reading == 0 || ClockGovernor::GetShift() != Shift)
+		{
+			return 0;
+		}
+
+		return (BandgapMilliVolts * 1024) / Reading;
+	}
+
+	void UpdateFilter(const uint16_t milliVolts)
+	{
+		if (FilteredMilliVolts == 0)
+		{
+			FilteredMilliVolts = (uint32_t)milliVolts << FilterShift;
+		}
+		else
+		{
+			FilteredMilliVolts = FilteredMilliVolts - (FilteredMilliVolts >> FilterShift) + milliVolts;
+		}
+	}
+
+	void UpdateEnergyLevel()
+	{
+		const uint16_t MilliVolts = GetMilliVolts();
+
+		if (MilliVolts >= BATTERY_FULL_MILLIVOLTS)
+		{
+			EnergyLevel = EnergyLevelFull;
+		}
+		else if (MilliVolts <= BATTERY_EMPTY_MILLIVOLTS)
+		{
+			EnergyLevel = 0;
+		}
+		else
+		{
+			EnergyLevel = ((uint32_t)(MilliVolts - BATTERY_EMPTY_MILLIVOLTS) * EnergyLevelFull)
+				/ (BATTERY_FULL_MILLIVOLTS - BATTERY_EMPTY_MILLIVOLTS);
+		}
+
+#if defined(DEBUG_LOG) && defined(DEBUG_BATTERY)
+		TraceLog::Write<TraceEnum::Battery>(MilliVolts, EnergyLevel);
+#endif
+
+		// Only fire event if value has changed enough.
+		if (abs((int16_t)EnergyLevel - LastEmittedLevel) >= EnergyLevelHysteresis
+			|| (EnergyLevel != LastEmittedLevel && (EnergyLevel == 0 || EnergyLevel == EnergyLevelFull)))
+		{
+			LastEmittedLevel = EnergyLevel;
+			EventBus::Publish();
+		}
+	}
+};
+#endif
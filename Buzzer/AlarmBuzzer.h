@@ -9,12 +9,19 @@
 
 #include <TimerOne.h> // https://github.com/PaulStoffregen/TimerOne
 
-#include "..\IAlarmOutput.h"
+#include "../IAlarmOutput.h"
+#include "../Timebase/Timebase.h"
+#include "../Hal/Hal.h"
+#include "../Diagnostics/TraceLog.h"
+#include "../Diagnostics/SchedulingMonitor.h"
 
+template<const uint8_t DrivePin>
 class AlarmBuzzer : Task, public virtual IAlarmOutput
 {
+	static_assert(DrivePin == 9 || DrivePin == 10, "Timer1 PWM is only on pins 9 and 10.");
+
 private:
-	const uint8_t DrivePin;
+	typedef FastPin<DrivePin> Pin;
 
 	static const uint32_t BuzzerUpdatePeriodMillis = 2;
 	static const uint32_t BuzzerCarriedPeriodMicros = 80;
@@ -26,6 +33,10 @@ private:
 	static const uint32_t AlarmPeriod = 1400;
 	static const uint32_t AlarmBeeps = 3;
 	static const uint32_t AlarmPausePeriod = 150;
+	static const uint32_t AlarmBeepPeriod = (AlarmPeriod - AlarmPausePeriod) / AlarmBeeps;
+
+	// Alarms open on the loudest point of the first beep, skipping the pause.
+	static const uint32_t AlarmStartElapsed = AlarmPausePeriod + ((AlarmPeriod - AlarmPausePeriod) % AlarmBeepPeriod) + 1;
 
 	static const uint32_t ArmChirpCount = 2;
 	static const uint32_t NotArmedChirpCount = 3;
@@ -42,6 +53,9 @@ private:
 	static const uint16_t NotArmedLevel = 50;
 	static const uint16_t ArmingLevel = 20;
 
+	// Level never scales below this fraction of 255, on low battery.
+	static const uint8_t MinEnergyScale = 96;
+
 	enum SoundEnum : uint8_t
 	{
 		None,
@@ -59,13 +73,18 @@ private:
 	uint32_t CurrentStartedMillis = 0;
 	uint32_t GenericBuzzDurationMillis = 0;
 
+	uint8_t EnergyScale = 255;
+
+	// Timer1 powered and initialized.
+	bool TimerReady = false;
+	bool Primed = false;
+
 public:
-	AlarmBuzzer(Scheduler* scheduler, const uint8_t drivePin)
+	AlarmBuzzer(Scheduler* scheduler)
 		: Task(BuzzerUpdatePeriodMillis, TASK_FOREVER, scheduler, false)
 		, IAlarmOutput()
-		, DrivePin(drivePin)
 	{
-		pinMode(DrivePin, OUTPUT);
+		Pin::SetOutput();
 	}
 
 	bool Setup()
@@ -75,7 +94,11 @@ public:
 
 	bool Callback()
 	{
-		uint32_t Elapsed = millis() - CurrentStartedMillis;
+#ifdef SCHEDULING_MONITOR
+		SchedulingMonitor::Record(SchedulingMonitor::LayerEnum::High, Task::getStartDelay());
+#endif
+
+		uint32_t Elapsed = Timebase::Millis() - CurrentStartedMillis;
 
 		switch (Current)
 		{
@@ -111,9 +134,17 @@ public:
 		return true;
 	}
 
+	bool OnEnable()
+	{
+		Timebase::RequestFine(Timebase::ClientEnum::Buzzer);
+
+		return true;
+	}
+
 	void OnDisable()
 	{
 		StopPlaying();
+		Timebase::ReleaseFine(Timebase::ClientEnum::Buzzer);
 	}
 
 	// Interface implementations.
@@ -121,7 +152,7 @@ public:
 	{
 		PreparePlay(SoundEnum::Generic);
 #ifdef DEBUG_LOG
-		Serial.println(F("Buzz: Bzzzz"));
+		TraceLog::Write<TraceEnum::BuzzerGeneric>();
 #endif
 	}
 
@@ -130,7 +161,7 @@ public:
 		PreparePlay(SoundEnum::Error);
 
 #ifdef DEBUG_LOG
-		Serial.println(F("Buzz: Error"));
+		TraceLog::Write<TraceEnum::BuzzerError>();
 #endif
 	}
 
@@ -139,7 +170,7 @@ public:
 		PreparePlay(SoundEnum::Armed);
 
 #ifdef DEBUG_LOG
-		Serial.println(F("Buzz: Armed"));
+		TraceLog::Write<TraceEnum::BuzzerArmed>();
 #endif
 	}
 
@@ -148,16 +179,16 @@ public:
 		PreparePlay(SoundEnum::NotArmed);
 
 #ifdef DEBUG_LOG
-		Serial.println(F("Buzz: Not Armed"));
+		TraceLog::Write<TraceEnum::BuzzerNotArmed>();
 #endif
 	}
 
 	virtual void PlayEarlyWarning()
 	{
-		PreparePlay(SoundEnum::Alarm);
+		StartAlarm();
 
 #ifdef DEBUG_LOG
-		Serial.println(F("Buzz: Early Warning"));
+		TraceLog::Write<TraceEnum::BuzzerEarlyWarning>();
 #endif
 	}
 
@@ -177,7 +208,7 @@ public:
 
 	virtual void PlayAlarm()
 	{
-		PreparePlay(SoundEnum::Alarm);
+		StartAlarm();
 	}
 
 	virtual void Stop()
@@ -185,7 +216,66 @@ public:
 		StopPlaying();
 	}
 
+	virtual void SetEnergyLevel(const uint8_t level)
+	{
+		if (level > MinEnergyScale)
+		{
+			EnergyScale = level;
+		}
+		else
+		{
+			EnergyScale = MinEnergyScale;
+		}
+	}
+
+	// Primed, Timer1 stays initialized but stopped between sounds.
+	virtual void SetPrimed(const bool primed)
+	{
+		Primed = primed;
+
+		if (Current != SoundEnum::None)
+		{
+			// Applied when the sound stops.
+			return;
+		}
+
+		if (Primed)
+		{
+			PrepareTimer();
+			Timer1.stop();
+		}
+		else
+		{
+			ReleaseTimer();
+		}
+	}
+
 private:
+	// Sound starts in this call, not on the next pass.
+	void StartAlarm()
+	{
+		if (PreparePlay(SoundEnum::Alarm))
+		{
+			CurrentStartedMillis -= AlarmStartElapsed;
+			UpdateAlarm(AlarmStartElapsed);
+		}
+	}
+
+	void PrepareTimer()
+	{
+		if (!TimerReady)
+		{
+			HalPower::Enable(PeripheralEnum::Timer1);
+			Timer1.initialize(BuzzerCarriedPeriodMicros);
+			TimerReady = true;
+		}
+	}
+
+	void ReleaseTimer()
+	{
+		TimerReady = false;
+		HalPower::Disable(PeripheralEnum::Timer1);
+	}
 
 	bool PreparePlay(SoundEnum newPlay)
 	{
@@ -194,14 +284,14 @@ private:
 			Current = newPlay;
 			Timer1.pwm(DrivePin, 0);
 
-			power_timer1_enable();
-			Timer1.initialize(BuzzerCarriedPeriodMicros);
+			// Restarts the timer if primed.
+			PrepareTimer();
 			Timer1.pwm(DrivePin, 0);
 
 			Task::enableIfNot();
 			Task::forceNextIteration();
 
-			CurrentStartedMillis = millis();
+			CurrentStartedMillis = Timebase::Millis();
 
 			return true;
 		}
@@ -226,7 +316,7 @@ private:
 			}
 			else
 			{				
-				Timer1.pwm(DrivePin, ((elapsed % ChirpEntropy) * level) / ChirpEntropy);
+				SetDuty(((elapsed % ChirpEntropy) * level) / ChirpEntropy);
 				Task::delay(1);
 			}
 		}
@@ -249,17 +339,31 @@ private:
 		{
 			Progress = Progress % ((AlarmPeriod - AlarmPausePeriod) / AlarmBeeps);
 
-			Timer1.pwm(DrivePin, (Progress * AlarmLevel) / (AlarmPeriod - AlarmPausePeriod));
+			SetDuty((Progress * AlarmLevel) / (AlarmPeriod - AlarmPausePeriod));
 		}
 	}
 
+	void SetDuty(const uint32_t duty)
+	{
+		Timer1.pwm(DrivePin, (duty * (EnergyScale + 1)) >> 8);
+	}
+
 	void StopPlaying()
 	{
 		Current = SoundEnum::None;
-		power_timer1_disable();
 
-		pinMode(DrivePin, OUTPUT);
-		digitalWrite(DrivePin, LOW);
+		if (Primed)
+		{
+			Timer1.disablePwm(DrivePin);
+			Timer1.stop();
+		}
+		else
+		{
+			ReleaseTimer();
+		}
+
+		Pin::SetOutput();
+		Pin::Low();
 		Task::disable();
 	}
 };
@@ -0,0 +1,420 @@
+// DiagnosticPort.h
+
+#ifndef _DIAGNOSTICPORT_h
+#define _DIAGNOSTICPORT_h
+
+#define _TASK_OO_CALLBACKS
+#include <TaskSchedulerDeclarations.h>
+
+#include <Arduino.h>
+
+#include "../AlarmManager.h"
+#include "../IMovementSensor.h"
+#include "../IBatteryMonitor.h"
+#include "MemoryMonitor.h"
+#include "PersistentLog.h"
+#include "SchedulingMonitor.h"
+#include "../Hal/Hal.h"
+
+#if defined(DIAGNOSTIC_PORT) && defined(DEBUG_LOG)
+#error DiagnosticPort and DEBUG_LOG both use USART0.
+#endif
+
+/* Binary request/response protocol on USART0, 38400 8N1.
+	The USART stays powered down until the host holds RX low (break) for at least 1 ms.
+	The port powers down again after DIAGNOSTIC_IDLE_TIMEOUT_MILLIS without requests.
+
+	Request:	[RequestSync][Command][Argument][Checksum]
+	Response:	[ResponseSync][Command][Length][Payload...][Checksum]
+	Checksum is the XOR of all preceding bytes in the frame.
+	Failed requests are answered with (Command | ErrorFlag) and no payload.
+	Multi-byte values are little-endian.
+
+	Commands:
+	- Ping:			[Version]
+	- State:		[State][StateElapsed u32][MemoryWarning][EscalationRung]
+	- Counters:		[Uptime u32][MotionEvents u16][FreeRam u16][StackHeadroom u16][BatteryMilliVolts u16][Requests u16][RotationEvents u16]
+	- SensorConfig:	[XOffset i16][YOffset i16][ZOffset i16][MotionThreshold][MotionDuration]
+	- LogEntry:		Argument is the entry index, oldest first. [Code][State][Value u16]
+	- Latency:		Argument is the alarm state. Worst case event to handling time since boot. [MaxLatencyMillis u16]
+	- Scheduling:	Argument is the scheduler layer (SchedulingMonitor::LayerEnum), needs SCHEDULING_MONITOR.
+					Start delay histogram since boot. [Bucket u16 x 8]
+*/
+class DiagnosticPort;
+extern DiagnosticPort* StaticDiagnosticPortReference;
+
+class DiagnosticPort : Task
+{
+public:
+	static const uint8_t ProtocolVersion = 4;
+
+	static const uint8_t RequestSync = 0xA5;
+	static const uint8_t ResponseSync = 0x5A;
+	static const uint8_t ErrorFlag = 0x80;
+
+	enum CommandEnum : uint8_t
+	{
+		Ping = 0x01,
+		State = 0x02,
+		Counters = 0x03,
+		SensorConfig = 0x04,
+		LogEntry = 0x05,
+		Latency = 0x06,
+		Scheduling = 0x07
+	};
+
+private:
+	static const uint32_t BaudRate = 38400;
+	typedef FastPin<0> RxPin;
+	typedef PinChangeInterrupt<0> RxPinChange;
+
+	static const uint8_t RequestSize = 4;
+	static const uint8_t MaxPayloadSize = 16;
+	static const uint8_t ResponseHeaderSize = 3;
+	static const uint8_t RxBufferSize = 8;
+
+	enum PortStateEnum : uint8_t
+	{
+		Disabled,
+		Sleeping,
+		Waking,
+		Active
+	};
+
+	AlarmManager* Manager = nullptr;
+	IMovementSensor* MovementDetector = nullptr;
+	IBatteryMonitor* Battery = nullptr;
+	PersistentLog* Log = nullptr;
+
+	MemoryMonitor Memory;
+
+	volatile PortStateEnum PortState = PortStateEnum::Disabled;
+
+	// RX ring, filled from USART RX ISR.
+	volatile uint8_t RxBuffer[RxBufferSize];
+	volatile uint8_t RxHead = 0;
+	uint8_t RxTail = 0;
+
+	// Request being assembled.
+	uint8_t Request[RequestSize];
+	uint8_t RequestIndex = 0;
+
+	// Response being sent, drained from USART UDRE ISR.
+	uint8_t TxBuffer[ResponseHeaderSize + MaxPayloadSize + 1];
+	volatile uint8_t TxIndex = 0;
+	volatile uint8_t TxSize = 0;
+
+	uint32_t LastActivity = 0;
+	uint16_t RequestCount = 0;
+
+public:
+	DiagnosticPort(Scheduler* scheduler)
+		: Task(0, TASK_FOREVER, scheduler, false)
+	{
+	}
+
+	bool Setup(AlarmManager* manager, IMovementSensor* movementSensor, IBatteryMonitor* battery, PersistentLog* persistentLog)
+	{
+		Manager = manager;
+		MovementDetector = movementSensor;
+		Battery = battery;
+		Log = persistentLog;
+
+		if (Manager == nullptr ||
+			MovementDetector == nullptr ||
+			Battery == nullptr ||
+			Log == nullptr)
+		{
+			return false;
+		}
+
+		StaticDiagnosticPortReference = this;
+		HalUsart::AttachReceive(OnUsartReceive);
+		HalUsart::AttachTransmit(OnUsartTransmit);
+		RxPin::SetInputPullup();
+		Sleep();
+
+		return true;
+	}
+
+	bool Callback()
+	{
+		switch (PortState)
+		{
+		case PortStateEnum::Waking:
+			if (RxPin::Read())
+			{
+				// Break has ended.
+				PowerUp();
+			}
+			else
+			{
+				Task::delay(1);
+			}
+			break;
+		case PortStateEnum::Active:
+			ProcessRx();
+
+			if (TxSize == 0 && (Timebase::Millis() - LastActivity > DIAGNOSTIC_IDLE_TIMEOUT_MILLIS))
+			{
+				PowerDown();
+				Sleep();
+			}
+			else
+			{
+				Task::delay(DIAGNOSTIC_IDLE_TIMEOUT_MILLIS);
+			}
+			break;
+		case PortStateEnum::Sleeping:
+		case PortStateEnum::Disabled:
+		default:
+			Task::disable();
+			break;
+		}
+
+		return true;
+	}
+
+	// Pin change on RX while sleeping.
+	void OnRxPinInterrupt()
+	{
+		if (PortState == PortStateEnum::Sleeping && !RxPin::Read())
+		{
+			RxPinChange::Detach();
+			PortState = PortStateEnum::Waking;
+			Task::enableIfNot();
+			Task::forceNextIteration();
+		}
+	}
+
+	void OnRxInterrupt()
+	{
+		const uint8_t Next = (RxHead + 1) % RxBufferSize;
+		const uint8_t Value = HalUsart::Read();
+
+		if (Next != RxTail)
+		{
+			RxBuffer[RxHead] = Value;
+			RxHead = Next;
+		}
+
+		Task::enableIfNot();
+		Task::forceNextIteration();
+	}
+
+	void OnTxReadyInterrupt()
+	{
+		if (TxIndex < TxSize)
+		{
+			HalUsart::Write(TxBuffer[TxIndex++]);
+		}
+		else
+		{
+			HalUsart::DisableTransmitInterrupt();
+			TxSize = 0;
+		}
+	}
+
+private:
+	static void OnRxPinChange();
+	static void OnUsartReceive();
+	static void OnUsartTransmit();
+
+	void Sleep()
+	{
+		PortState = PortStateEnum::Sleeping;
+		RxPinChange::Attach(OnRxPinChange);
+		Task::disable();
+	}
+
+	void PowerUp()
+	{
+		// Baud rate needs the full clock.
+		Timebase::RequestFine(Timebase::ClientEnum::Diagnostics);
+
+		HalPower::Enable(PeripheralEnum::Usart0);
+		HalUsart::Enable(BaudRate, true);
+
+		RxHead = 0;
+		RxTail = 0;
+		RequestIndex = 0;
+		TxSize = 0;
+		LastActivity = Timebase::Millis();
+		PortState = PortStateEnum::Active;
+
+		Task::enableIfNot();
+		Task::delay(DIAGNOSTIC_IDLE_TIMEOUT_MILLIS);
+	}
+
+	void PowerDown()
+	{
+		HalUsart::Disable();
+		HalPower::Disable(PeripheralEnum::Usart0);
+		RxPin::SetInputPullup();
+
+		Timebase::ReleaseFine(Timebase::ClientEnum::Diagnostics);
+	}
+
+	void ProcessRx()
+	{
+		while (RxTail != RxHead)
+		{
+			const uint8_t Value = RxBuffer[RxTail];
+			RxTail = (RxTail + 1) % RxBufferSize;
+			LastActivity = Timebase::Millis();
+
+			if (RequestIndex == 0 && Value != RequestSync)
+			{
+				// Resynchronize.
+				continue;
+			}
+
+			Request[RequestIndex++] = Value;
+
+			if (RequestIndex >= RequestSize)
+			{
+				RequestIndex = 0;
+				if ((Request[0] ^ Request[1] ^ Request[2]) == Request[3])
+				{
+					RequestCount++;
+					Respond(Request[1], Request[2]);
+				}
+			}
+		}
+	}
+
+	void Respond(const uint8_t command, const uint8_t argument)
+	{
+		// Drop request if the previous response is still being sent.
+		if (TxSize != 0)
+		{
+			return;
+		}
+
+		uint8_t* Payload = &TxBuffer[ResponseHeaderSize];
+		uint8_t Length = 0;
+		bool Success = true;
+
+		switch (command)
+		{
+		case CommandEnum::Ping:
+			Payload[Length++] = ProtocolVersion;
+			break;
+		case CommandEnum::State:
+			Payload[Length++] = Manager->GetState();
+			Length += Append(&Payload[Length], Manager->GetStateElapsed());
+			Payload[Length++] = Manager->HasMemoryWarning();
+			Payload[Length++] = Manager->GetEscalationRung();
+			break;
+		case CommandEnum::Counters:
+			Length += Append(&Payload[Length], Timebase::Millis());
+			Length += Append(&Payload[Length], MovementDetector->GetMotionEventCount());
+			Length += Append(&Payload[Length], Memory.GetFreeRam());
+			Length += Append(&Payload[Length], Memory.GetStackHeadroom());
+			Length += Append(&Payload[Length], Battery->GetMilliVolts());
+			Length += Append(&Payload[Length], RequestCount);
+			Length += Append(&Payload[Length], MovementDetector->GetRotationEventCount());
+			break;
+		case CommandEnum::SensorConfig:
+		{
+			MovementSensorConfiguration Configuration;
+			MovementDetector->GetConfiguration(Configuration);
+			memcpy(Payload, &Configuration, sizeof(MovementSensorConfiguration));
+			Length = sizeof(MovementSensorConfiguration);
+		}
+		break;
+		case CommandEnum::LogEntry:
+		{
+			PersistentLog::LogEntry Entry;
+			if (Log->Read(argument, Entry))
+			{
+				memcpy(Payload, &Entry, sizeof(PersistentLog::LogEntry));
+				Length = sizeof(PersistentLog::LogEntry);
+			}
+			else
+			{
+				Success = false;
+			}
+		}
+		break;
+		case CommandEnum::Latency:
+		{
+			uint16_t Latency = 0;
+			if (Manager->GetMaxEventLatency(argument, Latency))
+			{
+				Length += Append(&Payload[Length], Latency);
+			}
+			else
+			{
+				Success = false;
+			}
+		}
+		break;
+		case CommandEnum::Scheduling:
+		{
+			uint16_t Buckets[SchedulingMonitor::BucketCount];
+			if (SchedulingMonitor::GetBuckets(argument, Buckets))
+			{
+				memcpy(Payload, Buckets, sizeof(Buckets));
+				Length = sizeof(Buckets);
+			}
+			else
+			{
+				Success = false;
+			}
+		}
+		break;
+		default:
+			Success = false;
+			break;
+		}
+
+		TxBuffer[0] = ResponseSync;
+		TxBuffer[1] = Success ? command : (command | ErrorFlag);
+		TxBuffer[2] = Success ? Length : 0;
+
+		const uint8_t FrameSize = ResponseHeaderSize + TxBuffer[2];
+		uint8_t Checksum = 0;
+		for (uint8_t i = 0; i < FrameSize; i++)
+		{
+			Checksum ^= TxBuffer[i];
+		}
+		TxBuffer[FrameSize] = Checksum;
+
+		noInterrupts();
+		TxIndex = 0;
+		TxSize = FrameSize + 1;
+		HalUsart::EnableTransmitInterrupt();
+		interrupts();
+	}
+
+	template<typename T>
+	uint8_t Append(uint8_t* target, const T value)
+	{
+		memcpy(target, &value, sizeof(T));
+
+		return sizeof(T);
+	}
+};
+
+// Interrupt glue, include this header only from the sketch.
+#ifdef DIAGNOSTIC_PORT
+DiagnosticPort* StaticDiagnosticPortReference = nullptr;
+
+void DiagnosticPort::OnRxPinChange()
+{
+	StaticDiagnosticPortReference->OnRxPinInterrupt();
+}
+
+void DiagnosticPort::OnUsartReceive()
+{
+	StaticDiagnosticPortReference->OnRxInterrupt();
+}
+
+void DiagnosticPort::OnUsartTransmit()
+{
+	StaticDiagnosticPortReference->OnTxReadyInterrupt();
+}
+#endif
+
+#endif
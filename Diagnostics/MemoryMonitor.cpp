@@ -0,0 +1,24 @@
+#if defined(__AVR__)
+#include "MemoryMonitor.h"
+
+// Runs before the stack pointer and .data/.bss are set up, so no C code can be used.
+void PaintStack(void) __attribute__((naked, used, section(".init1")));
+
+void PaintStack(void)
+{
+	__asm volatile (
+		"    ldi r30, lo8(_end)\n"
+		"    ldi r31, hi8(_end)\n"
+		"    ldi r24, 0xC5\n" // MemoryMonitor::StackCanary.
+		"    ldi r25, hi8(__stack)\n"
+		"    rjmp 2f\n"
+		"1:\n"
+		"    st Z+, r24\n"
+		"2:\n"
+		"    cpi r30, lo8(__stack)\n"
+		"    cpc r31, r25\n"
+		"    brlo 1b\n"
+		"    breq 1b\n"
+		::);
+}
+#endif
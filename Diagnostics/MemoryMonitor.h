@@ -0,0 +1,67 @@
+// MemoryMonitor.h
+
+#ifndef _MEMORYMONITOR_h
+#define _MEMORYMONITOR_h
+
+#if !defined(__AVR__)
+// Off-target builds read simulated RAM figures.
+#include "../Hal/Linux/LinuxMemoryMonitor.h"
+#else
+#include <stdint.h>
+#include <Arduino.h>
+
+// Linker symbols for the free RAM region between heap and stack.
+extern uint8_t _end;
+extern uint8_t __stack;
+extern uint8_t __heap_start;
+extern char* __brkval;
+
+// RAM between the heap and the stack is painted with a canary at boot (see MemoryMonitor.cpp).
+// The stack high-water mark is found by scanning for the first overwritten canary.
+class MemoryMonitor
+{
+public:
+	static const uint8_t StackCanary = 0xC5;
+
+public:
+	MemoryMonitor()
+	{
+	}
+
+	// Bytes currently free between heap top and stack pointer.
+	uint16_t GetFreeRam()
+	{
+		return (uint16_t)SP - (uint16_t)GetHeapTop();
+	}
+
+	// Bytes never touched by the stack since boot.
+	uint16_t GetStackHeadroom()
+	{
+		const uint8_t* Scan = GetHeapTop();
+		uint16_t Headroom = 0;
+
+		while (Scan <= &__stack && *Scan == StackCanary)
+		{
+			Scan++;
+			Headroom++;
+		}
+
+		return Headroom;
+	}
+
+private:
+	const uint8_t* GetHeapTop()
+	{
+		if (__brkval == nullptr)
+		{
+			return &__heap_start;
+		}
+		else
+		{
+			return (const uint8_t*)__brkval;
+		}
+	}
+};
+#endif
+
+#endif
@@ -0,0 +1,96 @@
+// PersistentLog.h
+
+#ifndef _PERSISTENTLOG_h
+#define _PERSISTENTLOG_h
+
+#include <stdint.h>
+
+#include "../AlarmConstants.h"
+#include "../Hal/Hal.h"
+
+// Small ring of fixed size entries in EEPROM.
+// Only rare events should be logged, EEPROM cells endure ~100k writes.
+class PersistentLog
+{
+public:
+	enum CodeEnum : uint8_t
+	{
+		MemoryWarning = 1,
+		WatchdogReset = 2,
+		BrownOutReset = 3,
+		CodeErased = 0xFF
+	};
+
+	struct LogEntry
+	{
+		uint8_t Code;
+		uint8_t State;
+		uint16_t Value;
+	};
+
+	static const uint8_t Capacity = PERSISTENT_LOG_CAPACITY;
+
+private:
+	// Head index is stored in the first byte, entries follow.
+	static const uint16_t HeadAddress = PERSISTENT_LOG_EEPROM_ADDRESS;
+	static const uint16_t EntriesAddress = PERSISTENT_LOG_EEPROM_ADDRESS + 1;
+
+	uint8_t Head = 0;
+
+public:
+	PersistentLog()
+	{
+	}
+
+	bool Setup()
+	{
+		Head = HalEeprom::Read(HeadAddress);
+
+		if (Head >= Capacity)
+		{
+			// Fresh EEPROM.
+			Clear();
+		}
+
+		return true;
+	}
+
+	void Write(const CodeEnum code, const uint8_t state, const uint16_t value)
+	{
+		LogEntry Entry;
+		Entry.Code = code;
+		Entry.State = state;
+		Entry.Value = value;
+
+		// Only writes cells that changed.
+		HalEeprom::Put(EntriesAddress + ((uint16_t)Head * sizeof(LogEntry)), Entry);
+
+		Head = (Head + 1) % Capacity;
+		HalEeprom::Update(HeadAddress, Head);
+	}
+
+	// Index 0 is the oldest entry.
+	bool Read(const uint8_t index, LogEntry& entry)
+	{
+		if (index >= Capacity)
+		{
+			return false;
+		}
+
+		HalEeprom::Get(EntriesAddress + ((uint16_t)((Head + index) % Capacity) * sizeof(LogEntry)), entry);
+
+		return entry.Code != CodeEnum::CodeErased;
+	}
+
+	void Clear()
+	{
+		for (uint16_t i = 0; i < (Capacity * sizeof(LogEntry)); i++)
+		{
+			HalEeprom::Update(EntriesAddress + i, CodeEnum::CodeErased);
+		}
+
+		Head = 0;
+		HalEeprom::Update(HeadAddress, Head);
+	}
+};
+#endif
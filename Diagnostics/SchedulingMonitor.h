@@ -0,0 +1,74 @@
+// SchedulingMonitor.h
+
+#ifndef _SCHEDULINGMONITOR_h
+#define _SCHEDULINGMONITOR_h
+
+#include <stdint.h>
+
+/* Start delay distribution per scheduler layer, with SCHEDULING_MONITOR.
+	Tasks report TaskScheduler's start delay (_TASK_TIMECRITICAL) at the top of their callback,
+	the time between when a pass was due and when it ran.
+	Bucket 0 counts passes on time, bucket n delays of 2^(n-1) to 2^n - 1 ms, the last one everything longer.
+	Counts saturate. */
+class SchedulingMonitor
+{
+public:
+	enum LayerEnum : uint8_t
+	{
+		High,
+		Base,
+		LayerCount
+	};
+
+	static const uint8_t BucketCount = 8;
+
+private:
+	static uint16_t Buckets[LayerEnum::LayerCount][BucketCount];
+
+public:
+	static void Record(const LayerEnum layer, const int32_t startDelayMillis)
+	{
+#ifdef SCHEDULING_MONITOR
+		uint8_t Bucket = 0;
+		uint32_t Delay = startDelayMillis > 0 ? startDelayMillis : 0;
+
+		while (Delay > 0 && Bucket < (BucketCount - 1))
+		{
+			Delay >>= 1;
+			Bucket++;
+		}
+
+		if (Buckets[layer][Bucket] < UINT16_MAX)
+		{
+			Buckets[layer][Bucket]++;
+		}
+#endif
+	}
+
+	// Returns false if the layer is out of range, or the monitor is not built in.
+	static bool GetBuckets(const uint8_t layer, uint16_t* buckets)
+	{
+#ifdef SCHEDULING_MONITOR
+		if (layer >= LayerEnum::LayerCount)
+		{
+			return false;
+		}
+
+		for (uint8_t i = 0; i < BucketCount; i++)
+		{
+			buckets[i] = Buckets[layer][i];
+		}
+
+		return true;
+#else
+		return false;
+#endif
+	}
+};
+
+// Storage, SCHEDULING_MONITOR is only defined in the sketch.
+#ifdef SCHEDULING_MONITOR
+uint16_t SchedulingMonitor::Buckets[SchedulingMonitor::LayerEnum::LayerCount][SchedulingMonitor::BucketCount];
+#endif
+
+#endif
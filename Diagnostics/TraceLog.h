@@ -0,0 +1,231 @@
+// TraceLog.h
+
+#ifndef _TRACELOG_h
+#define _TRACELOG_h
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <util/atomic.h>
+
+#include "../Timebase/Timebase.h"
+#include "../Hal/Hal.h"
+
+/* Message list, the only place format strings exist.
+	Strings are never compiled into the firmware, Tools/TraceDecoder.py extracts them from this header.
+	Arguments follow the printf-like format, little-endian, in the order written.
+	Every conversion states its width: hh is 1 byte, h is 2 and l is 4. Write checks them at compile time.
+	IDs are positional, append new messages at the end. */
+#define TRACE_MESSAGES(X) \
+	X(Overflow, "Trace overflow, %hu records dropped") \
+	X(AlarmStart, "Alarm Start.") \
+	X(AlarmState, "Alarm State(%lu): %hhu") \
+	X(EscalationRung, "Escalation Rung: %hhu") \
+	X(ResumingRung, "Resuming Rung: %hhu") \
+	X(MemoryStatus, "Memory Headroom: %hu Free: %hu") \
+	X(MemoryWarning, "Memory Warning!") \
+	X(BuzzerGeneric, "Buzz: Bzzzz") \
+	X(BuzzerError, "Buzz: Error") \
+	X(BuzzerArmed, "Buzz: Armed") \
+	X(BuzzerNotArmed, "Buzz: Not Armed") \
+	X(BuzzerEarlyWarning, "Buzz: Early Warning") \
+	X(Battery, "Battery: %hu mV Level: %hhu") \
+	X(SensorRegister, " * Register 0x%02hhX: 0x%02hhX expected 0x%02hhX") \
+	X(SensorOffsets, " * Accelerometer offsets: %hd / %hd / %hd") \
+	X(EventLatency, "New worst event latency in state %hhu: %hu ms")
+
+#define TRACE_MESSAGE_ID(name, format) name,
+
+enum class TraceEnum : uint8_t
+{
+	TRACE_MESSAGES(TRACE_MESSAGE_ID)
+	TraceCount
+};
+
+#define TRACE_MESSAGE_FORMAT(name, format) format,
+
+// Compile-time only, for the width check. Never used at run time, so not in flash.
+constexpr const char* const TraceFormats[] = { TRACE_MESSAGES(TRACE_MESSAGE_FORMAT) };
+
+constexpr uint8_t TraceFormatSize(const char* format);
+
+// Bytes of one conversion, after the '%'. Flags and field width are skipped, plain int is 2 bytes as on AVR.
+constexpr uint8_t TraceConversionSize(const char* conversion)
+{
+	return ((*conversion >= '0' && *conversion <= '9') || *conversion == '-' || *conversion == '+'
+		|| *conversion == ' ' || *conversion == '#') ? TraceConversionSize(conversion + 1)
+		: (conversion[0] == 'h' && conversion[1] == 'h') ? 1 + TraceFormatSize(conversion + 3)
+		: conversion[0] == 'h' ? 2 + TraceFormatSize(conversion + 2)
+		: conversion[0] == 'l' ? 4 + TraceFormatSize(conversion + 2)
+		: 2 + TraceFormatSize(conversion + 1);
+}
+
+// Argument bytes a format expects.
+constexpr uint8_t TraceFormatSize(const char* format)
+{
+	return *format == '\0' ? 0
+		: *format != '%' ? TraceFormatSize(format + 1)
+		: format[1] == '%' ? TraceFormatSize(format + 2)
+		: TraceConversionSize(format + 1);
+}
+
+template<typename... Types>
+struct TraceArgumentSize;
+
+template<>
+struct TraceArgumentSize<>
+{
+	static const uint8_t Value = 0;
+};
+
+template<typename T, typename... Rest>
+struct TraceArgumentSize<T, Rest...>
+{
+	static const uint8_t Value = sizeof(T) + TraceArgumentSize<Rest...>::Value;
+};
+
+/* Deferred binary logger on USART0, replaces blocking Serial prints.
+	Write<Id>() only copies a record into a RAM ring, the USART TX interrupt drains it.
+	Record: [Sync][Id][Length][Millis u32][Arguments...]
+	Records that don't fit are dropped and counted, an Overflow record follows once there's room. */
+class TraceLog
+{
+public:
+	static const uint8_t Sync = 0x7E;
+
+private:
+	static const uint8_t BufferSize = 64;
+	// Sync, Id and Length. Length counts the timestamp and arguments.
+	static const uint8_t HeaderSize = 3;
+
+	static volatile uint8_t Buffer[BufferSize];
+	static volatile uint8_t Head;
+	static volatile uint8_t Tail;
+	static uint16_t Dropped;
+
+	static_assert(sizeof(Dropped) == TraceFormatSize(TraceFormats[(uint8_t)TraceEnum::Overflow]),
+		"Overflow record carries the dropped count.");
+
+public:
+	static void Setup(const uint32_t baudRate)
+	{
+		HalUsart::AttachTransmit(OnTxReadyInterrupt);
+		HalPower::Enable(PeripheralEnum::Usart0);
+		HalUsart::Enable(baudRate, false);
+	}
+
+	template<const TraceEnum Id, typename... Arguments>
+	static void Write(const Arguments... arguments)
+	{
+		static_assert(TraceArgumentSize<Arguments...>::Value == TraceFormatSize(TraceFormats[(uint8_t)Id]),
+			"Trace argument types don't match the format widths.");
+
+		const uint8_t Length = sizeof(uint32_t) + TraceArgumentSize<Arguments...>::Value;
+		const uint32_t Timestamp = Timebase::Millis();
+
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			if (Dropped > 0)
+			{
+				if (GetFree() < (HeaderSize + sizeof(uint32_t) + sizeof(Dropped) + HeaderSize + Length))
+				{
+					Dropped++;
+					return;
+				}
+
+				PutHeader(TraceEnum::Overflow, sizeof(uint32_t) + sizeof(Dropped), Timestamp);
+				Put(Dropped);
+				Dropped = 0;
+			}
+			else if (GetFree() < (HeaderSize + Length))
+			{
+				Dropped++;
+				return;
+			}
+
+			PutHeader(Id, Length, Timestamp);
+			PutAll(arguments...);
+
+			HalUsart::EnableTransmitInterrupt();
+		}
+	}
+
+	// Blocks until all records are sent, setup only.
+	static void Flush()
+	{
+		while (Head != Tail)
+		{
+			HalUsart::Poll();
+		}
+
+		while (!HalUsart::IsTransmitReady())
+		{
+			HalUsart::Poll();
+		}
+	}
+
+	static void OnTxReadyInterrupt()
+	{
+		if (Tail != Head)
+		{
+			HalUsart::Write(Buffer[Tail]);
+			Tail = (Tail + 1) % BufferSize;
+		}
+		else
+		{
+			HalUsart::DisableTransmitInterrupt();
+		}
+	}
+
+private:
+	// One slot is kept empty to tell full from empty.
+	static uint8_t GetFree()
+	{
+		return (BufferSize - 1) - ((Head + BufferSize - Tail) % BufferSize);
+	}
+
+	static void PutHeader(const TraceEnum id, const uint8_t length, const uint32_t timestamp)
+	{
+		PutByte(Sync);
+		PutByte((uint8_t)id);
+		PutByte(length);
+		Put(timestamp);
+	}
+
+	static void PutByte(const uint8_t value)
+	{
+		Buffer[Head] = value;
+		Head = (Head + 1) % BufferSize;
+	}
+
+	template<typename T>
+	static void Put(const T value)
+	{
+		const uint8_t* Bytes = (const uint8_t*)&value;
+
+		for (uint8_t i = 0; i < sizeof(T); i++)
+		{
+			PutByte(Bytes[i]);
+		}
+	}
+
+	static void PutAll()
+	{
+	}
+
+	template<typename T, typename... Rest>
+	static void PutAll(const T value, const Rest... rest)
+	{
+		Put(value);
+		PutAll(rest...);
+	}
+};
+
+// Storage, DEBUG_LOG is only defined in the sketch.
+#ifdef DEBUG_LOG
+volatile uint8_t TraceLog::Buffer[TraceLog::BufferSize];
+volatile uint8_t TraceLog::Head = 0;
+volatile uint8_t TraceLog::Tail = 0;
+uint16_t TraceLog::Dropped = 0;
+#endif
+
+#endif
@@ -0,0 +1,218 @@
+// EscalationLadder.h
+
+#ifndef _ESCALATIONLADDER_h
+#define _ESCALATIONLADDER_h
+
+#include <stdint.h>
+
+#include "../IMovementSensor.h"
+#include "../Hal/Hal.h"
+
+// Output played while on a rung.
+enum EscalationPatternEnum : uint8_t
+{
+	PatternArmed,
+	PatternEarlyWarning,
+	PatternAlarm
+};
+
+// One step of the escalation, stored in flash.
+struct EscalationRung
+{
+	// Motion is ignored for this long after entering the rung.
+	uint32_t GraceMillis;
+
+	// MotionCount events within the last WindowMillis (sliding) climb to the next rung.
+	// Window resolution and span are those of the sensor's motion density.
+	// A MotionCount of 0 is the top of the ladder, motion detection is not needed.
+	uint32_t WindowMillis;
+
+	// Falls back to ExpiryRung after this long. 0 holds the rung forever.
+	uint32_t DurationMillis;
+
+	// Climbing into this rung again within this period skips it, straight to the next one.
+	uint32_t CooldownMillis;
+
+	uint8_t MotionCount;
+	uint8_t Pattern;
+	uint8_t ExpiryRung;
+};
+
+// Interprets an escalation ladder from flash.
+// Each step is O(1), only the current rung is cached in RAM.
+class EscalationLadder
+{
+public:
+	static const uint8_t MaxRungs = 6;
+
+private:
+	const EscalationRung* Table;
+	const uint8_t RungCount;
+
+	EscalationRung Current;
+	uint8_t Index = 0;
+
+	uint32_t RungStarted = 0;
+
+	// Event counter at the end of grace, earlier events never count.
+	uint16_t MotionBase = 0;
+
+	uint32_t LastEntered[MaxRungs];
+
+public:
+	EscalationLadder(const EscalationRung* table, const uint8_t rungCount)
+		: Table(table)
+		, RungCount(rungCount <= MaxRungs ? rungCount : MaxRungs)
+	{
+		Load(0);
+	}
+
+	// Clears all cool-downs.
+	void Reset(const uint32_t now)
+	{
+		for (uint8_t i = 0; i < RungCount; i++)
+		{
+			LastEntered[i] = now - INT32_MAX;
+		}
+	}
+
+	// Resume on a rung after a reset, with all cool-downs active.
+	void Resume(const uint8_t rung, const uint32_t rungStarted, const uint16_t motionCount)
+	{
+		for (uint8_t i = 0; i < RungCount; i++)
+		{
+			LastEntered[i] = rungStarted;
+		}
+
+		Enter(rung, rungStarted, motionCount);
+	}
+
+	void Enter(const uint8_t rung, const uint32_t now, const uint16_t motionCount)
+	{
+		Load(rung < RungCount ? rung : 0);
+
+		LastEntered[Index] = now;
+		RungStarted = now;
+		MotionBase = motionCount;
+	}
+
+	uint8_t GetRung()
+	{
+		return Index;
+	}
+
+	uint32_t GetRungElapsed(const uint32_t now)
+	{
+		return now - RungStarted;
+	}
+
+	EscalationPatternEnum GetPattern()
+	{
+		return (EscalationPatternEnum)Current.Pattern;
+	}
+
+	bool NeedsMotionDetection()
+	{
+		return Current.MotionCount > 0;
+	}
+
+	// True if a single motion event now is enough to climb, the outcome of the next step is already known.
+	bool ClimbsOnNextEvent(const uint32_t now)
+	{
+		return Current.MotionCount == 1 && (now - RungStarted) >= Current.GraceMillis;
+	}
+
+	/* Returns true if the rung changed.
+		nextStepMillis is set to the time until the next deadline, 0 if there's none pending.
+		duration is the rung duration, already adjusted by the caller (e.g. for low battery). */
+	bool Step(const uint32_t now, IMovementSensor* motion, const uint32_t duration, uint32_t& nextStepMillis)
+	{
+		const uint32_t Elapsed = now - RungStarted;
+		const uint16_t MotionCount = motion->GetMotionEventCount();
+
+		nextStepMillis = 0;
+
+		if (duration > 0 && Elapsed >= duration)
+		{
+			Enter(Current.ExpiryRung, now, MotionCount);
+
+			return true;
+		}
+
+		if (duration > 0)
+		{
+			nextStepMillis = duration - Elapsed;
+		}
+
+		if (Current.MotionCount == 0)
+		{
+			return false;
+		}
+
+		if (Elapsed < Current.GraceMillis)
+		{
+			// Events during grace don't count.
+			MotionBase = MotionCount;
+
+			if (nextStepMillis == 0 || (Current.GraceMillis - Elapsed) < nextStepMillis)
+			{
+				nextStepMillis = Current.GraceMillis - Elapsed;
+			}
+
+			return false;
+		}
+
+		// Sustained motion: enough events within the sliding window, all after grace.
+		uint16_t Density = motion->GetMotionDensity(Current.WindowMillis);
+		if ((uint16_t)(MotionCount - MotionBase) < Density)
+		{
+			Density = MotionCount - MotionBase;
+		}
+
+		if (Density >= Current.MotionCount)
+		{
+			Climb(now, MotionCount);
+
+			return true;
+		}
+
+		return false;
+	}
+
+	uint32_t GetDuration()
+	{
+		return Current.DurationMillis;
+	}
+
+private:
+	void Climb(const uint32_t now, const uint16_t motionCount)
+	{
+		uint8_t Next = Index + 1;
+
+		// Skip rungs still in cool-down, but never the top one.
+		while (Next < (RungCount - 1)
+			&& (now - LastEntered[Next]) < GetCooldown(Next))
+		{
+			Next++;
+		}
+
+		if (Next >= RungCount)
+		{
+			Next = RungCount - 1;
+		}
+
+		Enter(Next, now, motionCount);
+	}
+
+	uint32_t GetCooldown(const uint8_t rung)
+	{
+		return pgm_read_dword(&Table[rung].CooldownMillis);
+	}
+
+	void Load(const uint8_t rung)
+	{
+		Index = rung;
+		memcpy_P(&Current, &Table[rung], sizeof(EscalationRung));
+	}
+};
+#endif
@@ -0,0 +1,36 @@
+// EscalationLadders.h
+
+#ifndef _ESCALATIONLADDERS_h
+#define _ESCALATIONLADDERS_h
+
+#include "EscalationLadder.h"
+#include "../AlarmConstants.h"
+
+// Armed -> Early Warning -> Alarm.
+// Early warning is skipped if it was played recently.
+static const EscalationRung DefaultLadder[] PROGMEM =
+{
+	// Grace, Window, Duration, Cooldown, MotionCount, Pattern, ExpiryRung.
+	{ 0, MOVEMENT_PERIOD_MILLIS, 0, 0, 1, PatternArmed, 0 },
+	{ TRANSITION_GRACE_PERIOD_MILLIS + MOVEMENT_PERIOD_MILLIS, MOVEMENT_PERIOD_MILLIS, EARLY_WARNING_PERIOD_MILLIS, EARLY_WARNING_SKIP_MILLIS, 1, PatternEarlyWarning, 0 },
+	{ 0, 0, ALARMING_DURATION_MILLIS, 0, 0, PatternAlarm, 1 }
+};
+
+// For busy bike racks, where bumps are common.
+// Needs sustained handling before warning and alarming, short alarm.
+static const EscalationRung GentleLadder[] PROGMEM =
+{
+	{ 0, 2000, 0, 0, 3, PatternArmed, 0 },
+	{ TRANSITION_GRACE_PERIOD_MILLIS + MOVEMENT_PERIOD_MILLIS, 3000, EARLY_WARNING_PERIOD_MILLIS + 2000, 10000, 3, PatternEarlyWarning, 0 },
+	{ 0, 0, ALARMING_MIN_DURATION_MILLIS * 2, 0, 0, PatternAlarm, 1 }
+};
+
+// For isolated places, any motion alarms straight away.
+static const EscalationRung HarshLadder[] PROGMEM =
+{
+	{ 0, MOVEMENT_PERIOD_MILLIS, 0, 0, 1, PatternArmed, 0 },
+	{ 0, 0, ALARMING_DURATION_MILLIS, 0, 0, PatternAlarm, 0 }
+};
+
+#define ESCALATION_LADDER_SIZE(ladder) (sizeof(ladder) / sizeof(EscalationRung))
+#endif
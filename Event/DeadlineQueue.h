@@ -0,0 +1,81 @@
+// DeadlineQueue.h
+
+#ifndef _DEADLINEQUEUE_h
+#define _DEADLINEQUEUE_h
+
+#include <stdint.h>
+
+// A handful of named timeouts, one slot per id.
+// Lookups scan all slots, meant for Count <= 8.
+template<const uint8_t Count>
+class DeadlineQueue
+{
+	static_assert(Count > 0 && Count <= 8, "Active deadlines are tracked in one byte.");
+
+private:
+	uint32_t Due[Count];
+	uint8_t ActiveMask = 0;
+
+public:
+	DeadlineQueue()
+	{
+	}
+
+	void Set(const uint8_t id, const uint32_t now, const uint32_t delayMillis)
+	{
+		Due[id] = now + delayMillis;
+		ActiveMask |= 1 << id;
+	}
+
+	void Cancel(const uint8_t id)
+	{
+		ActiveMask &= ~(1 << id);
+	}
+
+	void Clear()
+	{
+		ActiveMask = 0;
+	}
+
+	bool IsActive(const uint8_t id)
+	{
+		return ActiveMask & (1 << id);
+	}
+
+	// Returns true and cancels the deadline, if it has expired.
+	bool Expire(const uint8_t id, const uint32_t now)
+	{
+		if (IsActive(id) && (int32_t)(now - Due[id]) >= 0)
+		{
+			Cancel(id);
+
+			return true;
+		}
+
+		return false;
+	}
+
+	// Returns false if no deadline is pending. Expired deadlines give 0.
+	bool GetNextDelay(const uint32_t now, uint32_t& delayMillis)
+	{
+		bool Found = false;
+
+		for (uint8_t i = 0; i < Count; i++)
+		{
+			if (IsActive(i))
+			{
+				const int32_t Remaining = (int32_t)(Due[i] - now);
+				const uint32_t Delay = Remaining > 0 ? Remaining : 0;
+
+				if (!Found || Delay < delayMillis)
+				{
+					delayMillis = Delay;
+					Found = true;
+				}
+			}
+		}
+
+		return Found;
+	}
+};
+#endif
@@ -0,0 +1,77 @@
+// EventBus.h
+
+#ifndef _EVENTBUS_h
+#define _EVENTBUS_h
+
+#include "../IEventListener.h"
+
+// One listener, given at runtime to Setup. One virtual call per event.
+class RuntimeEventBus
+{
+private:
+	IEventListener* Listener = nullptr;
+
+public:
+	bool Attach(IEventListener* listener)
+	{
+		Listener = listener;
+
+		return Listener != nullptr;
+	}
+
+	void Publish()
+	{
+		Listener->OnEvent();
+	}
+};
+
+// Binds a subscriber instance at compile time, Instance must have static storage.
+// The qualified call bypasses the vtable, even if OnEvent is virtual.
+template<typename Subscriber, Subscriber* Instance>
+struct EventSubscriber
+{
+	__attribute__((always_inline)) static inline void Notify()
+	{
+		Instance->Subscriber::OnEvent();
+	}
+};
+
+/* Subscribers fixed at compile time, notified in list order. For example:
+	typedef StaticEventBus<EventSubscriber<AlarmManager, &Manager>, EventSubscriber<Journal, &EventJournal>> AlarmEvents;
+	Publish unrolls into direct calls, the bus itself takes no RAM.
+	Subscribers only need a public OnEvent(). */
+template<typename... Subscribers>
+class StaticEventBus;
+
+template<>
+class StaticEventBus<>
+{
+public:
+	// The list is fixed, a runtime listener would be dropped.
+	bool Attach(IEventListener* listener)
+	{
+		return listener == nullptr;
+	}
+
+	__attribute__((always_inline)) static inline void Publish()
+	{
+	}
+};
+
+template<typename First, typename... Rest>
+class StaticEventBus<First, Rest...>
+{
+public:
+	// The list is fixed, a runtime listener would be dropped.
+	bool Attach(IEventListener* listener)
+	{
+		return listener == nullptr;
+	}
+
+	__attribute__((always_inline)) static inline void Publish()
+	{
+		First::Notify();
+		StaticEventBus<Rest...>::Publish();
+	}
+};
+#endif
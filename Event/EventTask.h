@@ -6,46 +6,40 @@
 #define _TASK_OO_CALLBACKS
 #include <TaskSchedulerDeclarations.h>
 
-#include "..\IEventListener.h"
+#include "../IEventListener.h"
+#include "EventBus.h"
 
 
-
-class EventSource
+// Sources publish with EventBus::Publish(), see EventBus.h.
+// The bus is an empty base when static, so it adds no RAM.
+template<typename EventBus = RuntimeEventBus>
+class EventSource : protected EventBus
 {
-protected:
-	IEventListener* EventListener = nullptr;
-
 public:
 	EventSource()
 	{
 	}
 
-	virtual bool Setup(IEventListener* eventListener)
+	virtual bool Setup(IEventListener* eventListener = nullptr)
 	{
-		EventListener = eventListener;
-
-		return EventListener != nullptr;
+		return EventBus::Attach(eventListener);
 	}
 };
 
-class EventTask : public Task
+template<typename EventBus = RuntimeEventBus>
+class EventTask : public Task, protected EventBus
 {
-protected:
-	IEventListener* EventListener = nullptr;
-
 public:
 	EventTask(Scheduler* scheduler)
 		: Task(0, TASK_FOREVER, scheduler, false)
 	{
 	}
 
-	virtual bool Setup(IEventListener* eventListener)
+	virtual bool Setup(IEventListener* eventListener = nullptr)
 	{
-		EventListener = eventListener;
-
-		return EventListener != nullptr;
+		return EventBus::Attach(eventListener);
 	}
 };
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,35 @@
+// AvrEeprom.h
+
+#ifndef _AVREEPROM_h
+#define _AVREEPROM_h
+
+#include <stdint.h>
+#include <avr/eeprom.h>
+
+// EEPROM through avr-libc. Updates only write cells that changed.
+class HalEeprom
+{
+public:
+	static uint8_t Read(const uint16_t address)
+	{
+		return eeprom_read_byte((const uint8_t*)address);
+	}
+
+	static void Update(const uint16_t address, const uint8_t value)
+	{
+		eeprom_update_byte((uint8_t*)address, value);
+	}
+
+	template<typename T>
+	static void Get(const uint16_t address, T& value)
+	{
+		eeprom_read_block(&value, (const void*)address, sizeof(T));
+	}
+
+	template<typename T>
+	static void Put(const uint16_t address, const T& value)
+	{
+		eeprom_update_block(&value, (void*)address, sizeof(T));
+	}
+};
+#endif
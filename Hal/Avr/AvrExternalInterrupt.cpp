@@ -0,0 +1,38 @@
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+
+#include "AvrPin.h"
+
+static void NoHandler()
+{
+}
+
+void (*ExternalInterruptHandlers[2])() = { NoHandler, NoHandler };
+
+ISR(INT0_vect)
+{
+	ExternalInterruptHandlers[0]();
+}
+
+ISR(INT1_vect)
+{
+	ExternalInterruptHandlers[1]();
+}
+
+void (*PinChangeInterruptHandlers[3])() = { NoHandler, NoHandler, NoHandler };
+
+ISR(PCINT0_vect)
+{
+	PinChangeInterruptHandlers[0]();
+}
+
+ISR(PCINT1_vect)
+{
+	PinChangeInterruptHandlers[1]();
+}
+
+ISR(PCINT2_vect)
+{
+	PinChangeInterruptHandlers[2]();
+}
+#endif
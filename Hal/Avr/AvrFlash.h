@@ -0,0 +1,8 @@
+// AvrFlash.h
+
+#ifndef _AVRFLASH_h
+#define _AVRFLASH_h
+
+// Constant tables in program memory, through avr-libc (PROGMEM, memcpy_P, pgm_read_*).
+#include <avr/pgmspace.h>
+#endif
@@ -0,0 +1,140 @@
+// AvrPin.h
+
+#ifndef _AVRPIN_h
+#define _AVRPIN_h
+
+#include <stdint.h>
+#include <avr/io.h>
+
+// Compile-time pin for the ATmega328P Arduino pin map.
+// All operations resolve to single sbi/cbi/sbic instructions, no pin table lookups.
+template<const uint8_t Pin>
+class FastPin
+{
+	static_assert(Pin < 20, "ATmega328P has digital pins 0 to 19.");
+
+public:
+	static const uint8_t Mask = _BV(Pin < 8 ? Pin : (Pin < 14 ? Pin - 8 : Pin - 14));
+
+private:
+	static volatile uint8_t& Ddr()
+	{
+		return Pin < 8 ? DDRD : (Pin < 14 ? DDRB : DDRC);
+	}
+
+	static volatile uint8_t& Port()
+	{
+		return Pin < 8 ? PORTD : (Pin < 14 ? PORTB : PORTC);
+	}
+
+	static volatile uint8_t& Input()
+	{
+		return Pin < 8 ? PIND : (Pin < 14 ? PINB : PINC);
+	}
+
+public:
+	static void SetInput()
+	{
+		Ddr() &= ~Mask;
+		Port() &= ~Mask;
+	}
+
+	static void SetInputPullup()
+	{
+		Ddr() &= ~Mask;
+		Port() |= Mask;
+	}
+
+	static void SetOutput()
+	{
+		Ddr() |= Mask;
+	}
+
+	static bool Read()
+	{
+		return Input() & Mask;
+	}
+
+	static void High()
+	{
+		Port() |= Mask;
+	}
+
+	static void Low()
+	{
+		Port() &= ~Mask;
+	}
+};
+
+// Handlers for INT0 and INT1, dispatched from AvrExternalInterrupt.cpp.
+extern void (*ExternalInterruptHandlers[2])();
+
+// External interrupt set up directly through EICRA/EIMSK.
+template<const uint8_t Pin>
+class ExternalInterrupt
+{
+	static_assert(Pin == 2 || Pin == 3, "Only pins 2 (INT0) and 3 (INT1) have external interrupts.");
+
+private:
+	static const uint8_t Number = Pin - 2;
+	static const uint8_t SenseShift = Number * 2;
+
+public:
+	enum SenseEnum : uint8_t
+	{
+		Low = 0,
+		Change = 1,
+		Falling = 2,
+		Rising = 3
+	};
+
+	static void Attach(void (*handler)(), const SenseEnum sense)
+	{
+		ExternalInterruptHandlers[Number] = handler;
+		EICRA = (EICRA & ~(0x03 << SenseShift)) | (sense << SenseShift);
+
+		// Edge senses latch in EIFR while masked, a stale edge would fire on unmask.
+		EIFR = _BV(Number);
+		EIMSK |= _BV(Number);
+	}
+
+	static void Detach()
+	{
+		EIMSK &= ~_BV(Number);
+	}
+};
+
+// Handlers per port (PCINT0 to PCINT2), dispatched from AvrExternalInterrupt.cpp.
+extern void (*PinChangeInterruptHandlers[3])();
+
+// Pin change interrupt, any edge. Pins on the same port share one handler.
+template<const uint8_t Pin>
+class PinChangeInterrupt
+{
+	static_assert(Pin < 20, "ATmega328P has digital pins 0 to 19.");
+
+private:
+	static const uint8_t Group = Pin < 8 ? 2 : (Pin < 14 ? 0 : 1);
+
+	static volatile uint8_t& Mask()
+	{
+		return Pin < 8 ? PCMSK2 : (Pin < 14 ? PCMSK0 : PCMSK1);
+	}
+
+public:
+	static void Attach(void (*handler)())
+	{
+		PinChangeInterruptHandlers[Group] = handler;
+
+		// Drop a change latched while masked.
+		PCIFR = _BV(Group);
+		Mask() |= FastPin<Pin>::Mask;
+		PCICR |= _BV(Group);
+	}
+
+	static void Detach()
+	{
+		Mask() &= ~FastPin<Pin>::Mask;
+	}
+};
+#endif
@@ -0,0 +1,62 @@
+// AvrPower.h
+
+#ifndef _AVRPOWER_h
+#define _AVRPOWER_h
+
+#include <avr/power.h>
+
+// Power reduction register, through avr-libc. Constant arguments fold to a single bit operation.
+class HalPower
+{
+public:
+	__attribute__((always_inline)) static inline void Enable(const PeripheralEnum peripheral)
+	{
+		switch (peripheral)
+		{
+		case PeripheralEnum::Adc:
+			power_adc_enable();
+			break;
+		case PeripheralEnum::Spi:
+			power_spi_enable();
+			break;
+		case PeripheralEnum::Timer1:
+			power_timer1_enable();
+			break;
+		case PeripheralEnum::Timer2:
+			power_timer2_enable();
+			break;
+		case PeripheralEnum::Twi:
+			power_twi_enable();
+			break;
+		case PeripheralEnum::Usart0:
+			power_usart0_enable();
+			break;
+		}
+	}
+
+	__attribute__((always_inline)) static inline void Disable(const PeripheralEnum peripheral)
+	{
+		switch (peripheral)
+		{
+		case PeripheralEnum::Adc:
+			power_adc_disable();
+			break;
+		case PeripheralEnum::Spi:
+			power_spi_disable();
+			break;
+		case PeripheralEnum::Timer1:
+			power_timer1_disable();
+			break;
+		case PeripheralEnum::Timer2:
+			power_timer2_disable();
+			break;
+		case PeripheralEnum::Twi:
+			power_twi_disable();
+			break;
+		case PeripheralEnum::Usart0:
+			power_usart0_disable();
+			break;
+		}
+	}
+};
+#endif
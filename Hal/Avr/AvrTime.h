@@ -0,0 +1,17 @@
+// AvrTime.h
+
+#ifndef _AVRTIME_h
+#define _AVRTIME_h
+
+#include <Arduino.h>
+
+// Blocking waits, for boot time device setup only.
+class HalTime
+{
+public:
+	static void Delay(const uint32_t millis)
+	{
+		delay(millis);
+	}
+};
+#endif
@@ -0,0 +1,16 @@
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+
+#include "AvrTwi.h"
+
+static void NoHandler()
+{
+}
+
+void (*TwiInterruptHandler)() = NoHandler;
+
+ISR(TWI_vect)
+{
+	TwiInterruptHandler();
+}
+#endif
@@ -0,0 +1,89 @@
+// AvrTwi.h
+
+#ifndef _AVRTWI_h
+#define _AVRTWI_h
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <util/twi.h>
+
+// Handler for the TWI interrupt, dispatched from AvrTwi.cpp.
+extern void (*TwiInterruptHandler)();
+
+// TWI master operations as single TWCR/TWDR accesses.
+// Each bus operation clears TWINT, the interrupt fires when it is done.
+class HalTwi
+{
+public:
+	static void Attach(void (*handler)())
+	{
+		TwiInterruptHandler = handler;
+	}
+
+	static void Enable(const uint8_t bitRate)
+	{
+		TWSR = 0; // Prescaler 1.
+		TWBR = bitRate;
+		TWCR = _BV(TWEN);
+	}
+
+	// Releases SDA and SCL to the port, for bus clearing.
+	static void Disable()
+	{
+		TWCR = 0;
+	}
+
+	static void Start(const bool afterStop)
+	{
+		if (afterStop)
+		{
+			// Hardware sends STOP followed by START.
+			TWCR = _BV(TWINT) | _BV(TWSTO) | _BV(TWSTA) | _BV(TWEN) | _BV(TWIE);
+		}
+		else
+		{
+			TWCR = _BV(TWINT) | _BV(TWSTA) | _BV(TWEN) | _BV(TWIE);
+		}
+	}
+
+	// Sends STOP, or only resets the hardware after a bus error. No interrupt follows.
+	static void Stop()
+	{
+		TWCR = _BV(TWINT) | _BV(TWSTO) | _BV(TWEN);
+	}
+
+	static void Send(const uint8_t value)
+	{
+		TWDR = value;
+		TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+	}
+
+	// Receives one byte, acknowledged if more are to follow.
+	static void Receive(const bool ack)
+	{
+		if (ack)
+		{
+			TWCR = _BV(TWINT) | _BV(TWEA) | _BV(TWEN) | _BV(TWIE);
+		}
+		else
+		{
+			TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+		}
+	}
+
+	static uint8_t GetData()
+	{
+		return TWDR;
+	}
+
+	static uint8_t GetStatus()
+	{
+		return TW_STATUS;
+	}
+
+	// Interrupt driven, nothing to service while waiting.
+	static void Poll()
+	{
+	}
+};
+#endif
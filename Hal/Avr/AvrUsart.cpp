@@ -0,0 +1,22 @@
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+
+#include "AvrUsart.h"
+
+static void NoHandler()
+{
+}
+
+void (*UsartReceiveHandler)() = NoHandler;
+void (*UsartTransmitHandler)() = NoHandler;
+
+ISR(USART_RX_vect)
+{
+	UsartReceiveHandler();
+}
+
+ISR(USART_UDRE_vect)
+{
+	UsartTransmitHandler();
+}
+#endif
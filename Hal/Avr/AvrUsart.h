@@ -0,0 +1,73 @@
+// AvrUsart.h
+
+#ifndef _AVRUSART_h
+#define _AVRUSART_h
+
+#include <stdint.h>
+#include <avr/io.h>
+
+// Handlers for USART0 receive and data register empty, dispatched from AvrUsart.cpp.
+extern void (*UsartReceiveHandler)();
+extern void (*UsartTransmitHandler)();
+
+// USART0 as an asynchronous 8N1 port, one register access per call.
+// Power is switched separately, with HalPower.
+class HalUsart
+{
+public:
+	static void AttachReceive(void (*handler)())
+	{
+		UsartReceiveHandler = handler;
+	}
+
+	static void AttachTransmit(void (*handler)())
+	{
+		UsartTransmitHandler = handler;
+	}
+
+	// Double speed, the baud rate is rounded. Receive enables RX and its interrupt.
+	static void Enable(const uint32_t baudRate, const bool receive)
+	{
+		UCSR0A = _BV(U2X0);
+		UBRR0 = (((F_CPU / 4) / baudRate) - 1) / 2;
+		UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+		UCSR0B = receive ? (_BV(RXEN0) | _BV(TXEN0) | _BV(RXCIE0)) : _BV(TXEN0);
+	}
+
+	static void Disable()
+	{
+		UCSR0B = 0;
+	}
+
+	// Data register empty interrupt, the handler writes the next byte or disables it.
+	static void EnableTransmitInterrupt()
+	{
+		UCSR0B |= _BV(UDRIE0);
+	}
+
+	static void DisableTransmitInterrupt()
+	{
+		UCSR0B &= ~_BV(UDRIE0);
+	}
+
+	static void Write(const uint8_t value)
+	{
+		UDR0 = value;
+	}
+
+	static uint8_t Read()
+	{
+		return UDR0;
+	}
+
+	static bool IsTransmitReady()
+	{
+		return UCSR0A & _BV(UDRE0);
+	}
+
+	// Interrupt driven, nothing to service while waiting.
+	static void Poll()
+	{
+	}
+};
+#endif
@@ -0,0 +1,69 @@
+// Hal.h
+
+#ifndef _HAL_h
+#define _HAL_h
+
+/* Compile-time hardware abstraction.
+	On AVR everything resolves inline to the raw register or avr-libc call, there is no indirection.
+	Elsewhere, instrumented fakes stand in for the hardware (see Linux/HalFake.h).
+
+	- FastPin<Pin>: GPIO.
+	- ExternalInterrupt<Pin>: INT0/INT1.
+	- PinChangeInterrupt<Pin>: PCINT, one handler per port.
+	- HalPower: power reduction of on-chip peripherals.
+	- HalEeprom: EEPROM bytes and blocks.
+	- HalTime: blocking waits during boot.
+	- HalTwi: TWI master operations and interrupt.
+	- HalUsart: USART0 bytes and interrupts.
+	- PROGMEM tables (memcpy_P, pgm_read_*).
+	The Linux backend also replaces Timebase and ClockGovernor, see Linux/LinuxTimebase.h. */
+
+#include <stdint.h>
+
+enum class PeripheralEnum : uint8_t
+{
+	Adc,
+	Spi,
+	Timer1,
+	Timer2,
+	Twi,
+	Usart0
+};
+
+// TWI master status, as in util/twi.h.
+enum class TwiStatusEnum : uint8_t
+{
+	BusError = 0x00,
+	Start = 0x08,
+	RepeatedStart = 0x10,
+	WriteAddressAck = 0x18,
+	WriteAddressNack = 0x20,
+	WriteDataAck = 0x28,
+	WriteDataNack = 0x30,
+	ArbitrationLost = 0x38,
+	ReadAddressAck = 0x40,
+	ReadAddressNack = 0x48,
+	ReadDataAck = 0x50,
+	ReadDataNack = 0x58
+};
+
+#if defined(__AVR__)
+#include "Avr/AvrPin.h"
+#include "Avr/AvrPower.h"
+#include "Avr/AvrEeprom.h"
+#include "Avr/AvrTime.h"
+#include "Avr/AvrFlash.h"
+#include "Avr/AvrTwi.h"
+#include "Avr/AvrUsart.h"
+#else
+#include "Linux/HalFake.h"
+#include "Linux/LinuxPin.h"
+#include "Linux/LinuxPower.h"
+#include "Linux/LinuxEeprom.h"
+#include "Linux/LinuxTime.h"
+#include "Linux/LinuxFlash.h"
+#include "Linux/LinuxTwi.h"
+#include "Linux/LinuxUsart.h"
+#endif
+
+#endif
@@ -0,0 +1,70 @@
+// FakeLIS3DH.h
+
+#ifndef _FAKELIS3DH_h
+#define _FAKELIS3DH_h
+
+#include <stdint.h>
+
+#include "HalFakeTwiDevice.h"
+
+// LIS3DH register map. Models the sub-address auto-increment bit and the CTRL_REG1 power modes,
+// sensor outputs are set by the caller.
+class FakeLIS3DH : public HalFakeTwiDevice
+{
+public:
+	static const uint8_t RegisterWhoAmI = 0x0F;
+	static const uint8_t RegisterControl1 = 0x20;
+
+private:
+	static const uint8_t AutoIncrement = 0x80;
+	static const uint8_t LowPowerEnable = 0x08;
+
+	static const uint8_t RateCount = 10;
+
+public:
+	FakeLIS3DH(const uint8_t address = 0x18)
+		: HalFakeTwiDevice(address)
+	{
+		Registers[RegisterWhoAmI] = 0x33;
+		Registers[RegisterControl1] = 0x07;
+	}
+
+	virtual void Write(const uint8_t reg, const uint8_t* data, const uint8_t length)
+	{
+		const uint8_t Start = reg & ~AutoIncrement;
+
+		for (uint8_t i = 0; i < length; i++)
+		{
+			OnWrite((reg & AutoIncrement) ? (Start + i) % RegisterCount : Start, data[i]);
+		}
+	}
+
+	virtual void Read(const uint8_t reg, uint8_t* data, const uint8_t length)
+	{
+		const uint8_t Start = reg & ~AutoIncrement;
+
+		for (uint8_t i = 0; i < length; i++)
+		{
+			data[i] = Registers[(reg & AutoIncrement) ? (Start + i) % RegisterCount : Start];
+		}
+	}
+
+	virtual uint32_t GetSupplyNanoAmps()
+	{
+		// Typical at 2.5 V by output data rate (datasheet table 12): power down, 1, 10, 25, 50, 100, 200, 400 Hz,
+		// 1.6 kHz (low power only), 1.344 / 5.376 kHz.
+		static const uint32_t NormalNanoAmps[RateCount] = { 500, 2000, 4000, 6000, 11000, 20000, 38000, 73000, 0, 185000 };
+		static const uint32_t LowPowerNanoAmps[RateCount] = { 500, 2000, 3000, 4000, 6000, 10000, 16000, 30000, 100000, 185000 };
+
+		const uint8_t Control1 = Registers[RegisterControl1];
+		const uint8_t Rate = Control1 >> 4;
+
+		if (Rate >= RateCount)
+		{
+			return 0;
+		}
+
+		return (Control1 & LowPowerEnable) ? LowPowerNanoAmps[Rate] : NormalNanoAmps[Rate];
+	}
+};
+#endif
@@ -0,0 +1,85 @@
+// FakeMPU6050.h
+
+#ifndef _FAKEMPU6050_h
+#define _FAKEMPU6050_h
+
+#include <stdint.h>
+
+#include "HalFakeTwiDevice.h"
+
+// MPU-6050 register map. Models reset, sleep, cycle and standby bits, sensor outputs are set by the caller.
+class FakeMPU6050 : public HalFakeTwiDevice
+{
+public:
+	static const uint8_t RegisterPowerManagement1 = 0x6B;
+	static const uint8_t RegisterPowerManagement2 = 0x6C;
+	static const uint8_t RegisterWhoAmI = 0x75;
+
+private:
+	static const uint8_t PowerReset = 0x80;
+	static const uint8_t PowerSleep = 0x40;
+	static const uint8_t PowerCycle = 0x20;
+	static const uint8_t StandbyAccel = 0x38;
+	static const uint8_t StandbyGyro = 0x07;
+
+	// Typical at 3.3 V (datasheet 6.4, 6.3).
+	static const uint32_t SleepNanoAmps = 5000;
+	static const uint32_t AccelNanoAmps = 500000;
+	static const uint32_t GyroNanoAmps = 3600000;
+	static const uint32_t CycleNanoAmps = 110000; // Low power accelerometer at 40 Hz.
+
+public:
+	FakeMPU6050(const uint8_t address = 0x68)
+		: HalFakeTwiDevice(address)
+	{
+		Reset();
+	}
+
+	virtual uint32_t GetSupplyNanoAmps()
+	{
+		const uint8_t Power1 = Registers[RegisterPowerManagement1];
+		const uint8_t Power2 = Registers[RegisterPowerManagement2];
+
+		if (Power1 & PowerSleep)
+		{
+			return SleepNanoAmps;
+		}
+
+		uint32_t Current = 0;
+
+		if ((Power2 & StandbyAccel) != StandbyAccel)
+		{
+			Current += (Power1 & PowerCycle) ? CycleNanoAmps : AccelNanoAmps;
+		}
+
+		if ((Power2 & StandbyGyro) != StandbyGyro)
+		{
+			Current += GyroNanoAmps;
+		}
+
+		return Current;
+	}
+
+protected:
+	virtual void OnWrite(const uint8_t reg, const uint8_t value)
+	{
+		if (reg == RegisterPowerManagement1 && (value & PowerReset))
+		{
+			RegisterWrites++;
+			Reset();
+
+			return;
+		}
+
+		HalFakeTwiDevice::OnWrite(reg, value);
+	}
+
+private:
+	void Reset()
+	{
+		memset(Registers, 0, sizeof(Registers));
+		Registers[RegisterPowerManagement1] = PowerSleep;
+		Registers[RegisterWhoAmI] = 0x68;
+	}
+};
+#endif
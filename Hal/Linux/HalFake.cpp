@@ -0,0 +1,388 @@
+#if !defined(__AVR__)
+#include <string.h>
+
+#include "HalFake.h"
+#include "HalFakeTwiDevice.h"
+#include "../Hal.h"
+
+HalFakeState HalFake;
+
+void HalFakeReset()
+{
+	memset(&HalFake, 0, sizeof(HalFakeState));
+	memset(HalFake.Eeprom, 0xFF, sizeof(HalFake.Eeprom));
+	HalFake.PoweredMask = 0xFF;
+	HalFake.FreeRam = 1024;
+	HalFake.StackHeadroom = 1024;
+}
+
+void HalFakeSetPin(const uint8_t pin, const bool level)
+{
+	if (pin >= HalFakeState::PinCount)
+	{
+		return;
+	}
+
+	const bool Previous = HalFake.PinLevel[pin];
+	HalFake.PinLevel[pin] = level;
+
+	if (level != Previous && HalFake.PinChangeEnabled[pin])
+	{
+		const uint8_t Group = pin < 8 ? 2 : (pin < 14 ? 0 : 1);
+
+		if (HalFake.PinChangeHandler[Group] != nullptr)
+		{
+			HalFake.PinChangeHandler[Group]();
+		}
+	}
+
+	if (pin != 2 && pin != 3)
+	{
+		return;
+	}
+
+	const uint8_t Number = pin - 2;
+
+	// Same encoding as EICRA: Low, Change, Falling, Rising.
+	bool Fire = false;
+	switch (HalFake.InterruptSense[Number])
+	{
+	case 0:
+		Fire = !level;
+		break;
+	case 1:
+		Fire = level != Previous;
+		break;
+	case 2:
+		Fire = Previous && !level;
+		break;
+	case 3:
+		Fire = !Previous && level;
+		break;
+	default:
+		break;
+	}
+
+	if (!Fire)
+	{
+		return;
+	}
+
+	if (!HalFake.InterruptEnabled[Number] || HalFake.InterruptHandler[Number] == nullptr)
+	{
+		// Low level doesn't latch.
+		if (HalFake.InterruptSense[Number] != 0)
+		{
+			HalFake.InterruptFlag[Number] = true;
+		}
+	}
+	else
+	{
+		HalFake.InterruptFlag[Number] = false;
+		HalFake.InterruptHandler[Number]();
+	}
+}
+
+bool HalFakeAttachTwi(HalFakeTwiDevice* device)
+{
+	for (uint8_t i = 0; i < HalFakeState::TwiDeviceCount; i++)
+	{
+		if (HalFake.TwiDevices[i] == nullptr)
+		{
+			HalFake.TwiDevices[i] = device;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool HalFakeWriteUsart(const uint8_t value)
+{
+	if (!HalFake.UsartReceiving || HalFake.UsartRxCount >= HalFakeUsartBufferSize)
+	{
+		HalFake.UsartRxDropped++;
+
+		return false;
+	}
+
+	HalFake.UsartRx[(HalFake.UsartRxHead + HalFake.UsartRxCount) % HalFakeUsartBufferSize] = value;
+	HalFake.UsartRxCount++;
+
+	return true;
+}
+
+bool HalFakeReadUsart(uint8_t& value)
+{
+	if (HalFake.UsartTxCount == 0)
+	{
+		return false;
+	}
+
+	value = HalFake.UsartTx[HalFake.UsartTxHead];
+	HalFake.UsartTxHead = (HalFake.UsartTxHead + 1) % HalFakeUsartBufferSize;
+	HalFake.UsartTxCount--;
+
+	return true;
+}
+
+uint16_t HalFakeRunInterrupts(const uint16_t limit)
+{
+	uint16_t Count = 0;
+
+	// In AVR vector order. Flags stay set until the handler clears the cause.
+	while (Count < limit && !HalFake.InterruptsDisabled)
+	{
+		void (*Handler)() = nullptr;
+
+		if (HalFake.UsartReceiving && HalFake.UsartRxCount > 0 && HalFake.UsartReceiveHandler != nullptr)
+		{
+			HalFake.UsartData = HalFake.UsartRx[HalFake.UsartRxHead];
+			HalFake.UsartRxHead = (HalFake.UsartRxHead + 1) % HalFakeUsartBufferSize;
+			HalFake.UsartRxCount--;
+			Handler = HalFake.UsartReceiveHandler;
+		}
+		else if (HalFake.UsartEnabled && HalFake.UsartTransmitInterruptEnabled
+			&& HalFake.UsartTxCount < HalFakeUsartBufferSize && HalFake.UsartTransmitHandler != nullptr)
+		{
+			Handler = HalFake.UsartTransmitHandler;
+		}
+		else if (HalFake.TwiPending && HalFake.TwiInterruptEnabled && HalFake.TwiHandler != nullptr
+			&& HalFake.Millis >= HalFake.TwiHeldUntilMillis)
+		{
+			HalFake.TwiInterrupts++;
+			Handler = HalFake.TwiHandler;
+		}
+		else
+		{
+			break;
+		}
+
+		Count++;
+
+		HalFake.InterruptsDisabled = true;
+		Handler();
+		HalFake.InterruptsDisabled = false;
+	}
+
+	return Count;
+}
+
+// USART0, 8N1 bytes without timing.
+void HalFakeUsartEnable(const uint32_t baudRate, const bool receive)
+{
+	HalFake.UsartBaudRate = baudRate;
+	HalFake.UsartEnabled = true;
+	HalFake.UsartReceiving = receive;
+	HalFake.UsartTransmitInterruptEnabled = false;
+}
+
+void HalFakeUsartDisable()
+{
+	// Clearing RXEN flushes the receiver.
+	HalFake.UsartEnabled = false;
+	HalFake.UsartReceiving = false;
+	HalFake.UsartTransmitInterruptEnabled = false;
+	HalFake.UsartRxCount = 0;
+}
+
+void HalFakeUsartWrite(const uint8_t value)
+{
+	if (!HalFake.UsartEnabled || HalFake.UsartTxCount >= HalFakeUsartBufferSize)
+	{
+		return;
+	}
+
+	HalFake.UsartTx[(HalFake.UsartTxHead + HalFake.UsartTxCount) % HalFakeUsartBufferSize] = value;
+	HalFake.UsartTxCount++;
+	HalFake.UsartTxBytes++;
+}
+
+// TWI master, status codes as in util/twi.h.
+static HalFakeTwiDevice* HalFakeFindTwi(const uint8_t address)
+{
+	for (uint8_t i = 0; i < HalFakeState::TwiDeviceCount; i++)
+	{
+		if (HalFake.TwiDevices[i] != nullptr && HalFake.TwiDevices[i]->Address == address)
+		{
+			return HalFake.TwiDevices[i];
+		}
+	}
+
+	return nullptr;
+}
+
+static bool HalFakeTakeTwiFault(const HalFakeTwiFaultEnum fault)
+{
+	if (HalFake.TwiFault != (uint8_t)fault)
+	{
+		return false;
+	}
+
+	HalFake.TwiFault = (uint8_t)HalFakeTwiFaultEnum::None;
+
+	return true;
+}
+
+// Ends the transfer on the bus side, a write burst reaches the device at STOP.
+static void HalFakeEndTwi(const bool deliver)
+{
+	if (!HalFake.TwiBusOwned)
+	{
+		return;
+	}
+
+	if (deliver && !HalFake.TwiReading && HalFake.TwiTarget != nullptr && HalFake.TwiBurstLength > 0)
+	{
+		HalFake.TwiTarget->Write(HalFake.TwiRegister, HalFake.TwiBurst, HalFake.TwiBurstLength);
+	}
+
+	HalFake.TwiTransactions++;
+	HalFake.TwiBusOwned = false;
+	HalFake.TwiTarget = nullptr;
+	HalFake.TwiReading = false;
+	HalFake.TwiRegisterSet = false;
+	HalFake.TwiBurstLength = 0;
+}
+
+// Clears TWINT, sets it again with the outcome unless stalled.
+static bool HalFakeBeginTwiOperation(const bool interrupt)
+{
+	HalFake.TwiPending = false;
+	HalFake.TwiInterruptEnabled = interrupt;
+
+	if (!HalFake.TwiEnabled || HalFakeTakeTwiFault(HalFakeTwiFaultEnum::Stall))
+	{
+		return false;
+	}
+
+	if (HalFakeTakeTwiFault(HalFakeTwiFaultEnum::BusError))
+	{
+		HalFakeEndTwi(false);
+		HalFake.TwiStatus = (uint8_t)TwiStatusEnum::BusError;
+		HalFake.TwiPending = true;
+
+		return false;
+	}
+
+	HalFake.TwiPending = true;
+
+	return true;
+}
+
+void HalFakeTwiEnable(const uint8_t bitRate)
+{
+	HalFake.TwiBitRate = bitRate;
+	HalFake.TwiEnabled = true;
+	HalFake.TwiInterruptEnabled = false;
+	HalFake.TwiPending = false;
+}
+
+void HalFakeTwiDisable()
+{
+	HalFakeEndTwi(false);
+	HalFake.TwiEnabled = false;
+	HalFake.TwiInterruptEnabled = false;
+	HalFake.TwiPending = false;
+}
+
+void HalFakeTwiStart(const bool afterStop)
+{
+	if (afterStop)
+	{
+		HalFakeEndTwi(true);
+	}
+
+	if (!HalFakeBeginTwiOperation(true))
+	{
+		return;
+	}
+
+	if (HalFakeTakeTwiFault(HalFakeTwiFaultEnum::ArbitrationLost))
+	{
+		HalFakeEndTwi(false);
+		HalFake.TwiStatus = (uint8_t)TwiStatusEnum::ArbitrationLost;
+
+		return;
+	}
+
+	HalFake.TwiStatus = (uint8_t)(HalFake.TwiBusOwned ? TwiStatusEnum::RepeatedStart : TwiStatusEnum::Start);
+	HalFake.TwiBusOwned = true;
+	HalFake.TwiAddressNext = true;
+}
+
+void HalFakeTwiStop()
+{
+	HalFakeEndTwi(true);
+	HalFake.TwiPending = false;
+	HalFake.TwiInterruptEnabled = false;
+}
+
+void HalFakeTwiSend(const uint8_t value)
+{
+	if (!HalFakeBeginTwiOperation(true))
+	{
+		return;
+	}
+
+	if (HalFake.TwiAddressNext)
+	{
+		const bool Read = value & 0x01;
+		HalFake.TwiAddressNext = false;
+		HalFake.TwiTarget = HalFakeFindTwi(value >> 1);
+
+		if (HalFake.TwiTarget == nullptr || HalFakeTakeTwiFault(HalFakeTwiFaultEnum::AddressNack))
+		{
+			HalFake.TwiTarget = nullptr;
+			HalFake.TwiStatus = (uint8_t)(Read ? TwiStatusEnum::ReadAddressNack : TwiStatusEnum::WriteAddressNack);
+		}
+		else if (Read)
+		{
+			// The device serves the burst from its register pointer.
+			HalFake.TwiTarget->Read(HalFake.TwiRegister, HalFake.TwiBurst, HalFakeTwiBurstSize);
+			HalFake.TwiBurstLength = 0;
+			HalFake.TwiReading = true;
+			HalFake.TwiStatus = (uint8_t)TwiStatusEnum::ReadAddressAck;
+		}
+		else
+		{
+			HalFake.TwiRegisterSet = false;
+			HalFake.TwiBurstLength = 0;
+			HalFake.TwiReading = false;
+			HalFake.TwiStatus = (uint8_t)TwiStatusEnum::WriteAddressAck;
+		}
+	}
+	else if (HalFakeTakeTwiFault(HalFakeTwiFaultEnum::DataNack))
+	{
+		HalFake.TwiStatus = (uint8_t)TwiStatusEnum::WriteDataNack;
+	}
+	else
+	{
+		if (!HalFake.TwiRegisterSet)
+		{
+			HalFake.TwiRegister = value;
+			HalFake.TwiRegisterSet = true;
+		}
+		else if (HalFake.TwiBurstLength < HalFakeTwiBurstSize)
+		{
+			HalFake.TwiBurst[HalFake.TwiBurstLength++] = value;
+			HalFake.TwiBytes++;
+		}
+		HalFake.TwiStatus = (uint8_t)TwiStatusEnum::WriteDataAck;
+	}
+}
+
+void HalFakeTwiReceive(const bool ack)
+{
+	if (!HalFakeBeginTwiOperation(true))
+	{
+		return;
+	}
+
+	HalFake.TwiData = HalFake.TwiBurst[HalFake.TwiBurstLength % HalFakeTwiBurstSize];
+	HalFake.TwiBurstLength++;
+	HalFake.TwiBytes++;
+	HalFake.TwiStatus = (uint8_t)(ack ? TwiStatusEnum::ReadDataAck : TwiStatusEnum::ReadDataNack);
+}
+#endif
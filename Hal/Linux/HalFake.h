@@ -0,0 +1,153 @@
+// HalFake.h
+
+#ifndef _HALFAKE_h
+#define _HALFAKE_h
+
+#include <stdint.h>
+
+class HalFakeTwiDevice;
+
+static const uint8_t HalFakeTwiBurstSize = 32;
+static const uint8_t HalFakeUsartBufferSize = 64;
+
+// Injected on the next bus operation it applies to.
+enum class HalFakeTwiFaultEnum : uint8_t
+{
+	None,
+	AddressNack,
+	DataNack,
+	ArbitrationLost,
+	BusError,
+	// Operation never completes, no interrupt.
+	Stall
+};
+
+// Simulated hardware state for off-target builds.
+// Tests and benchmarks drive inputs and read back the counters.
+struct HalFakeState
+{
+	static const uint8_t PinCount = 20;
+	static const uint16_t EepromSize = 1024;
+	static const uint8_t TwiDeviceCount = 4;
+
+	// Advanced by HalTime::Delay and HalTwi::Poll.
+	uint32_t Millis;
+
+	// Set by noInterrupts(), simulated interrupts are held while set.
+	bool InterruptsDisabled;
+
+	// RAM figures reported by MemoryMonitor, see LinuxMemoryMonitor.h.
+	uint16_t FreeRam;
+	uint16_t StackHeadroom;
+
+	// Watchdog, see Test/Fakes/avr/wdt.h.
+	bool WatchdogEnabled;
+	uint8_t WatchdogTimeout;
+	uint32_t WatchdogKicks;
+
+	// CPU clock and timebase, see LinuxClockGovernor.h and LinuxTimebase.h.
+	uint8_t ClockShift;
+	uint8_t FineRequests;
+	bool Coarse;
+	uint32_t CoarseSinceMillis;
+	uint32_t TimebaseSwitches;
+
+	// GPIO.
+	bool PinLevel[PinCount];
+	bool PinOutput[PinCount];
+	bool PinPullup[PinCount];
+	uint32_t PinWrites;
+
+	// Pin change interrupts, handler per port as on AVR.
+	void (*PinChangeHandler[3])();
+	bool PinChangeEnabled[PinCount];
+
+	// INT0 and INT1.
+	void (*InterruptHandler[2])();
+	uint8_t InterruptSense[2];
+	bool InterruptEnabled[2];
+	// Edges latched while masked, like EIFR.
+	bool InterruptFlag[2];
+	uint32_t InterruptAttaches;
+
+	// Bit per PeripheralEnum, set if powered.
+	uint8_t PoweredMask;
+	uint32_t PowerSwitches;
+
+	uint8_t Eeprom[EepromSize];
+	uint32_t EepromReads;
+	uint32_t EepromWrites;
+
+	// Devices on the bus, see HalFakeTwiDevice.h.
+	HalFakeTwiDevice* TwiDevices[TwiDeviceCount];
+	uint32_t TwiTransactions;
+	uint32_t TwiBytes;
+	uint32_t TwiInterrupts;
+
+	// TWI peripheral, see LinuxTwi.h.
+	void (*TwiHandler)();
+	uint8_t TwiBitRate;
+	bool TwiEnabled;
+	bool TwiInterruptEnabled;
+	// TWINT, set when a bus operation is done.
+	bool TwiPending;
+	uint8_t TwiStatus;
+	uint8_t TwiData;
+	// One shot, HalFakeTwiFaultEnum.
+	uint8_t TwiFault;
+	// The interrupt is held back until then, as by a slave stretching the clock.
+	uint32_t TwiHeldUntilMillis;
+
+	// Bus side of the transfer in progress.
+	HalFakeTwiDevice* TwiTarget;
+	bool TwiBusOwned;
+	bool TwiAddressNext;
+	bool TwiReading;
+	bool TwiRegisterSet;
+	uint8_t TwiRegister;
+	uint8_t TwiBurst[HalFakeTwiBurstSize];
+	uint8_t TwiBurstLength;
+
+	// USART0, see LinuxUsart.h.
+	void (*UsartReceiveHandler)();
+	void (*UsartTransmitHandler)();
+	uint32_t UsartBaudRate;
+	bool UsartEnabled;
+	bool UsartReceiving;
+	bool UsartTransmitInterruptEnabled;
+	// Received byte, as in UDR0 during the RX interrupt.
+	uint8_t UsartData;
+	// Bytes on the RX line, not yet received.
+	uint8_t UsartRx[HalFakeUsartBufferSize];
+	uint8_t UsartRxHead;
+	uint8_t UsartRxCount;
+	uint32_t UsartRxDropped;
+	// Bytes sent on TX, not yet taken with HalFakeReadUsart. Full holds the transmitter.
+	uint8_t UsartTx[HalFakeUsartBufferSize];
+	uint8_t UsartTxHead;
+	uint8_t UsartTxCount;
+	uint32_t UsartTxBytes;
+};
+
+extern HalFakeState HalFake;
+
+// Powers everything, erased EEPROM, all pins low inputs, ample RAM.
+void HalFakeReset();
+
+// Sets a pin level as seen by FastPin::Read.
+// Fires its external interrupt if the edge matches, and its pin change interrupt on any change.
+void HalFakeSetPin(const uint8_t pin, const bool level);
+
+// Puts a device model on the simulated bus. Returns false if the bus is full.
+bool HalFakeAttachTwi(HalFakeTwiDevice* device);
+
+// Puts a byte on the USART RX line. Dropped if the receiver is off or the line buffer is full.
+bool HalFakeWriteUsart(const uint8_t value);
+
+// Takes the oldest byte sent on USART TX. Returns false if there is none.
+bool HalFakeReadUsart(uint8_t& value);
+
+// Runs pending peripheral interrupts (USART RX, USART UDRE, TWI), unless held by noInterrupts().
+// Each handler may start the next operation, up to limit interrupts are run. Returns the number run.
+uint16_t HalFakeRunInterrupts(const uint16_t limit = UINT16_MAX);
+#endif
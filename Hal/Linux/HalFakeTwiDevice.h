@@ -0,0 +1,55 @@
+// HalFakeTwiDevice.h
+
+#ifndef _HALFAKETWIDEVICE_h
+#define _HALFAKETWIDEVICE_h
+
+#include <stdint.h>
+#include <string.h>
+
+// Register level model of an I2C slave, on the bus of the Linux HalTwi model.
+// Models keep the datasheet register map, so drivers run unmodified against them.
+class HalFakeTwiDevice
+{
+public:
+	static const uint8_t RegisterCount = 128;
+
+	const uint8_t Address;
+
+	uint8_t Registers[RegisterCount];
+	uint32_t RegisterWrites = 0;
+
+public:
+	HalFakeTwiDevice(const uint8_t address)
+		: Address(address)
+	{
+		memset(Registers, 0, sizeof(Registers));
+	}
+
+	// Burst access, the register pointer auto-increments.
+	virtual void Write(const uint8_t reg, const uint8_t* data, const uint8_t length)
+	{
+		for (uint8_t i = 0; i < length; i++)
+		{
+			OnWrite((reg + i) % RegisterCount, data[i]);
+		}
+	}
+
+	virtual void Read(const uint8_t reg, uint8_t* data, const uint8_t length)
+	{
+		for (uint8_t i = 0; i < length; i++)
+		{
+			data[i] = Registers[(reg + i) % RegisterCount];
+		}
+	}
+
+	// Typical supply current in the configured power mode, from the datasheet.
+	virtual uint32_t GetSupplyNanoAmps() = 0;
+
+protected:
+	virtual void OnWrite(const uint8_t reg, const uint8_t value)
+	{
+		Registers[reg] = value;
+		RegisterWrites++;
+	}
+};
+#endif
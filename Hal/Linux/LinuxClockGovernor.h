@@ -0,0 +1,61 @@
+// LinuxClockGovernor.h
+
+#ifndef _LINUXCLOCKGOVERNOR_h
+#define _LINUXCLOCKGOVERNOR_h
+
+#include <stdint.h>
+
+#include "HalFake.h"
+
+// Same interface as the AVR ClockGovernor, the prescaler is HalFake.ClockShift.
+class ClockGovernor
+{
+public:
+	static const uint32_t TwiClockSpeed = 400000;
+
+	// 1 MHz.
+	static const uint8_t SlowShift = 3;
+
+public:
+	static uint8_t GetShift()
+	{
+		return HalFake.ClockShift;
+	}
+
+	static bool IsSlow()
+	{
+		return GetShift() != 0;
+	}
+
+	static uint32_t GetCpuHz()
+	{
+		return F_CPU >> GetShift();
+	}
+
+	static void SetFast()
+	{
+		HalFake.ClockShift = 0;
+		HalFake.TwiBitRate = GetTwiBitRate(F_CPU);
+	}
+
+	static void SetSlow()
+	{
+#ifndef DEBUG_LOG
+		HalFake.ClockShift = SlowShift;
+		HalFake.TwiBitRate = GetTwiBitRate(F_CPU >> SlowShift);
+#endif
+	}
+
+	static uint8_t GetTwiBitRate(const uint32_t cpuHz)
+	{
+		const uint32_t Divider = cpuHz / TwiClockSpeed;
+
+		if (Divider <= 16)
+		{
+			return 0;
+		}
+
+		return (Divider - 16) / 2;
+	}
+};
+#endif
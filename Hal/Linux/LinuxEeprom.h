@@ -0,0 +1,54 @@
+// LinuxEeprom.h
+
+#ifndef _LINUXEEPROM_h
+#define _LINUXEEPROM_h
+
+#include <stdint.h>
+
+#include "HalFake.h"
+
+// EEPROM in RAM, counts cell writes for wear estimates.
+class HalEeprom
+{
+public:
+	static uint8_t Read(const uint16_t address)
+	{
+		HalFake.EepromReads++;
+
+		return HalFake.Eeprom[address % HalFakeState::EepromSize];
+	}
+
+	static void Update(const uint16_t address, const uint8_t value)
+	{
+		uint8_t& Cell = HalFake.Eeprom[address % HalFakeState::EepromSize];
+
+		if (Cell != value)
+		{
+			Cell = value;
+			HalFake.EepromWrites++;
+		}
+	}
+
+	template<typename T>
+	static void Get(const uint16_t address, T& value)
+	{
+		uint8_t* Bytes = (uint8_t*)&value;
+
+		for (uint16_t i = 0; i < sizeof(T); i++)
+		{
+			Bytes[i] = Read(address + i);
+		}
+	}
+
+	template<typename T>
+	static void Put(const uint16_t address, const T& value)
+	{
+		const uint8_t* Bytes = (const uint8_t*)&value;
+
+		for (uint16_t i = 0; i < sizeof(T); i++)
+		{
+			Update(address + i, Bytes[i]);
+		}
+	}
+};
+#endif
@@ -0,0 +1,15 @@
+// LinuxFlash.h
+
+#ifndef _LINUXFLASH_h
+#define _LINUXFLASH_h
+
+#include <stdint.h>
+#include <string.h>
+
+// Single address space, program memory tables are plain constants.
+#define PROGMEM
+#define memcpy_P memcpy
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+#define pgm_read_dword(address) (*(const uint32_t*)(address))
+#endif
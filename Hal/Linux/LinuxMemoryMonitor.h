@@ -0,0 +1,31 @@
+// LinuxMemoryMonitor.h
+
+#ifndef _LINUXMEMORYMONITOR_h
+#define _LINUXMEMORYMONITOR_h
+
+#include <stdint.h>
+
+#include "HalFake.h"
+
+// Same interface as the AVR MemoryMonitor, reports HalFake.FreeRam and HalFake.StackHeadroom.
+class MemoryMonitor
+{
+public:
+	static const uint8_t StackCanary = 0xC5;
+
+public:
+	MemoryMonitor()
+	{
+	}
+
+	uint16_t GetFreeRam()
+	{
+		return HalFake.FreeRam;
+	}
+
+	uint16_t GetStackHeadroom()
+	{
+		return HalFake.StackHeadroom;
+	}
+};
+#endif
@@ -0,0 +1,124 @@
+// LinuxPin.h
+
+#ifndef _LINUXPIN_h
+#define _LINUXPIN_h
+
+#include <stdint.h>
+
+#include "HalFake.h"
+
+// Same interface as the AVR FastPin, on the simulated pin state.
+template<const uint8_t Pin>
+class FastPin
+{
+	static_assert(Pin < HalFakeState::PinCount, "ATmega328P has digital pins 0 to 19.");
+
+public:
+	static const uint8_t Mask = 1 << (Pin < 8 ? Pin : (Pin < 14 ? Pin - 8 : Pin - 14));
+
+public:
+	static void SetInput()
+	{
+		HalFake.PinOutput[Pin] = false;
+		HalFake.PinPullup[Pin] = false;
+	}
+
+	static void SetInputPullup()
+	{
+		HalFake.PinOutput[Pin] = false;
+		HalFake.PinPullup[Pin] = true;
+	}
+
+	static void SetOutput()
+	{
+		HalFake.PinOutput[Pin] = true;
+	}
+
+	static bool Read()
+	{
+		return HalFake.PinLevel[Pin];
+	}
+
+	static void High()
+	{
+		HalFake.PinWrites++;
+		if (HalFake.PinOutput[Pin])
+		{
+			HalFake.PinLevel[Pin] = true;
+		}
+		else
+		{
+			HalFake.PinPullup[Pin] = true;
+		}
+	}
+
+	static void Low()
+	{
+		HalFake.PinWrites++;
+		if (HalFake.PinOutput[Pin])
+		{
+			HalFake.PinLevel[Pin] = false;
+		}
+		else
+		{
+			HalFake.PinPullup[Pin] = false;
+		}
+	}
+};
+
+// Fired by HalFakeSetPin.
+template<const uint8_t Pin>
+class ExternalInterrupt
+{
+	static_assert(Pin == 2 || Pin == 3, "Only pins 2 (INT0) and 3 (INT1) have external interrupts.");
+
+private:
+	static const uint8_t Number = Pin - 2;
+
+public:
+	enum SenseEnum : uint8_t
+	{
+		Low = 0,
+		Change = 1,
+		Falling = 2,
+		Rising = 3
+	};
+
+	static void Attach(void (*handler)(), const SenseEnum sense)
+	{
+		HalFake.InterruptAttaches++;
+		HalFake.InterruptHandler[Number] = handler;
+		HalFake.InterruptSense[Number] = sense;
+
+		// Stale latched edge is dropped, as on AVR.
+		HalFake.InterruptFlag[Number] = false;
+		HalFake.InterruptEnabled[Number] = true;
+	}
+
+	static void Detach()
+	{
+		HalFake.InterruptEnabled[Number] = false;
+	}
+};
+// Fired by HalFakeSetPin on any change. Pins on the same port share one handler.
+template<const uint8_t Pin>
+class PinChangeInterrupt
+{
+	static_assert(Pin < HalFakeState::PinCount, "ATmega328P has digital pins 0 to 19.");
+
+private:
+	static const uint8_t Group = Pin < 8 ? 2 : (Pin < 14 ? 0 : 1);
+
+public:
+	static void Attach(void (*handler)())
+	{
+		HalFake.PinChangeHandler[Group] = handler;
+		HalFake.PinChangeEnabled[Pin] = true;
+	}
+
+	static void Detach()
+	{
+		HalFake.PinChangeEnabled[Pin] = false;
+	}
+};
+#endif
@@ -0,0 +1,24 @@
+// LinuxPower.h
+
+#ifndef _LINUXPOWER_h
+#define _LINUXPOWER_h
+
+#include "HalFake.h"
+
+// Tracks which peripherals are powered, and how often they are switched.
+class HalPower
+{
+public:
+	static void Enable(const PeripheralEnum peripheral)
+	{
+		HalFake.PowerSwitches++;
+		HalFake.PoweredMask |= 1 << (uint8_t)peripheral;
+	}
+
+	static void Disable(const PeripheralEnum peripheral)
+	{
+		HalFake.PowerSwitches++;
+		HalFake.PoweredMask &= ~(1 << (uint8_t)peripheral);
+	}
+};
+#endif
@@ -0,0 +1,19 @@
+// LinuxTime.h
+
+#ifndef _LINUXTIME_h
+#define _LINUXTIME_h
+
+#include <stdint.h>
+
+#include "HalFake.h"
+
+// Waits return at once, simulated time moves on.
+class HalTime
+{
+public:
+	static void Delay(const uint32_t millis)
+	{
+		HalFake.Millis += millis;
+	}
+};
+#endif
@@ -0,0 +1,92 @@
+// LinuxTimebase.h
+
+#ifndef _LINUXTIMEBASE_h
+#define _LINUXTIMEBASE_h
+
+#include <stdint.h>
+
+#include "HalFake.h"
+#include "LinuxClockGovernor.h"
+
+// Same interface as the AVR Timebase, on HalFake.Millis.
+// Coarse resolution is kept: Millis() only advances in CoarseTickMillis steps from the switch,
+// so tasks wake on the same ticks as on the device.
+class Timebase
+{
+public:
+	enum ClientEnum : uint8_t
+	{
+		Light = 1 << 0,
+		Buzzer = 1 << 1,
+		Diagnostics = 1 << 2,
+		AuxLight = 1 << 3,
+		Notifier = 1 << 4,
+		Gyro = 1 << 5
+	};
+
+	static const uint8_t CoarseTickMillis = 16;
+
+public:
+	static void Setup()
+	{
+		if (HalFake.FineRequests == 0)
+		{
+			EnterCoarse();
+		}
+	}
+
+	static uint32_t Millis()
+	{
+		if (!HalFake.Coarse)
+		{
+			return HalFake.Millis;
+		}
+
+		const uint32_t Elapsed = HalFake.Millis - HalFake.CoarseSinceMillis;
+
+		return HalFake.CoarseSinceMillis + (Elapsed - (Elapsed % CoarseTickMillis));
+	}
+
+	static bool IsFine()
+	{
+		return HalFake.FineRequests != 0;
+	}
+
+	static void RequestFine(const ClientEnum client)
+	{
+		if (HalFake.FineRequests == 0)
+		{
+			EnterFine();
+		}
+		HalFake.FineRequests |= client;
+	}
+
+	static void ReleaseFine(const ClientEnum client)
+	{
+		if (HalFake.FineRequests != 0)
+		{
+			HalFake.FineRequests &= ~client;
+			if (HalFake.FineRequests == 0)
+			{
+				EnterCoarse();
+			}
+		}
+	}
+
+private:
+	static void EnterCoarse()
+	{
+		HalFake.TimebaseSwitches++;
+		HalFake.Coarse = true;
+		HalFake.CoarseSinceMillis = HalFake.Millis;
+		ClockGovernor::SetSlow();
+	}
+
+	static void EnterFine()
+	{
+		HalFake.TimebaseSwitches++;
+		HalFake.Coarse = false;
+		ClockGovernor::SetFast();
+	}
+};
+#endif
@@ -0,0 +1,78 @@
+// LinuxTwi.h
+
+#ifndef _LINUXTWI_h
+#define _LINUXTWI_h
+
+#include <stdint.h>
+
+#include "HalFake.h"
+
+// Peripheral model, in HalFake.cpp.
+void HalFakeTwiEnable(const uint8_t bitRate);
+void HalFakeTwiDisable();
+void HalFakeTwiStart(const bool afterStop);
+void HalFakeTwiStop();
+void HalFakeTwiSend(const uint8_t value);
+void HalFakeTwiReceive(const bool ack);
+
+// Same interface as the AVR HalTwi, on a model of the TWI master and the devices attached with HalFakeAttachTwi.
+// Operations complete at once, the interrupt is held until HalFakeRunInterrupts.
+// Unknown addresses are not acknowledged, faults are injected with HalFake.TwiFault.
+class HalTwi
+{
+public:
+	static void Attach(void (*handler)())
+	{
+		HalFake.TwiHandler = handler;
+	}
+
+	static void Enable(const uint8_t bitRate)
+	{
+		HalFakeTwiEnable(bitRate);
+	}
+
+	static void Disable()
+	{
+		HalFakeTwiDisable();
+	}
+
+	static void Start(const bool afterStop)
+	{
+		HalFakeTwiStart(afterStop);
+	}
+
+	static void Stop()
+	{
+		HalFakeTwiStop();
+	}
+
+	static void Send(const uint8_t value)
+	{
+		HalFakeTwiSend(value);
+	}
+
+	static void Receive(const bool ack)
+	{
+		HalFakeTwiReceive(ack);
+	}
+
+	static uint8_t GetData()
+	{
+		return HalFake.TwiData;
+	}
+
+	static uint8_t GetStatus()
+	{
+		return HalFake.TwiStatus;
+	}
+
+	// Busy waits see the interrupts, or time passing.
+	static void Poll()
+	{
+		if (HalFakeRunInterrupts() == 0)
+		{
+			HalFake.Millis++;
+		}
+	}
+};
+#endif
@@ -0,0 +1,75 @@
+// LinuxUsart.h
+
+#ifndef _LINUXUSART_h
+#define _LINUXUSART_h
+
+#include <stdint.h>
+
+#include "HalFake.h"
+
+// Peripheral model, in HalFake.cpp.
+void HalFakeUsartEnable(const uint32_t baudRate, const bool receive);
+void HalFakeUsartDisable();
+void HalFakeUsartWrite(const uint8_t value);
+
+// Same interface as the AVR HalUsart, on a byte level model of USART0.
+// The test side feeds RX with HalFakeWriteUsart and drains TX with HalFakeReadUsart.
+// Interrupts are held until HalFakeRunInterrupts.
+class HalUsart
+{
+public:
+	static void AttachReceive(void (*handler)())
+	{
+		HalFake.UsartReceiveHandler = handler;
+	}
+
+	static void AttachTransmit(void (*handler)())
+	{
+		HalFake.UsartTransmitHandler = handler;
+	}
+
+	static void Enable(const uint32_t baudRate, const bool receive)
+	{
+		HalFakeUsartEnable(baudRate, receive);
+	}
+
+	static void Disable()
+	{
+		HalFakeUsartDisable();
+	}
+
+	static void EnableTransmitInterrupt()
+	{
+		HalFake.UsartTransmitInterruptEnabled = true;
+	}
+
+	static void DisableTransmitInterrupt()
+	{
+		HalFake.UsartTransmitInterruptEnabled = false;
+	}
+
+	static void Write(const uint8_t value)
+	{
+		HalFakeUsartWrite(value);
+	}
+
+	static uint8_t Read()
+	{
+		return HalFake.UsartData;
+	}
+
+	static bool IsTransmitReady()
+	{
+		return HalFake.UsartTxCount < HalFakeUsartBufferSize;
+	}
+
+	// Busy waits see the interrupts, or time passing.
+	static void Poll()
+	{
+		if (HalFakeRunInterrupts() == 0)
+		{
+			HalFake.Millis++;
+		}
+	}
+};
+#endif
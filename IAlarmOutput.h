@@ -8,9 +8,33 @@
 class IAlarmOutput
 {
 public:
+	// Bit per command, for outputs that only implement some of them.
+	enum PatternEnum : uint8_t
+	{
+		Generic = 1 << 0,
+		Error = 1 << 1,
+		NotArmed = 1 << 2,
+		Arming = 1 << 3,
+		ArmingFailed = 1 << 4,
+		Armed = 1 << 5,
+		EarlyWarning = 1 << 6,
+		Alarm = 1 << 7
+	};
+
+	static const uint8_t AllPatterns = 0xFF;
+
+	// Patterns this output plays, the others are no-ops. See AlarmOutputGroup.
+	virtual uint8_t GetPatterns() { return AllPatterns; }
+
 	virtual void Buzz(const uint32_t durationMillis) {}
 	virtual void Stop() {}
 
+	// 0 is empty, 255 is full. Outputs may degrade to save energy.
+	virtual void SetEnergyLevel(const uint8_t level) {}
+
+	// Primed outputs keep their hardware set up while idle, so the next Play starts without setup.
+	virtual void SetPrimed(const bool primed) {}
+
 	virtual void PlayError() {}
 	virtual void PlayArmed() {}
 	virtual void PlayArming() {}
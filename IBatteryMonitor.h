@@ -0,0 +1,19 @@
+// IBatteryMonitor.h
+
+#ifndef _IBATTERYMONITOR_h
+#define _IBATTERYMONITOR_h
+
+#include <stdint.h>
+
+class IBatteryMonitor
+{
+public:
+	static const uint8_t EnergyLevelFull = 255;
+
+public:
+	virtual uint16_t GetMilliVolts() { return 0; }
+
+	// Linear energy estimate, 0 is empty and EnergyLevelFull is full.
+	virtual uint8_t GetEnergyLevel() { return EnergyLevelFull; }
+};
+#endif
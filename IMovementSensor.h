@@ -6,12 +6,30 @@
 
 #include <stdint.h>
 
+struct MovementSensorConfiguration
+{
+	int16_t XOffset;
+	int16_t YOffset;
+	int16_t ZOffset;
+	uint8_t MotionThreshold;
+	uint8_t MotionDuration;
+};
+
 class IMovementSensor
 {
 public:
 	virtual void Disable() {}
 	virtual void Enable() {}
 	virtual bool HasRecentSignificantMotion(const uint32_t period) { return false;  }
+
+	virtual uint16_t GetMotionEventCount() { return 0; }
+
+	// Motion events within the last period.
+	virtual uint16_t GetMotionDensity(const uint32_t period) { return 0; }
+
+	// Accelerometer wakes confirmed as rotation, if confirmation is enabled.
+	virtual uint16_t GetRotationEventCount() { return 0; }
+	virtual void GetConfiguration(MovementSensorConfiguration& configuration) {}
 };
 
 #endif
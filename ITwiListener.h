@@ -0,0 +1,14 @@
+// ITwiListener.h
+
+#ifndef _ITWILISTENER_h
+#define _ITWILISTENER_h
+
+#include <stdint.h>
+
+class ITwiListener
+{
+public:
+	// Called from the TWI driver task, after the transfer.
+	virtual void OnTwiComplete(const uint8_t token, const bool success) {}
+};
+#endif
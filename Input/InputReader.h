@@ -10,22 +10,27 @@
 
 #include <Arduino.h>
 
-#include "..\IInputReader.h"
+#include "../IInputReader.h"
 
-#include "..\Event\EventTask.h"
+#include "../Event/EventTask.h"
+#include "../Timebase/Timebase.h"
+#include "../Hal/Hal.h"
 
-class InputReader : EventTask, public virtual IInputReader
+template<const uint8_t ArmPin, typename EventBus = RuntimeEventBus>
+class InputReader : EventTask<EventBus>, public virtual IInputReader
 {
 private:
+	typedef FastPin<ArmPin> Pin;
+	typedef ExternalInterrupt<ArmPin> Interrupt;
+
+	static InputReader* Instance;
+
 	enum StateEnum : uint8_t
 	{
 		Disabled,
 		Active,
 	};
 
-	const uint8_t ArmPin;
-	const uint8_t ArmInterruptPin;
-
 	const uint32_t DebounceDuration = 300;
 
 	bool DebouncedArmSignal = false;
@@ -36,20 +41,18 @@ private:
 	volatile bool InterruptPending = false;
 
 public:
-	InputReader(Scheduler* scheduler, const uint8_t armInterruptPin)
-		: EventTask(scheduler)
+	InputReader(Scheduler* scheduler)
+		: EventTask<EventBus>(scheduler)
 		, IInputReader()
-		, ArmPin(armInterruptPin)
-		, ArmInterruptPin(digitalPinToInterrupt(ArmPin))
 	{
-		pinMode(ArmPin, INPUT);
+		Pin::SetInput();
 	}
 
 	virtual void Enable()
 	{
 		if (State != StateEnum::Active)
 		{
-			DebouncedArmSignal = digitalRead(ArmPin);
+			DebouncedArmSignal = Pin::Read();
 			LastEmittedEvent = !DebouncedArmSignal;
 			ResetToIdle();
 			AttachInterrupt();
@@ -61,28 +64,21 @@ public:
 		if (State != StateEnum::Disabled)
 		{
 			State = StateEnum::Disabled;
-			detachInterrupt(ArmInterruptPin);
+			Interrupt::Detach();
 			Task::disable();
 		}
 	}
 
-	virtual bool Setup(IEventListener* eventListener)
+	virtual bool Setup(IEventListener* eventListener = nullptr)
 	{
-		if (!EventTask::Setup(eventListener))
+		if (!EventTask<EventBus>::Setup(eventListener))
 		{
 			return false;
 		}
 
 		Disable();
 
-		if (ArmInterruptPin != NOT_AN_INTERRUPT)
-		{
-			return true;
-		}
-		else
-		{
-			return false;
-		}
+		return true;
 	}
 
 	bool Callback()
@@ -90,7 +86,7 @@ public:
 		switch (State)
 		{
 		case StateEnum::Disabled:
-			detachInterrupt(ArmInterruptPin);
+			Interrupt::Detach();
 			Task::disable();
 			break;
 		case StateEnum::Active:
@@ -99,10 +95,10 @@ public:
 				InterruptPending = false;
 			}
 
-			if (millis() - ArmPinLastChanged >= DebounceDuration)
+			if (Timebase::Millis() - ArmPinLastChanged >= DebounceDuration)
 			{
 				// Debounce duration without pin change has occured.
-				UpdateDebouncedArmSignal(digitalRead(ArmPin));
+				UpdateDebouncedArmSignal(Pin::Read());
 				ResetToIdle();
 			}
 			else if (InterruptPending)
@@ -114,7 +110,7 @@ public:
 			else
 			{
 				// Sleep the remaining debounce period.
-				Task::delay(DebounceDuration - (millis() - ArmPinLastChanged));
+				Task::delay(DebounceDuration - (Timebase::Millis() - ArmPinLastChanged));
 			}
 		default:
 			break;
@@ -138,7 +134,7 @@ public:
 			Disable();
 			break;
 		case StateEnum::Active:
-			ArmPinLastChanged = millis();
+			ArmPinLastChanged = Timebase::Millis();
 			InterruptPending = true;
 			Task::enableIfNot();
 			Task::delay(DebounceDuration);
@@ -150,24 +146,35 @@ public:
 	}
 
 private:
-	void AttachInterrupt();
+	static void OnInterrupt()
+	{
+		Instance->OnArmPinInterrupt();
+	}
+
+	void AttachInterrupt()
+	{
+		Instance = this;
+		Interrupt::Attach(OnInterrupt, Interrupt::SenseEnum::Change);
+	}
 
 	void UpdateDebouncedArmSignal(const bool on)
 	{
+		// Enable reads the pin undebounced, a change back within the first debounce still fires.
+		const bool Changed = DebouncedArmSignal != on;
 		DebouncedArmSignal = on;
 
 		// Only fire event if value has changed.
-		if (LastEmittedEvent != DebouncedArmSignal)
+		if (Changed || LastEmittedEvent != DebouncedArmSignal)
 		{
 			LastEmittedEvent = DebouncedArmSignal;
-			EventListener->OnEvent();
+			EventBus::Publish();
 		}
 	}
 
 	void ResetToIdle()
 	{
 		// Last minute check, before we sleep.
-		if (digitalRead(ArmPin) != LastEmittedEvent)
+		if (Pin::Read() != LastEmittedEvent)
 		{
 			State = StateEnum::Active;
 			Task::enableIfNot();
@@ -180,4 +187,7 @@ private:
 		}
 	}
 };
+
+template<const uint8_t ArmPin, typename EventBus>
+InputReader<ArmPin, EventBus>* InputReader<ArmPin, EventBus>::Instance = nullptr;
 #endif
\ No newline at end of file
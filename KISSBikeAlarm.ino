@@ -6,19 +6,28 @@
 	Dependecies
 		- Task Scheduler: https://github.com/arkhipenko/TaskScheduler
 		- TimerOne: https://github.com/PaulStoffregen/TimerOne
-		- Light WS2812: https://github.com/cpldcpu/light_ws2812
-		- Accelerometer: https://github.com/ElectronicCats/mpu6050
 
 	MCU
 		- ATMega328P (3.3 V) @ 8 Mhz.
 
 	*/
 
-	//#define DEBUG_LOG
+	//#define DEBUG_LOG // Binary trace records on USART, decoded on the host (see Diagnostics/TraceLog.h).
 	//#define DEBUG_STATE
 	//#define DEBUG_SENSOR
+	//#define DEBUG_MEMORY
+	//#define DEBUG_BATTERY
 	//#define WAIT_FOR_LOGGER
 
+	//#define DIAGNOSTIC_PORT // Binary diagnostics on USART, woken by a break on RX. Exclusive with DEBUG_LOG.
+	//#define GYRO_CONFIRMATION // Gyro burst after each accelerometer wake, to catch rolling and turning.
+	//#define LIS3DH_SENSOR // LIS3DH wake-on-motion accelerometer instead of the MPU6050, INT1 on pin 3. Exclusive with GYRO_CONFIRMATION.
+	//#define LIGHT_USART_OUTPUT // WS2812 on TXD (pin 1) via USART SPI master, interrupts masked only per SPI byte hand-off. Exclusive with DEBUG_LOG and DIAGNOSTIC_PORT.
+	//#define SCHEDULING_MONITOR // Start delay histograms per scheduler layer, read with DIAGNOSTIC_PORT.
+	//#define HORN_RELAY // External horn relay on pin 7, full alarm only.
+	//#define AUX_LIGHT // Second WS2812 channel, bit-banged on pin 6.
+	//#define ALARM_NOTIFIER // State change frames to a GSM/LoRa module on USART. Exclusive with DEBUG_LOG, DIAGNOSTIC_PORT and LIGHT_USART_OUTPUT.
+
 
 #define SERIAL_BAUD_RATE 115200
 
@@ -26,63 +35,156 @@
 
 #define _TASK_OO_CALLBACKS
 #define _TASK_SLEEP_ON_IDLE_RUN // Enable 1 ms SLEEP_IDLE powerdowns between tasks if no callback methods were invoked during the pass.
+#define _TASK_EXTERNAL_TIME // Scheduler runs on Timebase::Millis(), coarse 16 ms ticks while parked.
+#define _TASK_PRIORITY // Alarm logic and audio in a high priority layer, see SchedulerHigh.
+#ifdef SCHEDULING_MONITOR
+#define _TASK_TIMECRITICAL // Start delay per pass.
+#endif
 
 
 #include <TaskScheduler.h>
 
-#include <Wire.h>
-#include <avr/power.h>
-
-#include "Buzzer\AlarmBuzzer.h"
-#include "Light\AlarmLight.h"
-#include "MovementSensor\MovementSensor.h"
-#include "Input\InputReader.h"
+#include "Hal/Hal.h"
+
+#include "Buzzer/AlarmBuzzer.h"
+#include "Light/AlarmLight.h"
+#include "Output/AlarmOutputGroup.h"
+#include "Output/HornRelay.h"
+#include "Notification/AlarmNotifier.h"
+#include "Twi/TwiDriver.h"
+#include "MovementSensor/MovementSensor.h"
+#include "Input/InputReader.h"
+#include "Battery/BatteryMonitor.h"
+#include "Diagnostics/PersistentLog.h"
+#include "Diagnostics/TraceLog.h"
+#include "Watchdog/WatchdogRecovery.h"
+#include "Timebase/Timebase.h"
 #include "AlarmManager.h"
 
+#ifdef DIAGNOSTIC_PORT
+#include "Diagnostics/DiagnosticPort.h"
+#endif
+
 
 
 
-// Process scheduler.
+// Process schedulers.
+// The whole high priority chain runs between any two base tasks, so a light animation pass
+// delays alarm logic and audio by at most one base task.
 Scheduler SchedulerBase;
+Scheduler SchedulerHigh;
 //
 
-// IIC Master.
-// Statically declared in Wire.h
-//TwoWire Wire;
+// Event routing from the sensors to their subscribers, fixed at compile time (see Event/EventBus.h).
+// More subscribers (e.g. a journal or telemetry) are appended to the list.
+extern AlarmManager Manager;
+typedef StaticEventBus<EventSubscriber<AlarmManager, &Manager>> AlarmEvents;
+//
+
+// IIC Master, asynchronous.
+TwiDriver Twi(&SchedulerBase);
 //
 
 // Buzzer task.
-AlarmBuzzer Buzzer(&SchedulerBase, 9);
+AlarmBuzzer<9> Buzzer(&SchedulerHigh);
 //
 
 // Light task.
-AlarmLight Light(&SchedulerBase, 5);
+#ifdef LIGHT_USART_OUTPUT
+AlarmLight<UsartPixelOutput> Light(&SchedulerBase);
+#else
+AlarmLight<BitBangPixelOutput<5>> Light(&SchedulerBase);
+#endif
 // 
 
+#ifdef AUX_LIGHT
+// Second light task.
+AlarmLight<BitBangPixelOutput<6>, 1, Timebase::ClientEnum::AuxLight> AuxLight(&SchedulerBase);
+//
+#endif
+
+#ifdef HORN_RELAY
+// External horn.
+HornRelay<7> Horn;
+//
+#endif
+
+#ifdef ALARM_NOTIFIER
+// Notification task.
+AlarmNotifier Notifier(&SchedulerBase);
+//
+#endif
+
+// All outputs, driven together by the manager.
+AlarmOutputGroup<5> Outputs;
+//
+
 // Input controls task.
-InputReader Reader(&SchedulerBase, 2);
+InputReader<2, AlarmEvents> Reader(&SchedulerBase);
 //
 
+#ifdef LIS3DH_SENSOR
+// Accelerometer task.
+MovementSensor<3, LIS3DHSensor, AlarmEvents> Sensor(&SchedulerBase, &Twi);
+//
+#else
 // IMU task, with offsets.
-MovementSensor Sensor(&SchedulerBase, 3, -502, -185, 1162);
+MovementSensor<3, MPU6050Sensor, AlarmEvents> Sensor(&SchedulerBase, &Twi, -502, -185, 1162);
+//
+#endif
+
+#ifdef GYRO_CONFIRMATION
+// Rotation check task, for the IMU.
+GyroConfirmation Confirmation(&SchedulerBase);
+//
+#endif
+
+// Battery voltage monitor task.
+BatteryMonitor<AlarmEvents> Battery(&SchedulerBase);
 //
 
-// Alarm task.
-AlarmManager Manager(&SchedulerBase);
+// Watchdog and reset recovery.
+WatchdogRecovery Recovery;
 //
 
+// EEPROM event log.
+PersistentLog Log;
+//
+
+// Alarm task, with escalation ladder (DefaultLadder, GentleLadder or HarshLadder).
+AlarmManager Manager(&SchedulerHigh, DefaultLadder, ESCALATION_LADDER_SIZE(DefaultLadder));
+//
+
+#ifdef DIAGNOSTIC_PORT
+// Diagnostics task.
+DiagnosticPort Diagnostics(&SchedulerBase);
+//
+#endif
+
 
 void setup()
 {
+	Recovery.Setup();
+
+	// Only the base layer sleeps, once both are idle.
+	SchedulerHigh.allowSleep(false);
+	SchedulerBase.setHighPriorityScheduler(&SchedulerHigh);
+
 #ifdef DEBUG_LOG
-	Serial.begin(SERIAL_BAUD_RATE);
+	TraceLog::Setup(SERIAL_BAUD_RATE);
 #endif
 
-	Wire.begin();
-	Wire.setClock(400000);
-
 	SetupLowPower();
 
+	if (!Twi.Setup())
+	{
+		SetupError();
+	}
+
+	if (!Log.Setup())
+	{
+		SetupError();
+	}
 
 	if (!Buzzer.Setup())
 	{
@@ -94,54 +196,102 @@ void setup()
 		SetupError();
 	}
 
-	if (!Reader.Setup(&Manager))
+	if (!Outputs.Add(&Light) || !Outputs.Add(&Buzzer))
+	{
+		SetupError();
+	}
+
+#ifdef AUX_LIGHT
+	if (!AuxLight.Setup() || !Outputs.Add(&AuxLight))
 	{
 		SetupError();
 	}
+#endif
+
+#ifdef HORN_RELAY
+	if (!Horn.Setup() || !Outputs.Add(&Horn))
+	{
+		SetupError();
+	}
+#endif
 
-	if (!Sensor.Setup(&Manager))
+	if (!Reader.Setup())
 	{
 		SetupError();
 	}
 
-	if (!Manager.Setup(&Buzzer, &Light, &Sensor, &Reader))
+	if (!Sensor.Setup())
 	{
 		SetupError();
 	}
 
+#ifdef GYRO_CONFIRMATION
+	if (!Sensor.SetupConfirmation(&Confirmation))
+	{
+		SetupError();
+	}
+#endif
+
+	if (!Battery.Setup())
+	{
+		SetupError();
+	}
+
+#ifdef ALARM_NOTIFIER
+	if (!Notifier.Setup(&Sensor, &Battery) || !Outputs.Add(&Notifier))
+	{
+		SetupError();
+	}
+#endif
+
+	if (!Manager.Setup(&Outputs, &Sensor, &Reader, &Battery, &Log, &Recovery))
+	{
+		SetupError();
+	}
+
+#ifdef DIAGNOSTIC_PORT
+	if (!Diagnostics.Setup(&Manager, &Sensor, &Battery, &Log))
+	{
+		SetupError();
+	}
+#endif
+
+	// Drop to coarse timebase if no output is animating.
+	Timebase::Setup();
+
 #ifdef DEBUG_LOG
-	Serial.println(F("Alarm Start."));
+	TraceLog::Write<TraceEnum::AlarmStart>();
 #endif
 
 }
 
-void(*ResetFunc) (void) = 0; // Software eset function @ address 0.
-
 void SetupError()
 {
 	pinMode(LED_BUILTIN, INPUT);
 	digitalWrite(LED_BUILTIN, HIGH);
-	// Wait for 1 second and try again.
+	// Wait for 1 second and try again, with a full watchdog reset.
 	delay(1000);
-	ResetFunc();
+	Recovery.Reset();
 }
 
 void loop()
 {
+	Recovery.Kick();
 	SchedulerBase.execute();
 }
 
 void SetupLowPower()
 {
 #ifndef DEBUG_LOG
-	power_usart0_disable();
+	HalPower::Disable(PeripheralEnum::Usart0);
 #endif // DEBUG_LOG
 
 	// Unused hardware.
-	power_adc_disable();
-	power_spi_disable();
-	//power_timer1_disable(); // Used by Buzzer;
-	power_timer2_disable();
+	ADCSRA = 0; // ADC must be disabled before powering it down. BatteryMonitor powers it up when sampling.
+	HalPower::Disable(PeripheralEnum::Adc);
+	HalPower::Disable(PeripheralEnum::Spi);
+	//HalPower::Disable(PeripheralEnum::Timer1); // Used by Buzzer;
+	HalPower::Disable(PeripheralEnum::Timer2); // Enabled by Timebase while parked.
 
 	// Unused pins. Used pins are commented.
 	pinMode(A0 , INPUT);
@@ -158,15 +308,30 @@ void SetupLowPower()
 	pinMode(10, INPUT);
 	//pinMode(9, INPUT); // Used by Buzzer;
 	pinMode(8, INPUT);
+#ifdef HORN_RELAY
+	//pinMode(7, INPUT); // Used by Horn Relay.
+#else
 	pinMode(7, INPUT);
+#endif
+#ifdef AUX_LIGHT
+	//pinMode(6, INPUT); // Used by Aux Light.
+#else
 	pinMode(6, INPUT);
+#endif
+#ifdef LIGHT_USART_OUTPUT
+	pinMode(5, INPUT);
+	//pinMode(4, INPUT); // Used by Alarm Light, USART clock.
+#else
 	//pinMode(5, INPUT); // Use by Alarm Light.
 	pinMode(4, INPUT);
+#endif
 	//pinMode(3, INPUT); // Used by Movement Sensor.
 	//pinMode(2, INPUT); // Used by InputReader.
 
-#ifndef DEBUG_LOG
+#if !defined(DEBUG_LOG) && !defined(DIAGNOSTIC_PORT) && !defined(ALARM_NOTIFIER)
+#ifndef LIGHT_USART_OUTPUT // Pin 1 used by Alarm Light, USART data.
 	pinMode(1, INPUT);
+#endif
 	pinMode(0, INPUT);
 #endif
 }
\ No newline at end of file
@@ -6,29 +6,49 @@
 #define _TASK_OO_CALLBACKS
 #include <TaskSchedulerDeclarations.h>
 
-#include "..\IAlarmOutput.h"
-
-#include "..\AlarmConstants.h"
-
-
-// use the cRGB struct hsv method
-#define USE_HSV
-#include <WS2812.h> // https://github.com/cpldcpu/light_ws2812
-
+#include "../IAlarmOutput.h"
+
+#include "../AlarmConstants.h"
+#include "../Timebase/Timebase.h"
+#include "../Diagnostics/SchedulingMonitor.h"
+#include "PixelColor.h"
+#include "PixelBuffer.h"
+#include "BitBangPixelOutput.h"
+#include "UsartPixelOutput.h"
+
+// Each light instance needs its own TimebaseClient, so one going idle doesn't drop fine time under another.
+template<typename PixelOutput, const uint8_t LedCount = 1, const Timebase::ClientEnum TimebaseClient = Timebase::ClientEnum::Light>
 class AlarmLight : Task, public virtual IAlarmOutput
 {
 private:
-	const uint8_t DrivePin;
-
-	static const uint8_t LedCount = 1;
 	static const uint32_t AnimationPeriod = 10;
 
 	static const uint8_t Brightness = 255;
 	static const uint8_t ArmedBrightness = 230;
 
-	WS2812 LED;
+	// Brightness never scales below this fraction of 255, on low battery.
+	static const uint8_t MinEnergyScale = 64;
+
+	// Per pattern brightness, combined with the energy scale.
+	static const uint8_t ArmingScale = 160;
+	static const uint8_t FullScale = 255;
+
+	// 8 bit hues, 256 is a full turn.
+	static const uint8_t HueRed = 0;
+	static const uint8_t HueOrange = 25;
+	static const uint8_t HueAmber = 32;
 
-	cRGB Value;
+	PixelBuffer<PixelOutput, LedCount> LED;
+
+	PixelColor Value;
+
+	// Value is in output counts, see PixelBuffer::SetAllExact.
+	bool ValueExact = false;
+
+	// Set by the pattern for the current frame: disable once it's sent,
+	// or keep the task but release fine time until the next frame.
+	bool Finished = false;
+	bool Resting = false;
 
 	enum LightEnum : uint8_t
 	{
@@ -47,23 +67,25 @@ private:
 
 	uint32_t CurrentStartedMillis = 0;
 
+	uint8_t EnergyScale = 255;
+	uint8_t AnimationPeriodShift = 0;
+
 #ifdef DEBUG_LOG
 	bool Debugged = false;
 #endif
 
 public:
-	AlarmLight(Scheduler* scheduler, const uint8_t drivePin)
+	AlarmLight(Scheduler* scheduler)
 		: Task(AnimationPeriod, TASK_FOREVER, scheduler, false)
 		, IAlarmOutput()
-		, DrivePin(drivePin)
-		, LED(LedCount)
+		, LED()
 	{
-		LED.setOutput(DrivePin);
 		Stop();
 	}
 
 	bool Setup()
 	{
+		LED.Setup();
 		Stop();
 
 		return true;
@@ -71,22 +93,39 @@ public:
 
 	bool OnEnable()
 	{
+		Timebase::RequestFine(TimebaseClient);
+
 		return true;
 	}
 
+	void OnDisable()
+	{
+		Timebase::ReleaseFine(TimebaseClient);
+	}
+
 	bool Callback()
 	{
-		const uint32_t Elapsed = millis() - CurrentStartedMillis;
+#ifdef SCHEDULING_MONITOR
+		SchedulingMonitor::Record(SchedulingMonitor::LayerEnum::Base, Task::getStartDelay());
+#endif
+
+		// Frames are always sent at full clock, fine time may have been released while resting.
+		Timebase::RequestFine(TimebaseClient);
+
+		const uint32_t Elapsed = Timebase::Millis() - CurrentStartedMillis;
 
 		// Set default animation period wait.
 		// Animations may override the value.
-		Task::delay(AnimationPeriod);
+		Task::delay(AnimationPeriod << AnimationPeriodShift);
+		ValueExact = false;
+		Finished = false;
+		Resting = false;
 
 		switch (Current)
 		{
 		case LightEnum::None:
-			Value.SetHSV(0, 0, 0);
-			Task::disable();
+			Value = PixelColor();
+			Finished = true;
 			break;
 		case LightEnum::Error:
 			UpdateError(Elapsed);
@@ -112,59 +151,69 @@ public:
 			break;
 		default:
 			Stop();
-			return;
+			return true;
 		}
 
 		UpdateLED();
 
+		// Fine time, and the full clock with it, is only released after the last frame was sent.
+		if (Finished)
+		{
+			Task::disable();
+		}
+		else if (Resting)
+		{
+			Timebase::ReleaseFine(TimebaseClient);
+		}
+
 		return true;
 	}
 
 	virtual void PlayError()
 	{
-		CurrentStartedMillis = millis();
+		CurrentStartedMillis = Timebase::Millis();
 		Current = LightEnum::Error;
 		Task::enable();
 	}
 
 	virtual void PlayArmed()
 	{
-		CurrentStartedMillis = millis();
+		CurrentStartedMillis = Timebase::Millis();
 		Current = LightEnum::Armed;
 		Task::enable();
 	}
 
 	virtual void PlayNotArmed()
 	{
-		CurrentStartedMillis = millis();
+		CurrentStartedMillis = Timebase::Millis();
 		Current = LightEnum::NotArmed;
 		Task::enable();
 	}
 
 	virtual void PlayArming()
 	{
-		CurrentStartedMillis = millis();
+		CurrentStartedMillis = Timebase::Millis();
 		Current = LightEnum::Arming;
 		Task::enable();
 	}
 
 	virtual void PlayArmingFailed()
 	{
-		CurrentStartedMillis = millis();
+		CurrentStartedMillis = Timebase::Millis();
 		Current = LightEnum::ArmingFailed;
 		Task::enable();
 	}
 
 	virtual void PlayEarlyWarning()
 	{
-		CurrentStartedMillis = millis();
+		CurrentStartedMillis = Timebase::Millis();
 		Current = LightEnum::EarlyWarning;
 		Task::enable();
 	}
 
 	virtual void PlayAlarm()
 	{
-		CurrentStartedMillis = millis();
+		CurrentStartedMillis = Timebase::Millis();
 		Current = LightEnum::Alarm;
 		Task::enable();
 	}
@@ -176,15 +225,55 @@ public:
 		Task::forceNextIteration();
 	}
 
+	virtual void SetEnergyLevel(const uint8_t level)
+	{
+		if (level > MinEnergyScale)
+		{
+			EnergyScale = level;
+		}
+		else
+		{
+			EnergyScale = MinEnergyScale;
+		}
+
+		// Slower animations on low battery.
+		if (level < LOW_ENERGY_LEVEL)
+		{
+			AnimationPeriodShift = 2;
+		}
+		else
+		{
+			AnimationPeriodShift = 0;
+		}
+	}
+
 private:
 	void UpdateLED()
 	{
-		LED.set_crgb_at(0, Value);
+		// All LEDs (e.g. front and rear) show the same pattern.
+		if (ValueExact)
+		{
+			LED.SetAllExact(Value);
+		}
+		else
+		{
+			LED.SetScale(((uint16_t)GetPatternScale() * (EnergyScale + 1)) >> 8);
+			LED.SetAll(Value);
+		}
+
+		// Skipped if nothing changed.
+		LED.Sync();
+	}
 
-		// Only one LED, takes about 40 us @ 16 MHz.
-		noInterrupts();
-		LED.sync();
-		interrupts();
+	uint8_t GetPatternScale()
+	{
+		switch (Current)
+		{
+		case LightEnum::Arming:
+			return ArmingScale;
+		default:
+			return FullScale;
+		}
 	}
 
 	void UpdateError(const uint32_t elapsed)
@@ -194,12 +283,12 @@ private:
 
 		if (Progress > (ErrorFlashPeriod / 2))
 		{
-			Value.SetHSV(0, 255, Brightness);
+			Value = PixelColor::FromHsv(HueRed, 255, Brightness);
 			Task::delay(ErrorFlashPeriod - Progress);
 		}
 		else
 		{
-			Value.SetHSV(35, 255, Brightness);
+			Value = PixelColor::FromHsv(HueOrange, 255, Brightness);
 			Task::delay((ErrorFlashPeriod / 2) - Progress);
 		}
 	}
@@ -211,12 +300,12 @@ private:
 
 		if (Progress > (AlarmFlashPeriod / 2))
 		{
-			Value.SetHSV(0, 255, Brightness);
+			Value = PixelColor::FromHsv(HueRed, 255, Brightness);
 			Task::delay(AlarmFlashPeriod - Progress);
 		}
 		else
 		{
-			Value.SetHSV(45, 255, Brightness);
+			Value = PixelColor::FromHsv(HueAmber, 255, Brightness);
 			Task::delay((AlarmFlashPeriod / 2) - Progress);
 		}
 	}
@@ -229,15 +318,16 @@ private:
 
 		if (elapsed > TotalDuration)
 		{
-			Value.r = 0;
-			Value.g = 0;
-			Value.b = PresenceBrightness;
-			Task::disable();
+			// Steady, whatever the energy scale.
+			Value = PixelColor(0, 0, PresenceBrightness);
+			ValueExact = true;
+			Finished = true;
 		}
 		else
 		{
-			const int16_t NotArmedHue = map(elapsed % HuePeriod, 0, HuePeriod, 0, 360);
-			Value.SetHSV(NotArmedHue, 255, (uint8_t)map(elapsed, 0, TotalDuration, Brightness, 0));
+			// A full turn every HuePeriod, fixed point instead of a division.
+			const uint8_t NotArmedHue = (elapsed * ((256UL * 256) / HuePeriod)) >> 8;
+			Value = PixelColor::FromHsv(NotArmedHue, 255, (uint8_t)map(elapsed, 0, TotalDuration, Brightness, 0));
 		}
 	}
 
@@ -259,7 +349,10 @@ private:
 			Value.r = 0;
 			Value.g = 0;
 			Value.b = 0;
+
+			// Parked between flashes, coarse ticks are enough to wake for the next one.
 			Task::delay(ArmedFlashPeriod - Progress);
+			Resting = true;
 		}
 	}
 
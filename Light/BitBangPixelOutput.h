@@ -0,0 +1,88 @@
+// BitBangPixelOutput.h
+
+#ifndef _BITBANGPIXELOUTPUT_h
+#define _BITBANGPIXELOUTPUT_h
+
+#include <stdint.h>
+#include <avr/io.h>
+
+#include "../Hal/Hal.h"
+#include "../Timebase/ClockGovernor.h"
+
+// WS2812 output on any pin, cycle counted.
+// Interrupts are masked for the whole frame, 30 us per LED @ 8 MHz.
+template<const uint8_t DataPin>
+class BitBangPixelOutput
+{
+	static_assert(F_CPU == 8000000, "WS2812 bit timing is hand tuned for 8 MHz.");
+
+private:
+	typedef FastPin<DataPin> Pin;
+
+	// I/O space addresses of PORTD, PORTB and PORTC, for the out instruction.
+	static const uint8_t PortIoAddress = DataPin < 8 ? 0x0B : (DataPin < 14 ? 0x05 : 0x08);
+
+public:
+	static void Setup()
+	{
+		Pin::Low();
+		Pin::SetOutput();
+	}
+
+	/* 10 cycles (1.25 us) per bit @ 8 MHz.
+		0 bit: high for 2 cycles (250 ns).
+		1 bit: high for 6 cycles (750 ns).
+		Loading the next byte stretches the low time of the last bit, which the LEDs tolerate.
+		Returns false without sending on the slow clock, the timing would latch garbage. */
+	static bool Send(const uint8_t* data, uint16_t length)
+	{
+		if (ClockGovernor::IsSlow())
+		{
+			return false;
+		}
+
+		const uint8_t OldSREG = SREG;
+		cli();
+
+		const uint8_t High = Port() | Pin::Mask;
+		const uint8_t Low = Port() & ~Pin::Mask;
+		uint8_t Value;
+		uint8_t Bits;
+
+		asm volatile(
+			"1:					\n\t"
+			"	ld %[value], %a[data]+	\n\t"
+			"	ldi %[bits], 8		\n\t"
+			"2:					\n\t"
+			"	out %[port], %[high]	\n\t" // 0
+			"	sbrs %[value], 7	\n\t" // 1
+			"	out %[port], %[low]	\n\t" // 2, 0 bit ends.
+			"	lsl %[value]		\n\t" // 3
+			"	nop					\n\t" // 4
+			"	nop					\n\t" // 5
+			"	out %[port], %[low]	\n\t" // 6, 1 bit ends.
+			"	dec %[bits]			\n\t" // 7
+			"	brne 2b				\n\t" // 8, 9
+			"	sbiw %[length], 1	\n\t"
+			"	brne 1b				\n\t"
+			: [value] "=&d" (Value),
+			[bits] "=&d" (Bits),
+			[data] "+e" (data),
+			[length] "+w" (length)
+			: [port] "I" (PortIoAddress),
+			[high] "r" (High),
+			[low] "r" (Low)
+			);
+
+		SREG = OldSREG;
+
+		return true;
+	}
+
+private:
+	static volatile uint8_t& Port()
+	{
+		return DataPin < 8 ? PORTD : (DataPin < 14 ? PORTB : PORTC);
+	}
+};
+#endif
@@ -0,0 +1,186 @@
+// PixelBuffer.h
+
+#ifndef _PIXELBUFFER_h
+#define _PIXELBUFFER_h
+
+#include <stdint.h>
+
+#include "../Hal/Hal.h"
+#include "PixelColor.h"
+#include "PixelGamma.h"
+
+// Statically sized WS2812 frame, no heap.
+// Set() stores linear colour. Sync() applies gamma and scale for an 8.8 fixed point level per channel,
+// dithers it to output counts (error diffusion), and stores them in wire order (GRB)
+// so sending only streams bytes. It is skipped when no output count changed.
+// RAM is 9 bytes per LED (colour, residual, frame) plus 4 bytes of state:
+// 1 LED = 13 bytes, 8 LEDs = 76 bytes, 30 LEDs = 274 bytes.
+// Output is BitBangPixelOutput<Pin> or UsartPixelOutput.
+template<typename Output, const uint8_t LedCount>
+class PixelBuffer
+{
+	static_assert(LedCount > 0, "At least one LED.");
+
+private:
+	static const uint16_t FrameSize = (uint16_t)LedCount * 3;
+
+	uint8_t Frame[FrameSize];
+
+	// Linear colour and the dithering error of its level, in wire order.
+	uint8_t Color[FrameSize];
+	uint8_t Residual[FrameSize];
+
+	// Brightness scale applied on Sync, 255 is full scale.
+	uint8_t Scale = 255;
+
+	// Colours are output counts, see SetAllExact.
+	bool Exact = false;
+
+	// Set while a level changed or has a fraction left to dither.
+	bool Dirty = true;
+
+	// Frame the output refused, sent on the next Sync.
+	bool Unsent = false;
+
+public:
+	PixelBuffer()
+	{
+		for (uint16_t i = 0; i < FrameSize; i++)
+		{
+			Frame[i] = 0;
+			Color[i] = 0;
+			Residual[i] = 0;
+		}
+	}
+
+	void Setup()
+	{
+		Output::Setup();
+	}
+
+	// Applies to the whole frame.
+	void SetScale(const uint8_t scale)
+	{
+		Update(Scale, scale);
+	}
+
+	// Leaves exact mode, for the whole frame.
+	void Set(const uint8_t index, const PixelColor color)
+	{
+		if (index < LedCount)
+		{
+			SetMode(false);
+			SetPixel(index, color);
+		}
+	}
+
+	void SetAll(const PixelColor color)
+	{
+		for (uint8_t i = 0; i < LedCount; i++)
+		{
+			Set(i, color);
+		}
+	}
+
+	// Output counts as given, without gamma or scale, never dithered.
+	// For steady dim levels, where a scaled fraction would flicker or drop to off.
+	void SetAllExact(const PixelColor color)
+	{
+		SetMode(true);
+
+		for (uint8_t i = 0; i < LedCount; i++)
+		{
+			SetPixel(i, color);
+		}
+	}
+
+	// Call once per animation frame, fractions are spread over frames.
+	// Output masks interrupts as it needs, and refuses to send on the slow clock.
+	// Returns false if no data was sent.
+	bool Sync()
+	{
+		if (!Dirty)
+		{
+			return false;
+		}
+
+		bool Changed = false;
+		Dirty = false;
+
+		for (uint16_t i = 0; i < FrameSize; i++)
+		{
+			const uint16_t Level = Exact ? ((uint16_t)Color[i] << 8) : Correct(Color[i]);
+			const uint16_t Dithered = Level + Residual[i];
+			const uint8_t Count = Dithered >> 8;
+
+			Residual[i] = Dithered & 0xFF;
+
+			if ((Level & 0xFF) != 0)
+			{
+				Dirty = true;
+			}
+
+			if (Frame[i] != Count)
+			{
+				Frame[i] = Count;
+				Changed = true;
+			}
+		}
+
+		if (Changed || Unsent)
+		{
+			Unsent = !Output::Send(Frame, FrameSize);
+			Dirty |= Unsent;
+
+			return !Unsent;
+		}
+
+		return false;
+	}
+
+private:
+	uint16_t Correct(const uint8_t value)
+	{
+		const uint16_t Gamma = pgm_read_word(&PixelGamma[value]);
+
+		// Integer and fraction scaled apart, 16 bit multiplies only.
+		// Full scale (255) keeps the level intact.
+		const uint16_t Multiplier = (uint16_t)Scale + 1;
+
+		return ((Gamma >> 8) * Multiplier) + (((Gamma & 0xFF) * Multiplier) >> 8);
+	}
+
+	void SetPixel(const uint8_t index, const PixelColor color)
+	{
+		uint8_t* Pixel = &Color[(uint16_t)index * 3];
+
+		Update(Pixel[0], color.g);
+		Update(Pixel[1], color.r);
+		Update(Pixel[2], color.b);
+	}
+
+	void SetMode(const bool exact)
+	{
+		if (Exact != exact)
+		{
+			Exact = exact;
+			Dirty = true;
+
+			// Exact levels are never dithered.
+			for (uint16_t i = 0; i < FrameSize; i++)
+			{
+				Residual[i] = 0;
+			}
+		}
+	}
+
+	void Update(uint8_t& target, const uint8_t value)
+	{
+		if (target != value)
+		{
+			target = value;
+			Dirty = true;
+		}
+	}
+};
+#endif
@@ -0,0 +1,63 @@
+// PixelColor.h
+
+#ifndef _PIXELCOLOR_h
+#define _PIXELCOLOR_h
+
+#include <stdint.h>
+
+#include "../Hal/Hal.h"
+
+// Red channel of a fully saturated, full value colour, by 8 bit hue (256 is a full turn).
+// Green and blue are the same curve, 85 and 171 later. It is 0 for the whole third of a turn
+// in between, so primaries are pure.
+static const uint8_t PixelHueWheel[256] PROGMEM =
+{
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 253, 247, 241, 235, 229,
+	223, 217, 211, 205, 199, 193, 187, 181, 175, 169, 163, 157, 151, 145, 139, 133,
+	126, 120, 114, 108, 102,  96,  90,  84,  78,  72,  66,  60,  54,  48,  42,  36,
+	 30,  24,  18,  12,   6,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   6,  12,  18,  24,
+	 30,  36,  42,  48,  54,  60,  66,  72,  78,  84,  90,  96, 102, 108, 114, 120,
+	126, 133, 139, 145, 151, 157, 163, 169, 175, 181, 187, 193, 199, 205, 211, 217,
+	223, 229, 235, 241, 247, 253, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255
+};
+
+// Linear 8 bit RGB, as set by animations. Gamma is applied by PixelBuffer.
+struct PixelColor
+{
+	uint8_t r;
+	uint8_t g;
+	uint8_t b;
+
+	PixelColor(const uint8_t red = 0, const uint8_t green = 0, const uint8_t blue = 0)
+		: r(red), g(green), b(blue)
+	{
+	}
+
+	// Table lookups and 8 bit fixed point scaling only, no division.
+	static PixelColor FromHsv(const uint8_t hue, const uint8_t saturation, const uint8_t value)
+	{
+		return PixelColor(
+			Shade(pgm_read_byte(&PixelHueWheel[hue]), saturation, value),
+			Shade(pgm_read_byte(&PixelHueWheel[(uint8_t)(hue - 85)]), saturation, value),
+			Shade(pgm_read_byte(&PixelHueWheel[(uint8_t)(hue - 171)]), saturation, value));
+	}
+
+private:
+	// Full saturation and value (255) keep the channel intact.
+	static uint8_t Shade(const uint8_t channel, const uint8_t saturation, const uint8_t value)
+	{
+		const uint8_t Saturated = 255 - (((uint16_t)(255 - channel) * (saturation + 1)) >> 8);
+
+		return ((uint16_t)Saturated * (value + 1)) >> 8;
+	}
+};
+#endif
@@ -0,0 +1,111 @@
+// UsartPixelOutput.h
+
+#ifndef _USARTPIXELOUTPUT_h
+#define _USARTPIXELOUTPUT_h
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "../Hal/Hal.h"
+#include "../Timebase/ClockGovernor.h"
+
+#if defined(LIGHT_USART_OUTPUT) && (defined(DEBUG_LOG) || defined(DIAGNOSTIC_PORT))
+#error UsartPixelOutput, DEBUG_LOG and DiagnosticPort all use USART0.
+#endif
+
+// Each WS2812 bit is 3 SPI bits @ 2 MHz (1.5 us): 0 is 100, 1 is 110.
+// A nibble encodes to 12 SPI bits.
+static const uint16_t UsartPixelNibbleCode[16] PROGMEM =
+{
+	0x924, 0x926, 0x934, 0x936, 0x9A4, 0x9A6, 0x9B4, 0x9B6,
+	0xD24, 0xD26, 0xD34, 0xD36, 0xDA4, 0xDA6, 0xDB4, 0xDB6
+};
+
+/* WS2812 output streamed by USART0 in SPI master mode (MSPIM).
+	Data is on TXD (pin 1), XCK (pin 4) is driven as the unused clock.
+	Every colour byte becomes 3 SPI bytes (12 us), handed to the double buffered transmitter one at a time.
+	Interrupts are masked only for each UDR hand-off, a few cycles, instead of the whole frame as bit-bang does.
+	A handler may still split the frame: the transmitter holds up to 2 SPI bytes (8 us) and WS2812B latch
+	on about 6 us low, so handlers must stay below ~14 us. USART0 is powered only while sending. */
+class UsartPixelOutput
+{
+private:
+	typedef FastPin<1> DataPin;
+	typedef FastPin<4> ClockPin;
+
+	// 2 MHz SPI clock @ 8 MHz.
+	static const uint16_t BaudRegister = (F_CPU / (2 * 2000000UL)) - 1;
+
+	static_assert(F_CPU == 8000000, "SPI sub-bit timing assumes 8 MHz.");
+
+public:
+	static void Setup()
+	{
+		DataPin::Low();
+		DataPin::SetOutput();
+		ClockPin::Low();
+		ClockPin::SetOutput();
+	}
+
+	// Returns false without sending on the slow clock, the SPI sub-bits would be 8x too long.
+	static bool Send(const uint8_t* data, uint16_t length)
+	{
+		if (ClockGovernor::IsSlow())
+		{
+			return false;
+		}
+
+		PowerUp();
+
+		while (length--)
+		{
+			const uint16_t High = pgm_read_word(&UsartPixelNibbleCode[*data >> 4]);
+			const uint16_t Low = pgm_read_word(&UsartPixelNibbleCode[*data & 0x0F]);
+			data++;
+
+			Put(High >> 4);
+			Put((High << 4) | (Low >> 8));
+			Put(Low);
+		}
+
+		while (!(UCSR0A & _BV(TXC0)));
+
+		PowerDown();
+
+		return true;
+	}
+
+private:
+	// Waits with interrupts enabled.
+	static void Put(const uint8_t value)
+	{
+		while (!(UCSR0A & _BV(UDRE0)));
+
+		// Cannot complete before this byte has shifted out, so TXC0 is cleared with it.
+		const uint8_t OldSREG = SREG;
+		cli();
+		UDR0 = value;
+		UCSR0A |= _BV(TXC0);
+		SREG = OldSREG;
+	}
+
+	static void PowerUp()
+	{
+		HalPower::Enable(PeripheralEnum::Usart0);
+
+		// Baud register must be zero when the transmitter is enabled.
+		UBRR0 = 0;
+		UCSR0C = _BV(UMSEL01) | _BV(UMSEL00); // MSPIM, mode 0, MSB first.
+		UCSR0B = _BV(TXEN0);
+		UBRR0 = BaudRegister;
+	}
+
+	static void PowerDown()
+	{
+		// Pins fall back to the port registers, low.
+		UCSR0B = 0;
+		HalPower::Disable(PeripheralEnum::Usart0);
+	}
+};
+#endif
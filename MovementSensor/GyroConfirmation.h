@@ -0,0 +1,209 @@
+// GyroConfirmation.h
+
+#ifndef _GYROCONFIRMATION_h
+#define _GYROCONFIRMATION_h
+
+#define _TASK_OO_CALLBACKS
+#include <TaskSchedulerDeclarations.h>
+
+#include "../IEventListener.h"
+#include "../ITwiListener.h"
+#include "../AlarmConstants.h"
+#include "../Timebase/Timebase.h"
+#include "MPU6050/MPU6050Sensor.h"
+
+/* Rotation check after an accelerometer wake.
+	The gyro is powered, a short burst is sampled and the peak rotation rate is
+	compared against a threshold, then the gyro goes back to standby.
+	Catches rolling or turning the bike, which may stay below the accelerometer threshold.
+	Fine time is held for the check, coarse 16 ms ticks would stretch every step and the gyro on-time with it.
+	The gyro is on for about GyroStartupMillis + (SampleCount * SamplePeriodMillis) per check. */
+class GyroConfirmation : Task, public virtual ITwiListener
+{
+private:
+	// Gyro start-up time is 30 ms typical.
+	static const uint32_t GyroStartupMillis = 35;
+	static const uint32_t SamplePeriodMillis = 2;
+	static const uint8_t SampleCount = 4;
+	static const uint32_t BusRetryMillis = 10;
+
+	// Raw gyro is 131 LSB per deg/s.
+	static const uint16_t RateThreshold = GYRO_CONFIRMATION_THRESHOLD_DPS * 131;
+
+	enum StateEnum : uint8_t
+	{
+		Idle,
+		Starting,
+		Sampling,
+		Stopping
+	};
+
+	enum TokenEnum : uint8_t
+	{
+		TokenStart,
+		TokenSample,
+		TokenStop
+	};
+
+	MPU6050Sensor* Sensor = nullptr;
+	IEventListener* Listener = nullptr;
+
+	volatile StateEnum State = StateEnum::Idle;
+
+	uint8_t Raw[6];
+	volatile uint16_t PeakRate = 0;
+	volatile uint8_t SamplesTaken = 0;
+
+	volatile uint16_t ConfirmedCount = 0;
+
+public:
+	GyroConfirmation(Scheduler* scheduler)
+		: Task(0, TASK_FOREVER, scheduler, false)
+	{
+	}
+
+	// Listener is notified of confirmed rotations. Blocks to measure gyro bias.
+	bool Setup(MPU6050Sensor* sensor, IEventListener* listener)
+	{
+		Sensor = sensor;
+		Listener = listener;
+
+		if (Sensor == nullptr || Listener == nullptr)
+		{
+			return false;
+		}
+
+		return Sensor->CalibrateGyro(GyroStartupMillis);
+	}
+
+	// Safe from interrupts, ignored if a check is already running.
+	void Start()
+	{
+		if (State == StateEnum::Idle)
+		{
+			State = StateEnum::Starting;
+			Task::enableIfNot();
+			Task::forceNextIteration();
+		}
+	}
+
+	uint16_t GetConfirmedCount()
+	{
+		noInterrupts();
+		const uint16_t Count = ConfirmedCount;
+		interrupts();
+
+		return Count;
+	}
+
+	bool Callback()
+	{
+		switch (State)
+		{
+		case StateEnum::Starting:
+			Timebase::RequestFine(Timebase::ClientEnum::Gyro);
+			if (Sensor->SetGyroStandby(false, this, TokenEnum::TokenStart))
+			{
+				PeakRate = 0;
+				SamplesTaken = 0;
+				State = StateEnum::Sampling;
+				Task::delay(GyroStartupMillis);
+			}
+			else
+			{
+				// Bus queue full, try again later.
+				Task::delay(BusRetryMillis);
+			}
+			break;
+		case StateEnum::Sampling:
+			if (Sensor->ReadGyro(Raw, this, TokenEnum::TokenSample))
+			{
+				// Woken up again on completion.
+				Task::disable();
+			}
+			else
+			{
+				Task::delay(BusRetryMillis);
+			}
+			break;
+		case StateEnum::Stopping:
+			if (Sensor->SetGyroStandby(true, this, TokenEnum::TokenStop))
+			{
+				State = StateEnum::Idle;
+				Task::disable();
+				Timebase::ReleaseFine(Timebase::ClientEnum::Gyro);
+
+				if (PeakRate >= RateThreshold)
+				{
+					ConfirmedCount++;
+					Listener->OnEvent();
+				}
+			}
+			else
+			{
+				Task::delay(BusRetryMillis);
+			}
+			break;
+		case StateEnum::Idle:
+		default:
+			Task::disable();
+			break;
+		}
+
+		return true;
+	}
+
+	// Bus transaction completed, from the TWI driver task.
+	virtual void OnTwiComplete(const uint8_t token, const bool success)
+	{
+		switch (token)
+		{
+		case TokenEnum::TokenStart:
+			if (!success && State == StateEnum::Sampling)
+			{
+				// Gyro may still be off, give up this check.
+				State = StateEnum::Stopping;
+				Task::enableIfNot();
+				Task::forceNextIteration();
+			}
+			break;
+		case TokenEnum::TokenSample:
+			if (success)
+			{
+				const uint16_t Rate = Sensor->GetRotationRate(Raw);
+				if (Rate > PeakRate)
+				{
+					PeakRate = Rate;
+				}
+				SamplesTaken++;
+			}
+
+			// Stop early once confirmed.
+			if (!success || SamplesTaken >= SampleCount || PeakRate >= RateThreshold)
+			{
+				State = StateEnum::Stopping;
+				Task::enableIfNot();
+				Task::forceNextIteration();
+			}
+			else
+			{
+				Task::enableIfNot();
+				Task::delay(SamplePeriodMillis);
+			}
+			break;
+		case TokenEnum::TokenStop:
+			if (!success)
+			{
+				// Never leave the gyro powered.
+				State = StateEnum::Stopping;
+				PeakRate = 0;
+				Task::enableIfNot();
+				Task::delay(BusRetryMillis);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+};
+#endif
@@ -0,0 +1,161 @@
+// LIS3DHSensor.h
+
+#ifndef _LIS3DHSENSOR_h
+#define _LIS3DHSENSOR_h
+
+#include <stdint.h>
+
+#include "../../Twi/TwiDriver.h"
+#include "../../IMovementSensor.h"
+#include "../../Hal/Hal.h"
+
+#if defined(LIS3DH_SENSOR) && defined(GYRO_CONFIRMATION)
+#error GyroConfirmation needs the MPU6050 gyro.
+#endif
+
+struct LIS3DHRegisterValue
+{
+	uint8_t Register;
+	uint8_t Value;
+};
+
+// Applied in order, with the sensor powered down.
+static const LIS3DHRegisterValue LIS3DHSetupSequence[] PROGMEM =
+{
+	{ 0x20, 0x08 }, // CTRL_REG1: power down, low power mode.
+	{ 0x21, 0x01 }, // CTRL_REG2: high pass filter on the INT1 wake-up, gravity is ignored.
+	{ 0x22, 0x40 }, // CTRL_REG3: wake-up (AOI1) on INT1.
+	{ 0x23, 0x80 }, // CTRL_REG4: block data update, +/- 2 g.
+	{ 0x24, 0x00 }, // CTRL_REG5: INT1 not latched, follows the motion.
+	{ 0x25, 0x02 }, // CTRL_REG6: interrupts active low.
+	{ 0x32, 0x02 }, // INT1_THS: motion threshold.
+	{ 0x33, 0x01 }, // INT1_DURATION: one sample.
+	{ 0x30, 0x2A }  // INT1_CFG: high event on any axis.
+};
+
+// Register level LIS3DH driver on the asynchronous TwiDriver, see MovementSensor.h for the driver concept.
+// Wake-on-motion runs at 10 Hz in low power mode, about 3 uA, and 0.5 uA powered down.
+// The part has no offset registers, the high pass filter takes out gravity and bias instead.
+class LIS3DHSensor
+{
+public:
+	static const uint8_t DefaultAddress = 0x18;
+
+private:
+	// Register map.
+	static const uint8_t RegisterWhoAmI = 0x0F;
+	static const uint8_t RegisterControl1 = 0x20;
+	static const uint8_t RegisterReference = 0x26;
+	static const uint8_t RegisterAccelOut = 0x28;
+	static const uint8_t RegisterInt1Threshold = 0x32;
+
+	// Sub-address MSB, for bursts.
+	static const uint8_t AutoIncrement = 0x80;
+
+	static const uint8_t DeviceId = 0x33;
+
+	// CTRL_REG1 values, low power mode.
+	static const uint8_t PowerDown = 0x08;
+	static const uint8_t LowPower10HzAllAxes = 0x2F;
+
+	static const uint8_t MotionThresholdMilliG = 16; // Per LSB at +/- 2 g.
+
+	static const uint32_t SetupTimeoutMillis = 10;
+
+	static const uint8_t SetupSequenceSize = sizeof(LIS3DHSetupSequence) / sizeof(LIS3DHRegisterValue);
+
+	// Must match the setup sequence.
+	static const uint8_t MotionDetectionThresholdDuration = 1;
+
+	TwiDriver* Twi;
+	const uint8_t Address;
+
+	// Must match the setup sequence until changed.
+	uint8_t MotionDetectionThreshold = 2;
+
+	// Target for the reference read, value is not used.
+	uint8_t Reference = 0;
+
+public:
+	LIS3DHSensor(TwiDriver* twi, const uint8_t address = DefaultAddress)
+		: Twi(twi)
+		, Address(address)
+	{
+	}
+
+	bool Setup()
+	{
+		uint8_t WhoAmI = 0;
+
+		if (!Twi->ReadRegisters(Address, RegisterWhoAmI, &WhoAmI, 1)
+			|| !Twi->Flush(SetupTimeoutMillis)
+			|| WhoAmI != DeviceId)
+		{
+			return false;
+		}
+
+		LIS3DHRegisterValue Step;
+		for (uint8_t i = 0; i < SetupSequenceSize; i++)
+		{
+			memcpy_P(&Step, &LIS3DHSetupSequence[i], sizeof(LIS3DHRegisterValue));
+			Twi->WriteRegister(Address, Step.Register, Step.Value);
+			if (!Twi->Flush(SetupTimeoutMillis))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void GetConfiguration(MovementSensorConfiguration& configuration)
+	{
+		configuration.XOffset = 0;
+		configuration.YOffset = 0;
+		configuration.ZOffset = 0;
+		configuration.MotionThreshold = MotionDetectionThreshold;
+		configuration.MotionDuration = MotionDetectionThresholdDuration;
+	}
+
+	// Returns false if the bus queue is full, completion is reported to listener.
+	bool SetSleep(ITwiListener* listener, const uint8_t token)
+	{
+		return Twi->WriteRegister(Address, RegisterControl1, PowerDown, listener, token);
+	}
+
+	// Reading the reference register settles the high pass filter on the current attitude,
+	// so waking up does not report gravity as motion.
+	// Returns false if the bus queue is full, completion is reported to listener.
+	bool SetActiveMotionDetection(ITwiListener* listener, const uint8_t token)
+	{
+		return Twi->WriteRegister(Address, RegisterControl1, LowPower10HzAllAxes, listener, token)
+			&& Twi->ReadRegisters(Address, RegisterReference, &Reference, 1, listener, token);
+	}
+
+	// Rounded down to the 16 mg step, at least one step.
+	// Returns false if the bus queue is full, completion is reported to listener.
+	bool SetMotionThreshold(const uint16_t milliG, ITwiListener* listener, const uint8_t token)
+	{
+		const uint16_t Steps = milliG / MotionThresholdMilliG;
+
+		// 7 bit register.
+		MotionDetectionThreshold = Steps == 0 ? 1 : (Steps > 0x7F ? 0x7F : Steps);
+
+		return Twi->WriteRegister(Address, RegisterInt1Threshold, MotionDetectionThreshold, listener, token);
+	}
+
+	// Reads raw accelerometer output (6 bytes) into buffer, in one burst.
+	// Returns false if the bus queue is full, completion is reported to listener.
+	bool ReadAcceleration(uint8_t* buffer, ITwiListener* listener, const uint8_t token)
+	{
+		return Twi->ReadRegisters(Address, RegisterAccelOut | AutoIncrement, buffer, 6, listener, token);
+	}
+
+	// Axis 0 to 2 of a raw burst, little-endian and left justified.
+	// Low power mode has 8 significant bits, 16 mg each.
+	int16_t GetAccelerationMilliG(const uint8_t* raw, const uint8_t axis)
+	{
+		return (int16_t)(int8_t)raw[(axis * 2) + 1] * MotionThresholdMilliG;
+	}
+};
+#endif
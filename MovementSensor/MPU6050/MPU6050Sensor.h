@@ -1,19 +1,86 @@
-// MPU6050MPU6050::h
+// MPU6050Sensor.h
 
 #ifndef _MPU6050SENSOR_h
 #define _MPU6050SENSOR_h
 
+#include <stdint.h>
 
-// https://github.com/ElectronicCats/mpu6050
-#include <MPU6050.h>
-#if I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE
-#include "Wire.h"
+#include "../../Twi/TwiDriver.h"
+#include "../../IMovementSensor.h"
+#include "../../Hal/Hal.h"
+#if defined(DEBUG_LOG) && defined(DEBUG_SENSOR)
+#include "../../Diagnostics/TraceLog.h"
 #endif
 
+struct MPU6050RegisterValue
+{
+	uint8_t Register;
+	uint8_t Value;
+};
+
+// Applied after reset, in order.
+static const MPU6050RegisterValue MPU6050SetupSequence[] PROGMEM =
+{
+	{ 0x6B, 0x09 }, // Awake, temperature sensor disabled, PLL with X gyro clock.
+	{ 0x1B, 0x00 }, // Gyro +/- 250 deg/s.
+	{ 0x1C, 0x00 }, // Accelerometer +/- 2 g, high pass filter reset.
+	{ 0x69, 0x30 }, // Accelerometer power on delay 3 ms.
+	{ 0x6A, 0x00 }, // DMP and FIFO disabled.
+	{ 0x6C, 0x07 }, // Gyros in standby.
+	{ 0x68, 0x02 }, // Reset accelerometer path.
+	{ 0x37, 0x80 }, // Interrupt active low, push-pull, pulsed, no clock output.
+	{ 0x1F, 0x01 }, // Motion threshold.
+	{ 0x20, 0x01 }, // Motion duration.
+	{ 0x21, 0x01 }, // Zero motion threshold.
+	{ 0x22, 0x01 }, // Zero motion duration.
+	{ 0x38, 0xC0 }  // Free fall and motion interrupts enabled.
+};
 
-class MPU6050Sensor : MPU6050
+// Register level MPU6050 driver on the asynchronous TwiDriver, see MovementSensor.h for the driver concept.
+// Setup blocks on the bus during boot, runtime calls only queue transactions.
+// Awake with gyros in standby, the accelerometer alone draws about 500 uA.
+class MPU6050Sensor
 {
+public:
+	static const uint8_t DefaultAddress = 0x68;
+
 private:
+	// Register map.
+	static const uint8_t RegisterAccelOffset = 0x06;
+	static const uint8_t RegisterMotionThreshold = 0x1F;
+	static const uint8_t RegisterAccelOut = 0x3B;
+	static const uint8_t RegisterGyroOut = 0x43;
+	static const uint8_t RegisterPowerManagement1 = 0x6B;
+	static const uint8_t RegisterPowerManagement2 = 0x6C;
+	static const uint8_t RegisterWhoAmI = 0x75;
+
+	static const uint8_t DeviceId = 0x34;
+
+	// PWR_MGMT_1 values.
+	static const uint8_t PowerReset = 0x80;
+	static const uint8_t PowerSleep = 0x40;
+	static const uint8_t PowerTemperatureDisabled = 0x08;
+	static const uint8_t PowerClockPllXGyro = 0x01;
+
+	// PWR_MGMT_2 values, accelerometer always on.
+	static const uint8_t GyroStandby = 0x07;
+	static const uint8_t GyroOn = 0x00;
+
+	static const uint8_t GyroBiasSamples = 8;
+
+	static const uint32_t ResetDelayMillis = 30;
+	static const uint32_t SetupTimeoutMillis = 10;
+
+	static const uint8_t SetupSequenceSize = sizeof(MPU6050SetupSequence) / sizeof(MPU6050RegisterValue);
+
+	static const uint8_t MotionThresholdMilliG = 2; // Per LSB.
+
+	// Must match the setup sequence.
+	static const uint8_t MotionDetectionThresholdDuration = 1;
+
+	TwiDriver* Twi;
+	const uint8_t Address;
+
 	const struct CalibrationProvider
 	{
 		const int16_t xOffset;
@@ -32,201 +99,217 @@ private:
 		{}
 	} Calibration;
 
+	// Big-endian offsets, written in one burst.
+	uint8_t OffsetBuffer[6];
 
-	static const uint8_t MotionDetectionThreshold = 1;
-	static const uint8_t MotionDetectionThresholdDuration = 1;
+	// Zero rate output, measured at boot if the gyro is used.
+	int16_t GyroBias[3] = { 0, 0, 0 };
 
+	// Must match the setup sequence until changed.
+	uint8_t MotionDetectionThreshold = 1;
 
 public:
-	MPU6050Sensor(const int16_t xOffset,
+	MPU6050Sensor(TwiDriver* twi,
+		const int16_t xOffset,
 		const int16_t yOffset,
 		const int16_t zOffset,
-		uint8_t address = MPU6050_DEFAULT_ADDRESS) :
-		MPU6050(address),
-		Calibration(xOffset, yOffset, zOffset)
+		const uint8_t address = DefaultAddress)
+		: Twi(twi)
+		, Address(address)
+		, Calibration(xOffset, yOffset, zOffset)
 	{
 	}
-	
+
 	bool Setup()
 	{
-		if (MPU6050::testConnection())
-		{
-			MPU6050::reset();
-			delay(30);
+		uint8_t WhoAmI = 0;
 
-			MPU6050::setSleepEnabled(false);
-
-			MPU6050::setClockSource(MPU6050_CLOCK_PLL_XGYRO);
-			MPU6050::setFullScaleGyroRange(MPU6050_GYRO_FS_250);
-			MPU6050::setFullScaleAccelRange(MPU6050_ACCEL_FS_2);
-
-#if defined(DEBUG_LOG) && defined(DEBUG_SENSOR)
-			// get MPU hardware revision
-			MPU6050::setMemoryBank(0x10, true, true);
-			MPU6050::setMemoryStartAddress(0x06);
-			Serial.println(F("Checking hardware revision..."));
-			Serial.print(F("Revision @ user[16][6] = "));
-			Serial.println(MPU6050::readMemoryByte(), HEX);
-			MPU6050::setMemoryStartAddress(0x00);
-			MPU6050::setMemoryBank(0, false, false);
-#endif
-
-			MPU6050::setAccelerometerPowerOnDelay(3);
-
-			// Disable unused features.
-			MPU6050::setDMPEnabled(false);
-			MPU6050::setFIFOEnabled(false);
-			MPU6050::setTempSensorEnabled(false);
-			MPU6050::setClockOutputEnabled(false);
+		if (!Twi->ReadRegisters(Address, RegisterWhoAmI, &WhoAmI, 1)
+			|| !Twi->Flush(SetupTimeoutMillis)
+			|| ((WhoAmI >> 1) & 0x3F) != DeviceId)
+		{
+			return false;
+		}
 
-			// Disable Gyro.
-			MPU6050::setStandbyXGyroEnabled(true);
-			MPU6050::setStandbyYGyroEnabled(true);
-			MPU6050::setStandbyZGyroEnabled(true);
+		Twi->WriteRegister(Address, RegisterPowerManagement1, PowerReset);
+		if (!Twi->Flush(SetupTimeoutMillis))
+		{
+			return false;
+		}
+		HalTime::Delay(ResetDelayMillis);
 
-			// Reset and apply calibration.
-			MPU6050::resetAccelerometerPath();
-			if (Calibration.Provided)
+		MPU6050RegisterValue Step;
+		for (uint8_t i = 0; i < SetupSequenceSize; i++)
+		{
+			memcpy_P(&Step, &MPU6050SetupSequence[i], sizeof(MPU6050RegisterValue));
+			Twi->WriteRegister(Address, Step.Register, Step.Value);
+			if (!Twi->Flush(SetupTimeoutMillis))
 			{
-				MPU6050::setXAccelOffset(Calibration.xOffset);
-				MPU6050::setYAccelOffset(Calibration.yOffset);
-				MPU6050::setZAccelOffset(Calibration.zOffset);
+				return false;
 			}
+		}
 
-			// Interrupt pulses when triggered instead of remaining on until cleared.
-			MPU6050::setInterruptLatch(false);
+		// Apply calibration.
+		if (Calibration.Provided)
+		{
+			OffsetBuffer[0] = Calibration.xOffset >> 8;
+			OffsetBuffer[1] = Calibration.xOffset & 0xFF;
+			OffsetBuffer[2] = Calibration.yOffset >> 8;
+			OffsetBuffer[3] = Calibration.yOffset & 0xFF;
+			OffsetBuffer[4] = Calibration.zOffset >> 8;
+			OffsetBuffer[5] = Calibration.zOffset & 0xFF;
+			Twi->WriteRegisters(Address, RegisterAccelOffset, OffsetBuffer, sizeof(OffsetBuffer));
+			if (!Twi->Flush(SetupTimeoutMillis))
+			{
+				return false;
+			}
+		}
 
-			// Disable unused interrupts.
-			MPU6050::setIntFreefallEnabled(true);
-			MPU6050::setIntZeroMotionEnabled(false);
-			MPU6050::setIntDMPEnabled(false);
-			MPU6050::setIntFIFOBufferOverflowEnabled(false);
+#if defined(DEBUG_LOG) && defined(DEBUG_SENSOR)
+		CheckSettings();
+#endif
+		return true;
+	}
 
-			// Active - low, push-pull.
-			MPU6050::setInterruptMode(true);
-			MPU6050::setInterruptDrive(false);
+	void GetConfiguration(MovementSensorConfiguration& configuration)
+	{
+		configuration.XOffset = Calibration.xOffset;
+		configuration.YOffset = Calibration.yOffset;
+		configuration.ZOffset = Calibration.zOffset;
+		configuration.MotionThreshold = MotionDetectionThreshold;
+		configuration.MotionDuration = MotionDetectionThresholdDuration;
+	}
 
-			// Set thresholds.
-			MPU6050::setMotionDetectionThreshold(MotionDetectionThreshold);
-			MPU6050::setMotionDetectionDuration(MotionDetectionThresholdDuration);
+	// Returns false if the bus queue is full, completion is reported to listener.
+	bool SetSleep(ITwiListener* listener, const uint8_t token)
+	{
+		return Twi->WriteRegister(Address, RegisterPowerManagement1,
+			PowerSleep | PowerTemperatureDisabled | PowerClockPllXGyro, listener, token);
+	}
 
-			MPU6050::setZeroMotionDetectionThreshold(MotionDetectionThreshold);
-			MPU6050::setZeroMotionDetectionDuration(MotionDetectionThresholdDuration);
+	// Returns false if the bus queue is full, completion is reported to listener.
+	bool SetActiveMotionDetection(ITwiListener* listener, const uint8_t token)
+	{
+		return Twi->WriteRegister(Address, RegisterPowerManagement1,
+			PowerTemperatureDisabled | PowerClockPllXGyro, listener, token);
+	}
 
-			// Set sensor filter mode.
-			MPU6050::setDHPFMode(MPU6050_DHPF_RESET);
-			//MPU6050::setDLPFMode(MPU6050_DLPF_BW_256);
+	// Rounded down to the 2 mg step, at least one step.
+	// Returns false if the bus queue is full, completion is reported to listener.
+	bool SetMotionThreshold(const uint16_t milliG, ITwiListener* listener, const uint8_t token)
+	{
+		const uint16_t Steps = milliG / MotionThresholdMilliG;
 
-			// Enable motion detection interrupt.
-			MPU6050::setIntMotionEnabled(true);
+		MotionDetectionThreshold = Steps == 0 ? 1 : (Steps > UINT8_MAX ? UINT8_MAX : Steps);
 
-#if defined(DEBUG_LOG) && defined(DEBUG_SENSOR)
-			CheckSettings();
-#endif
-			return true;
-		}
-		else
-		{
-			return false;
-		}
+		return Twi->WriteRegister(Address, RegisterMotionThreshold, MotionDetectionThreshold, listener, token);
 	}
 
-	void SetSleep()
+	// Reads raw accelerometer output (6 bytes) into buffer, in one burst.
+	// Returns false if the bus queue is full, completion is reported to listener.
+	bool ReadAcceleration(uint8_t* buffer, ITwiListener* listener, const uint8_t token)
 	{
-		MPU6050::setSleepEnabled(true);
+		return Twi->ReadRegisters(Address, RegisterAccelOut, buffer, 6, listener, token);
 	}
 
-	void SetActiveMotionDetection()
+	// Axis 0 to 2 of a raw burst, big-endian at 16384 LSB per g.
+	int16_t GetAccelerationMilliG(const uint8_t* raw, const uint8_t axis)
 	{
-		MPU6050::setSleepEnabled(false);
-		SetLowPowerMode();
+		const int16_t Value = (raw[axis * 2] << 8) | raw[(axis * 2) + 1];
+
+		return ((int32_t)Value * 1000) / 16384;
 	}
 
-private:
-	void SetLowPowerMode()
+	// Returns false if the bus queue is full, completion is reported to listener.
+	bool SetGyroStandby(const bool standby, ITwiListener* listener, const uint8_t token)
 	{
-		// Not working.
-		//MPU6050::setWakeCycleEnabled(true);
-		///**LP_WAKE_CTRL | Wake - up Frequency
-		//	* ------------ - +------------------
-		//	* 0 | 1.25 Hz
-		//	* 1 | 2.5 Hz
-		//	* 2 | 5 Hz
-		//	* 3 | 10 Hz*/
-		//MPU6050::setWakeFrequency(10);
+		return Twi->WriteRegister(Address, RegisterPowerManagement2,
+			standby ? GyroStandby : GyroOn, listener, token);
 	}
 
-
-#if defined(DEBUG_LOG) && defined(DEBUG_SENSOR)
-	void CheckSettings()
+	// Reads raw gyro output (6 bytes) into buffer.
+	// Returns false if the bus queue is full, completion is reported to listener.
+	bool ReadGyro(uint8_t* buffer, ITwiListener* listener, const uint8_t token)
 	{
-		Serial.println();
-
-		Serial.print(F(" * Sleep Mode:                "));
-		Serial.println(MPU6050::getSleepEnabled() ? F("Enabled") : F("Disabled"));
+		return Twi->ReadRegisters(Address, RegisterGyroOut, buffer, 6, listener, token);
+	}
 
-		Serial.print(F(" * Motion Interrupt:     "));
-		Serial.println(MPU6050::getIntMotionEnabled() ? F("Enabled") : F("Disabled"));
+	// Sum of absolute rates on all axes, bias removed. 131 LSB per deg/s.
+	uint16_t GetRotationRate(const uint8_t* raw)
+	{
+		uint16_t Rate = 0;
 
-		Serial.print(F(" * Zero Motion Interrupt:     "));
-		Serial.println(MPU6050::getIntZeroMotionEnabled() ? F("Enabled") : F("Disabled"));
+		for (uint8_t i = 0; i < 3; i++)
+		{
+			const int32_t Axis = (int16_t)((raw[i * 2] << 8) | raw[(i * 2) + 1]) - (int32_t)GyroBias[i];
+			const uint32_t Sum = (uint32_t)Rate + (Axis < 0 ? -Axis : Axis);
 
-		Serial.print(F(" * Free Fall Interrupt:       "));
-		Serial.println(MPU6050::getIntFreefallEnabled() ? F("Enabled") : F("Disabled"));
+			Rate = Sum > UINT16_MAX ? UINT16_MAX : Sum;
+		}
 
-		Serial.print(F(" * Motion Threshold:          "));
-		Serial.println(MPU6050::getMotionDetectionThreshold());
+		return Rate;
+	}
 
-		Serial.print(F(" * Motion Duration:           "));
-		Serial.println(MPU6050::getMotionDetectionDuration());
+	// Blocks for about GyroStartupMillis, boot only. The bike should be still.
+	bool CalibrateGyro(const uint32_t startupMillis)
+	{
+		uint8_t Raw[6];
+		int32_t Sum[3] = { 0, 0, 0 };
 
-		Serial.print(F(" * Zero Motion Threshold:     "));
-		Serial.println(MPU6050::getZeroMotionDetectionThreshold());
+		Twi->WriteRegister(Address, RegisterPowerManagement2, GyroOn);
+		if (!Twi->Flush(SetupTimeoutMillis))
+		{
+			return false;
+		}
+		HalTime::Delay(startupMillis);
 
-		Serial.print(F(" * Zero Motion Duration:      "));
-		Serial.println(MPU6050::getZeroMotionDetectionDuration());
+		for (uint8_t i = 0; i < GyroBiasSamples; i++)
+		{
+			Twi->ReadRegisters(Address, RegisterGyroOut, Raw, sizeof(Raw));
+			if (!Twi->Flush(SetupTimeoutMillis))
+			{
+				return false;
+			}
 
-		/*	Serial.print(" * Clock Source:              ");
-			switch (getClockSource())
+			for (uint8_t j = 0; j < 3; j++)
 			{
-			case MPU6050_CLOCK_KEEP_RESET:     Serial.println("Stops the clock and keeps the timing generator in reset"); break;
-			case MPU6050_CLOCK_PLL_EXT19M: Serial.println("PLL with external 19.2MHz reference"); break;
-			case MPU6050_CLOCK_PLL_EXT32K: Serial.println("PLL with external 32.768kHz reference"); break;
-			case MPU6050_CLOCK_PLL_ZGYRO:      Serial.println("PLL with Z axis gyroscope reference"); break;
-			case MPU6050_CLOCK_PLL_YGYRO:      Serial.println("PLL with Y axis gyroscope reference"); break;
-			case MPU6050_CLOCK_PLL_XGYRO:      Serial.println("PLL with X axis gyroscope reference"); break;
-			case MPU6050_CLOCK_INTERNAL:  Serial.println("Internal 8MHz oscillator"); break;
-			}*/
-
-		Serial.print(F(" * Accelerometer:             "));
-		switch (MPU6050::getFullScaleAccelRange())
+				Sum[j] += (int16_t)((Raw[j * 2] << 8) | Raw[(j * 2) + 1]);
+			}
+			HalTime::Delay(1);
+		}
+
+		for (uint8_t j = 0; j < 3; j++)
 		{
-		case 3:            Serial.println(F("+/- 16 g")); break;
-		case 2:             Serial.println(F("+/- 8 g")); break;
-		case 1:             Serial.println(F("+/- 4 g")); break;
-		case 0:             Serial.println(F("+/- 2 g")); break;
+			GyroBias[j] = Sum[j] / GyroBiasSamples;
 		}
 
-		Serial.print(F(" * Accelerometer offsets:     "));
-		Serial.print(MPU6050::getXAccelOffset());
-		Serial.print(F(" / "));
-		Serial.print(MPU6050::getYAccelOffset());
-		Serial.print(F(" / "));
-		Serial.println(MPU6050::getZAccelOffset());
+		Twi->WriteRegister(Address, RegisterPowerManagement2, GyroStandby);
+
+		return Twi->Flush(SetupTimeoutMillis);
+	}
+
+private:
+#if defined(DEBUG_LOG) && defined(DEBUG_SENSOR)
+	void CheckSettings()
+	{
+		uint8_t Value = 0;
 
-		Serial.print(F(" * Accelerometer power delay: "));
-		switch (MPU6050::getAccelerometerPowerOnDelay())
+		MPU6050RegisterValue Step;
+		for (uint8_t i = 0; i < SetupSequenceSize; i++)
 		{
-		case 3:            Serial.println(F("3ms")); break;
-		case 2:            Serial.println(F("2ms")); break;
-		case 1:            Serial.println(F("1ms")); break;
-		case 0:             Serial.println(F("0ms")); break;
+			memcpy_P(&Step, &MPU6050SetupSequence[i], sizeof(MPU6050RegisterValue));
+			Twi->ReadRegisters(Address, Step.Register, &Value, 1);
+			Twi->Flush(SetupTimeoutMillis);
+
+			// Ring is small, drain it between registers.
+			TraceLog::Write<TraceEnum::SensorRegister>(Step.Register, Value, Step.Value);
+			TraceLog::Flush();
 		}
 
-		Serial.println();
+		TraceLog::Write<TraceEnum::SensorOffsets>(Calibration.xOffset, Calibration.yOffset, Calibration.zOffset);
+		TraceLog::Flush();
 	}
 #endif
 };
 
 #endif
-
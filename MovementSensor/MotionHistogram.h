@@ -0,0 +1,108 @@
+// MotionHistogram.h
+
+#ifndef _MOTIONHISTOGRAM_h
+#define _MOTIONHISTOGRAM_h
+
+#include <stdint.h>
+
+/* Ring of motion event counts, one bucket per (1 << BucketShift) ms.
+	Record and Count are bounded by BucketCount, independent of the event rate.
+	Counts saturate at 255 per bucket.
+	Not interrupt safe, callers outside the recording ISR must mask interrupts. */
+template<const uint8_t BucketCount, const uint8_t BucketShift>
+class MotionHistogram
+{
+	static_assert(BucketCount > 0 && (BucketCount & (BucketCount - 1)) == 0, "Bucket count must be a power of 2.");
+
+public:
+	static const uint32_t BucketMillis = (uint32_t)1 << BucketShift;
+	static const uint32_t SpanMillis = BucketMillis * BucketCount;
+
+private:
+	uint8_t Buckets[BucketCount];
+
+	uint32_t CurrentSlot = 0;
+	uint8_t CurrentIndex = 0;
+
+public:
+	MotionHistogram()
+	{
+		Clear(0);
+	}
+
+	void Clear(const uint32_t now)
+	{
+		for (uint8_t i = 0; i < BucketCount; i++)
+		{
+			Buckets[i] = 0;
+		}
+
+		CurrentSlot = now >> BucketShift;
+		CurrentIndex = 0;
+	}
+
+	void Record(const uint32_t now)
+	{
+		Advance(now);
+
+		if (Buckets[CurrentIndex] < UINT8_MAX)
+		{
+			Buckets[CurrentIndex]++;
+		}
+	}
+
+	// Events within the last period, rounded up to whole buckets and clamped to the span.
+	uint16_t Count(const uint32_t now, const uint32_t period)
+	{
+		Advance(now);
+
+		uint8_t Slots = BucketCount;
+		if (period < SpanMillis)
+		{
+			Slots = (period >> BucketShift) + 1;
+		}
+
+		uint16_t Total = 0;
+		uint8_t Index = CurrentIndex;
+		for (uint8_t i = 0; i < Slots; i++)
+		{
+			Total += Buckets[Index];
+			Index = (Index - 1) & (BucketCount - 1);
+		}
+
+		return Total;
+	}
+
+private:
+	// Clears the buckets that went stale since the last call.
+	void Advance(const uint32_t now)
+	{
+		const uint32_t Slot = now >> BucketShift;
+		const uint32_t Stale = Slot - CurrentSlot;
+
+		if (Stale == 0)
+		{
+			return;
+		}
+
+		CurrentSlot = Slot;
+
+		if (Stale >= BucketCount)
+		{
+			for (uint8_t i = 0; i < BucketCount; i++)
+			{
+				Buckets[i] = 0;
+			}
+			CurrentIndex = 0;
+		}
+		else
+		{
+			for (uint8_t i = 0; i < (uint8_t)Stale; i++)
+			{
+				CurrentIndex = (CurrentIndex + 1) & (BucketCount - 1);
+				Buckets[CurrentIndex] = 0;
+			}
+		}
+	}
+};
+#endif
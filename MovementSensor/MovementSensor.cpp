@@ -1,15 +0,0 @@
-#include "MovementSensor.h"
-
-
-MovementSensor* StaticMovementSensorReference = nullptr;
-
-static void StaticOnSensorInterrupt()
-{
-	StaticMovementSensorReference->OnPinInterrupt();
-}
-
-void MovementSensor::AttachInterrupt()
-{
-	StaticMovementSensorReference = this;
-	attachInterrupt(SensorInterruptPin, StaticOnSensorInterrupt, LOW);
-}
\ No newline at end of file
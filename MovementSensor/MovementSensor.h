@@ -7,77 +7,168 @@
 #include <TaskSchedulerDeclarations.h>
 
 
-#include "..\IMovementSensor.h"
-#include "..\Event\EventTask.h"
-#include "MPU6050\MPU6050Sensor.h"
+#include "../IMovementSensor.h"
+#include "../AlarmConstants.h"
+#include "../ITwiListener.h"
+#include "../Event/EventTask.h"
+#include "../Timebase/Timebase.h"
+#include "../Twi/TwiDriver.h"
+#include "../Hal/Hal.h"
+#include "MotionHistogram.h"
+#include "GyroConfirmation.h"
+#include "MPU6050/MPU6050Sensor.h"
+#include "LIS3DH/LIS3DHSensor.h"
 
-class MovementSensor : EventTask
+/* Motion interrupt counting and coalescing, over an accelerometer driver picked at compile time.
+	SensorDriver provides, with no virtual calls:
+	- Constructor, from the arguments after the scheduler.
+	- bool Setup(): blocking, boot only.
+	- bool SetSleep(ITwiListener*, token) and bool SetActiveMotionDetection(ITwiListener*, token):
+		lowest power, and wake-on-motion pulling SensorPin low for each motion.
+	- bool SetMotionThreshold(milliG, ITwiListener*, token).
+	- bool ReadAcceleration(buffer[6], ITwiListener*, token), one burst,
+		and int16_t GetAccelerationMilliG(buffer, axis) to decode it.
+	- void GetConfiguration(MovementSensorConfiguration&).
+	Runtime calls only queue bus transactions and return false if the queue is full.
+	GyroConfirmation needs the MPU6050Sensor. */
+template<const uint8_t SensorPin,
+	typename SensorDriver = MPU6050Sensor,
+	typename EventBus = RuntimeEventBus,
+	const uint32_t CoalesceWindowMillis = MOTION_COALESCE_WINDOW_MILLIS>
+class MovementSensor : EventTask<EventBus>
 	, public virtual IMovementSensor
+	, public virtual ITwiListener
+	, public virtual IEventListener
 {
 private:
-	const uint8_t SensorPin;
-	const uint8_t SensorInterruptPin;
+	static const uint32_t BusRetryMillis = 10;
+
+	typedef FastPin<SensorPin> Pin;
+	typedef ExternalInterrupt<SensorPin> Interrupt;
+
+	static_assert(CoalesceWindowMillis > 0, "Coalesce window must not be empty.");
+
+	static MovementSensor* Instance;
 
 	uint32_t MotionLastTriggered = 0;
 
+	// Interrupts since the last forwarded event.
+	volatile uint8_t PendingEvents = 0;
+
+	volatile uint16_t MotionEventCount = 0;
+
+	// 32 buckets of 128 ms, about 4 s of history in 32 bytes.
+	MotionHistogram<32, 7> MotionHistory;
+
 	enum StateEnum : uint8_t
 	{
 		Disabled,
 		Active,
-		MotionDetectionTriggered,
+		Listening,
+		Coalescing
+	};
+
+	// Bus transaction tokens, match the state that requested them.
+	enum TokenEnum : uint8_t
+	{
+		TokenSleep,
+		TokenActive
 	};
 
 	volatile StateEnum State = StateEnum::Disabled;
 
-	MPU6050Sensor Sensor;
+	SensorDriver Sensor;
+
+	// Optional.
+	GyroConfirmation* Confirmation = nullptr;
 
 public:
-	MovementSensor(Scheduler* scheduler, const uint8_t sensorPin,
-		const int16_t xOffset,
-		const int16_t yOffset,
-		const int16_t zOffset)
-		: EventTask(scheduler)
+	template<typename... DriverArguments>
+	MovementSensor(Scheduler* scheduler, DriverArguments... driverArguments)
+		: EventTask<EventBus>(scheduler)
 		, IMovementSensor()
-		, SensorPin(sensorPin)
-		, SensorInterruptPin(digitalPinToInterrupt(sensorPin))
-		, Sensor(xOffset, yOffset, zOffset)
-
+		, Sensor(driverArguments...)
 	{
-		pinMode(SensorPin, INPUT_PULLUP);
+		Pin::SetInputPullup();
 	}
 
-	virtual bool Setup(IEventListener* eventListener)
+	virtual bool Setup(IEventListener* eventListener = nullptr)
 	{
-		if (!EventTask::Setup(eventListener))
+		if (!EventTask<EventBus>::Setup(eventListener))
 		{
 			return false;
 		}
 
 		State = StateEnum::Disabled;
+		Interrupt::Detach();
 
-		if (SensorInterruptPin != NOT_AN_INTERRUPT)
-		{
-			detachInterrupt(SensorInterruptPin);
+		return Sensor.Setup();
+	}
 
-			return Sensor.Setup();
-		}
-		else
+	// Optional, after Setup. MPU6050Sensor only.
+	bool SetupConfirmation(GyroConfirmation* confirmation)
+	{
+		Confirmation = confirmation;
+
+		return Confirmation != nullptr && Confirmation->Setup(&Sensor, this);
+	}
+
+	virtual bool HasRecentSignificantMotion(const uint32_t period)
+	{
+		return Timebase::Millis() - MotionLastTriggered < period;
+	}
+
+	virtual uint16_t GetMotionEventCount()
+	{
+		noInterrupts();
+		const uint16_t Count = MotionEventCount;
+		interrupts();
+
+		return Count;
+	}
+
+	virtual uint16_t GetMotionDensity(const uint32_t period)
+	{
+		noInterrupts();
+		const uint16_t Count = MotionHistory.Count(Timebase::Millis(), period);
+		interrupts();
+
+		return Count;
+	}
+
+	virtual uint16_t GetRotationEventCount()
+	{
+		if (Confirmation == nullptr)
 		{
-			return false;
+			return 0;
 		}
 
+		return Confirmation->GetConfirmedCount();
 	}
 
-	virtual bool HasRecentSignificantMotion(const uint32_t period)
+	// Rotation confirmed, weighs as an extra motion event.
+	virtual void OnEvent()
 	{
-		return millis() - MotionLastTriggered < period;
+		if (State == StateEnum::Listening || State == StateEnum::Coalescing)
+		{
+			noInterrupts();
+			RecordMotion();
+			interrupts();
+
+			EventBus::Publish();
+		}
+	}
+
+	virtual void GetConfiguration(MovementSensorConfiguration& configuration)
+	{
+		Sensor.GetConfiguration(configuration);
 	}
 
 	virtual void Enable()
 	{
-		if (State != StateEnum::Active)
+		if (State == StateEnum::Disabled)
 		{
-			detachInterrupt(SensorInterruptPin);
+			Interrupt::Detach();
 			State = StateEnum::Active;
 
 			Task::enableIfNot();
@@ -87,8 +178,8 @@ public:
 
 	virtual void Disable()
 	{
-		detachInterrupt(SensorInterruptPin);
-		pinMode(SensorPin, INPUT);
+		Interrupt::Detach();
+		Pin::SetInput();
 		State = StateEnum::Disabled;
 		Task::enableIfNot();
 		Task::forceNextIteration();
@@ -96,27 +187,35 @@ public:
 
 	bool Callback()
 	{
-		uint32_t Timestamp = millis();
-
 		switch (State)
 		{
 		case StateEnum::Disabled:
-			Task::disable();
-
-			Sensor.SetSleep();
+			if (Sensor.SetSleep(this, TokenEnum::TokenSleep))
+			{
+				Task::disable();
+			}
+			else
+			{
+				// Bus queue full, try again later.
+				Task::delay(BusRetryMillis);
+			}
 			break;
 		case StateEnum::Active:
-			Task::disable();
-			pinMode(SensorPin, INPUT_PULLUP);
-			Sensor.SetActiveMotionDetection();
-			AttachInterrupt();
+			if (Sensor.SetActiveMotionDetection(this, TokenEnum::TokenActive))
+			{
+				Task::disable();
+				State = StateEnum::Listening;
+				Pin::SetInputPullup();
+				AttachInterrupt();
+			}
+			else
+			{
+				// Bus queue full, try again later.
+				Task::delay(BusRetryMillis);
+			}
 			break;
-		case StateEnum::MotionDetectionTriggered:
-			State = StateEnum::Active;
-			Task::enableIfNot();
-			Task::forceNextIteration();
-
-			EventListener->OnEvent();
+		case StateEnum::Coalescing:
+			CloseWindow();
 			break;
 		default:
 			Task::disable();
@@ -126,30 +225,106 @@ public:
 		return true;
 	}
 
-	void OnPinInterrupt()
+	// Bus transaction completed, from the TWI driver task.
+	virtual void OnTwiComplete(const uint8_t token, const bool success)
 	{
-		detachInterrupt(SensorInterruptPin);
-		pinMode(SensorPin, INPUT);
+		if (success)
+		{
+			return;
+		}
+
+		// Retry only if the failed request is still relevant.
+		if (token == TokenEnum::TokenSleep && State == StateEnum::Disabled)
+		{
+			Task::enableIfNot();
+			Task::delay(BusRetryMillis);
+		}
+		else if (token == TokenEnum::TokenActive && State != StateEnum::Disabled)
+		{
+			// Sensor may not be detecting, configure again.
+			Interrupt::Detach();
+			State = StateEnum::Active;
+			Task::enableIfNot();
+			Task::delay(BusRetryMillis);
+		}
+	}
 
+	// Sensor pulses on each motion, counted here without waking the task.
+	void OnPinInterrupt()
+	{
 		switch (State)
 		{
-		case StateEnum::Disabled:
-			break;
-		case StateEnum::Active:
-			MotionLastTriggered = millis();
-			State = StateEnum::MotionDetectionTriggered;
+		case StateEnum::Listening:
+			RecordMotion();
+			PendingEvents = 1;
+			State = StateEnum::Coalescing;
 			Task::enableIfNot();
 			Task::forceNextIteration();
+
+			// At most one check per window.
+			if (Confirmation != nullptr)
+			{
+				Confirmation->Start();
+			}
 			break;
-		case StateEnum::MotionDetectionTriggered:
-			MotionLastTriggered = millis();
+		case StateEnum::Coalescing:
+			RecordMotion();
+			if (PendingEvents < UINT8_MAX)
+			{
+				PendingEvents++;
+			}
 			break;
 		default:
+			Interrupt::Detach();
 			break;
 		}
 	}
 
 private:
-	void AttachInterrupt();
+	void RecordMotion()
+	{
+		MotionLastTriggered = Timebase::Millis();
+		MotionEventCount++;
+		MotionHistory.Record(MotionLastTriggered);
+	}
+
+	/* The first interrupt is forwarded straight away and opens a window.
+		Interrupts during the window are forwarded as one event when it ends,
+		which opens another window. A window without interrupts goes back to listening. */
+	void CloseWindow()
+	{
+		noInterrupts();
+		const uint8_t Pending = PendingEvents;
+		PendingEvents = 0;
+		if (Pending == 0)
+		{
+			State = StateEnum::Listening;
+		}
+		interrupts();
+
+		if (Pending > 0)
+		{
+			Task::delay(CoalesceWindowMillis);
+			EventBus::Publish();
+		}
+		else
+		{
+			Task::disable();
+		}
+	}
+
+	static void OnInterrupt()
+	{
+		Instance->OnPinInterrupt();
+	}
+
+	void AttachInterrupt()
+	{
+		Instance = this;
+		Interrupt::Attach(OnInterrupt, Interrupt::SenseEnum::Falling);
+	}
 };
+
+template<const uint8_t SensorPin, typename SensorDriver, typename EventBus, const uint32_t CoalesceWindowMillis>
+MovementSensor<SensorPin, SensorDriver, EventBus, CoalesceWindowMillis>* MovementSensor<SensorPin, SensorDriver, EventBus, CoalesceWindowMillis>::Instance = nullptr;
 #endif
\ No newline at end of file
@@ -0,0 +1,428 @@
+// AlarmNotifier.h
+
+#ifndef _ALARMNOTIFIER_h
+#define _ALARMNOTIFIER_h
+
+#define _TASK_OO_CALLBACKS
+#include <TaskSchedulerDeclarations.h>
+
+#include <Arduino.h>
+
+#include "../IAlarmOutput.h"
+#include "../IMovementSensor.h"
+#include "../IBatteryMonitor.h"
+#include "../AlarmConstants.h"
+#include "../Event/DeadlineQueue.h"
+#include "../Timebase/Timebase.h"
+#include "../Hal/Hal.h"
+
+#if defined(ALARM_NOTIFIER) && (defined(DEBUG_LOG) || defined(DIAGNOSTIC_PORT) || defined(LIGHT_USART_OUTPUT))
+#error AlarmNotifier, DEBUG_LOG, DIAGNOSTIC_PORT and LIGHT_USART_OUTPUT all use USART0.
+#endif
+
+/* Notification frames to an external GSM/LoRa module on USART0, NOTIFY_BAUD_RATE 8N1.
+	Driven as an alarm output, each state change becomes one frame.
+	Changes within NOTIFY_COALESCE_MILLIS are sent as one, with the last state.
+	The USART is powered only while a frame is in flight, TX idles high in between.
+
+	Frame:	[Sync][Sequence][Event][Timestamp u32][MotionDensity][BatteryMilliVolts u16][Checksum]
+	Ack:	[AckSync][Sequence]
+	Checksum is the XOR of all preceding bytes in the frame. Multi-byte values are little-endian.
+	MotionDensity is motion events per minute since the previous frame, saturated.
+	Unacknowledged frames are retried every NOTIFY_RETRY_PERIOD_MILLIS, up to NOTIFY_MAX_ATTEMPTS.
+	Frames are sent in order. If the queue is full, the newest queued frame is replaced.
+	Tools/NotificationReceiver.py stands in for the module.
+*/
+class AlarmNotifier;
+extern AlarmNotifier* StaticAlarmNotifierReference;
+
+class AlarmNotifier : Task, public virtual IAlarmOutput
+{
+	static_assert(NOTIFY_QUEUE_CAPACITY > 1, "A full queue replaces its newest frame, never the head in flight.");
+
+public:
+	static const uint8_t Sync = 0xC3;
+	static const uint8_t AckSync = 0x3C;
+
+	// Wire values, append only.
+	enum EventEnum : uint8_t
+	{
+		None = 0,
+		Error = 1,
+		NotArmed = 2,
+		ArmingFailed = 3,
+		Armed = 4,
+		EarlyWarning = 5,
+		Alarm = 6
+	};
+
+private:
+	typedef FastPin<0> RxPin;
+	typedef FastPin<1> TxPin;
+
+	static const uint8_t FrameSize = 11;
+
+	// Frame transmit time at 10 bits per byte, rounded up.
+	static const uint32_t FrameMillis = ((FrameSize * 10UL * 1000UL) / NOTIFY_BAUD_RATE) + 1;
+
+	struct Notification
+	{
+		uint32_t Timestamp;
+		uint16_t BatteryMilliVolts;
+		uint8_t Sequence;
+		uint8_t Event;
+		uint8_t MotionDensity;
+		uint8_t Attempts;
+	};
+
+	enum DeadlineEnum : uint8_t
+	{
+		Coalesce,
+		Ack,
+		Retry,
+		DeadlineCount
+	};
+
+	IMovementSensor* MovementDetector = nullptr;
+	IBatteryMonitor* Battery = nullptr;
+
+	DeadlineQueue<DeadlineEnum::DeadlineCount> Deadlines;
+
+	Notification Queue[NOTIFY_QUEUE_CAPACITY];
+	uint8_t QueueHead = 0;
+	uint8_t QueueCount = 0;
+
+	EventEnum PendingEvent = EventEnum::None;
+	EventEnum LastEvent = EventEnum::None;
+	uint8_t NextSequence = 0;
+
+	uint32_t LastFrameTimestamp = 0;
+	uint16_t LastMotionEventCount = 0;
+
+	// Frame in flight, drained from USART UDRE ISR.
+	uint8_t TxBuffer[FrameSize];
+	volatile uint8_t TxIndex = 0;
+	volatile uint8_t TxSize = 0;
+
+	// Ack parsing, from USART RX ISR.
+	volatile bool AckReceived = false;
+	volatile uint8_t AckSequence = 0;
+	bool AckSyncSeen = false;
+
+	bool Powered = false;
+	bool Sending = false;
+
+	uint16_t SentCount = 0;
+	uint16_t DroppedCount = 0;
+
+public:
+	AlarmNotifier(Scheduler* scheduler)
+		: Task(0, TASK_FOREVER, scheduler, false)
+		, IAlarmOutput()
+	{
+	}
+
+	bool Setup(IMovementSensor* movementSensor, IBatteryMonitor* battery)
+	{
+		MovementDetector = movementSensor;
+		Battery = battery;
+
+		if (MovementDetector == nullptr ||
+			Battery == nullptr)
+		{
+			return false;
+		}
+
+		StaticAlarmNotifierReference = this;
+		HalUsart::AttachReceive(OnUsartReceive);
+		HalUsart::AttachTransmit(OnUsartTransmit);
+		LastFrameTimestamp = Timebase::Millis();
+		LastMotionEventCount = MovementDetector->GetMotionEventCount();
+		PowerDown();
+
+		return true;
+	}
+
+	uint16_t GetSentCount()
+	{
+		return SentCount;
+	}
+
+	uint16_t GetDroppedCount()
+	{
+		return DroppedCount;
+	}
+
+	virtual uint8_t GetPatterns()
+	{
+		return PatternEnum::Error
+			| PatternEnum::NotArmed
+			| PatternEnum::ArmingFailed
+			| PatternEnum::Armed
+			| PatternEnum::EarlyWarning
+			| PatternEnum::Alarm;
+	}
+
+	virtual void PlayError()
+	{
+		Notify(EventEnum::Error);
+	}
+
+	virtual void PlayNotArmed()
+	{
+		Notify(EventEnum::NotArmed);
+	}
+
+	virtual void PlayArmingFailed()
+	{
+		Notify(EventEnum::ArmingFailed);
+	}
+
+	virtual void PlayArmed()
+	{
+		Notify(EventEnum::Armed);
+	}
+
+	virtual void PlayEarlyWarning()
+	{
+		Notify(EventEnum::EarlyWarning);
+	}
+
+	virtual void PlayAlarm()
+	{
+		Notify(EventEnum::Alarm);
+	}
+
+	bool Callback()
+	{
+		const uint32_t Now = Timebase::Millis();
+
+		if (Deadlines.Expire(DeadlineEnum::Coalesce, Now))
+		{
+			Enqueue(Now);
+		}
+
+		if (Sending && (AckReceived || Deadlines.Expire(DeadlineEnum::Ack, Now)))
+		{
+			Deadlines.Cancel(DeadlineEnum::Ack);
+			Sending = false;
+
+			if (AckReceived && AckSequence == Queue[QueueHead].Sequence)
+			{
+				SentCount++;
+				Pop();
+			}
+			else if (++Queue[QueueHead].Attempts >= NOTIFY_MAX_ATTEMPTS)
+			{
+				DroppedCount++;
+				Pop();
+			}
+			else
+			{
+				Deadlines.Set(DeadlineEnum::Retry, Now, NOTIFY_RETRY_PERIOD_MILLIS);
+			}
+		}
+
+		Deadlines.Expire(DeadlineEnum::Retry, Now);
+
+		if (!Sending && QueueCount > 0 && !Deadlines.IsActive(DeadlineEnum::Retry))
+		{
+			// Queued frames go out in the same burst.
+			Send(Now);
+		}
+		else if (!Sending && Powered)
+		{
+			PowerDown();
+		}
+
+		uint32_t Delay = 0;
+		if (Deadlines.GetNextDelay(Now, Delay))
+		{
+			Task::delay(Delay);
+		}
+		else
+		{
+			Task::disable();
+		}
+
+		return true;
+	}
+
+	void OnRxInterrupt()
+	{
+		const uint8_t Value = HalUsart::Read();
+
+		if (!AckSyncSeen)
+		{
+			AckSyncSeen = Value == AckSync;
+		}
+		else
+		{
+			AckSyncSeen = false;
+			AckSequence = Value;
+			AckReceived = true;
+
+			Task::forceNextIteration();
+		}
+	}
+
+	void OnTxReadyInterrupt()
+	{
+		if (TxIndex < TxSize)
+		{
+			HalUsart::Write(TxBuffer[TxIndex++]);
+		}
+		else
+		{
+			HalUsart::DisableTransmitInterrupt();
+			TxSize = 0;
+		}
+	}
+
+private:
+	static void OnUsartReceive();
+	static void OnUsartTransmit();
+
+	void Notify(const EventEnum event)
+	{
+		PendingEvent = event;
+
+		if (!Deadlines.IsActive(DeadlineEnum::Coalesce))
+		{
+			Deadlines.Set(DeadlineEnum::Coalesce, Timebase::Millis(), NOTIFY_COALESCE_MILLIS);
+
+			// Reschedules on the nearest deadline.
+			Task::enableIfNot();
+			Task::forceNextIteration();
+		}
+	}
+
+	void Enqueue(const uint32_t now)
+	{
+		// A change and back within the window is no change.
+		if (PendingEvent == EventEnum::None || PendingEvent == LastEvent)
+		{
+			PendingEvent = EventEnum::None;
+
+			return;
+		}
+
+		uint8_t Slot;
+		if (QueueCount < NOTIFY_QUEUE_CAPACITY)
+		{
+			Slot = (QueueHead + QueueCount) % NOTIFY_QUEUE_CAPACITY;
+			QueueCount++;
+		}
+		else
+		{
+			// Keep the head, it may be in flight.
+			Slot = (QueueHead + QueueCount - 1) % NOTIFY_QUEUE_CAPACITY;
+			DroppedCount++;
+		}
+
+		const uint16_t MotionEventCount = MovementDetector->GetMotionEventCount();
+		const uint32_t Events = (uint16_t)(MotionEventCount - LastMotionEventCount);
+		const uint32_t Elapsed = now - LastFrameTimestamp;
+		const uint32_t Density = Elapsed == 0 ? UINT8_MAX : (Events * 60000UL) / Elapsed;
+
+		Notification& Entry = Queue[Slot];
+		Entry.Timestamp = now;
+		Entry.BatteryMilliVolts = Battery->GetMilliVolts();
+		Entry.Sequence = NextSequence++;
+		Entry.Event = PendingEvent;
+		Entry.MotionDensity = Density > UINT8_MAX ? UINT8_MAX : Density;
+		Entry.Attempts = 0;
+
+		LastEvent = PendingEvent;
+		PendingEvent = EventEnum::None;
+		LastFrameTimestamp = now;
+		LastMotionEventCount = MotionEventCount;
+	}
+
+	void Pop()
+	{
+		QueueHead = (QueueHead + 1) % NOTIFY_QUEUE_CAPACITY;
+		QueueCount--;
+	}
+
+	void Send(const uint32_t now)
+	{
+		const Notification& Entry = Queue[QueueHead];
+
+		if (!Powered)
+		{
+			PowerUp();
+		}
+
+		TxBuffer[0] = Sync;
+		TxBuffer[1] = Entry.Sequence;
+		TxBuffer[2] = Entry.Event;
+		memcpy(&TxBuffer[3], &Entry.Timestamp, sizeof(uint32_t));
+		TxBuffer[7] = Entry.MotionDensity;
+		memcpy(&TxBuffer[8], &Entry.BatteryMilliVolts, sizeof(uint16_t));
+
+		uint8_t Checksum = 0;
+		for (uint8_t i = 0; i < FrameSize - 1; i++)
+		{
+			Checksum ^= TxBuffer[i];
+		}
+		TxBuffer[FrameSize - 1] = Checksum;
+
+		Sending = true;
+		Deadlines.Set(DeadlineEnum::Ack, now, FrameMillis + NOTIFY_ACK_TIMEOUT_MILLIS);
+
+		noInterrupts();
+		AckReceived = false;
+		AckSyncSeen = false;
+		TxIndex = 0;
+		TxSize = FrameSize;
+		HalUsart::EnableTransmitInterrupt();
+		interrupts();
+	}
+
+	void PowerUp()
+	{
+		// Baud rate needs the full clock.
+		Timebase::RequestFine(Timebase::ClientEnum::Notifier);
+
+		HalPower::Enable(PeripheralEnum::Usart0);
+		HalUsart::Enable(NOTIFY_BAUD_RATE, true);
+
+		Powered = true;
+	}
+
+	void PowerDown()
+	{
+		HalUsart::Disable();
+		HalPower::Disable(PeripheralEnum::Usart0);
+
+		// Idle line for the module, no start bits while off.
+		TxPin::High();
+		TxPin::SetOutput();
+		RxPin::SetInputPullup();
+
+		if (Powered)
+		{
+			Timebase::ReleaseFine(Timebase::ClientEnum::Notifier);
+		}
+
+		Powered = false;
+	}
+};
+
+// Interrupt glue, include this header only from the sketch.
+#ifdef ALARM_NOTIFIER
+AlarmNotifier* StaticAlarmNotifierReference = nullptr;
+
+void AlarmNotifier::OnUsartReceive()
+{
+	StaticAlarmNotifierReference->OnRxInterrupt();
+}
+
+void AlarmNotifier::OnUsartTransmit()
+{
+	StaticAlarmNotifierReference->OnTxReadyInterrupt();
+}
+#endif
+
+#endif
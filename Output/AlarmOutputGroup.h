@@ -0,0 +1,156 @@
+// AlarmOutputGroup.h
+
+#ifndef _ALARMOUTPUTGROUP_h
+#define _ALARMOUTPUTGROUP_h
+
+#include <stdint.h>
+
+#include "../IAlarmOutput.h"
+
+// Fans every output command out to up to Capacity outputs, in the order they were added.
+// Each output only gets the patterns it implements (GetPatterns), optionally narrowed when added.
+// For the others it gets Stop(), so it never keeps playing a stale pattern.
+template<const uint8_t Capacity>
+class AlarmOutputGroup : public virtual IAlarmOutput
+{
+	static_assert(Capacity > 0, "At least one output.");
+
+private:
+	struct Sink
+	{
+		IAlarmOutput* Output;
+		uint8_t Patterns;
+	};
+
+	Sink Sinks[Capacity];
+	uint8_t Count = 0;
+
+public:
+	AlarmOutputGroup()
+		: IAlarmOutput()
+	{
+	}
+
+	// Setup time only. Returns false if output is null or the group is full.
+	bool Add(IAlarmOutput* output, const uint8_t patterns = AllPatterns)
+	{
+		if (output == nullptr || Count >= Capacity)
+		{
+			return false;
+		}
+
+		Sinks[Count].Output = output;
+		Sinks[Count].Patterns = output->GetPatterns() & patterns;
+		Count++;
+
+		return true;
+	}
+
+	uint8_t GetCount()
+	{
+		return Count;
+	}
+
+	virtual uint8_t GetPatterns()
+	{
+		uint8_t Patterns = 0;
+
+		for (uint8_t i = 0; i < Count; i++)
+		{
+			Patterns |= Sinks[i].Patterns;
+		}
+
+		return Patterns;
+	}
+
+	virtual void Buzz(const uint32_t durationMillis)
+	{
+		for (uint8_t i = 0; i < Count; i++)
+		{
+			if (Sinks[i].Patterns & PatternEnum::Generic)
+			{
+				Sinks[i].Output->Buzz(durationMillis);
+			}
+			else
+			{
+				Sinks[i].Output->Stop();
+			}
+		}
+	}
+
+	virtual void Stop()
+	{
+		for (uint8_t i = 0; i < Count; i++)
+		{
+			Sinks[i].Output->Stop();
+		}
+	}
+
+	virtual void SetEnergyLevel(const uint8_t level)
+	{
+		for (uint8_t i = 0; i < Count; i++)
+		{
+			Sinks[i].Output->SetEnergyLevel(level);
+		}
+	}
+
+	virtual void SetPrimed(const bool primed)
+	{
+		for (uint8_t i = 0; i < Count; i++)
+		{
+			Sinks[i].Output->SetPrimed(primed);
+		}
+	}
+
+	virtual void PlayError()
+	{
+		Play(PatternEnum::Error, &IAlarmOutput::PlayError);
+	}
+
+	virtual void PlayArmed()
+	{
+		Play(PatternEnum::Armed, &IAlarmOutput::PlayArmed);
+	}
+
+	virtual void PlayArming()
+	{
+		Play(PatternEnum::Arming, &IAlarmOutput::PlayArming);
+	}
+
+	virtual void PlayArmingFailed()
+	{
+		Play(PatternEnum::ArmingFailed, &IAlarmOutput::PlayArmingFailed);
+	}
+
+	virtual void PlayNotArmed()
+	{
+		Play(PatternEnum::NotArmed, &IAlarmOutput::PlayNotArmed);
+	}
+
+	virtual void PlayEarlyWarning()
+	{
+		Play(PatternEnum::EarlyWarning, &IAlarmOutput::PlayEarlyWarning);
+	}
+
+	virtual void PlayAlarm()
+	{
+		Play(PatternEnum::Alarm, &IAlarmOutput::PlayAlarm);
+	}
+
+private:
+	void Play(const PatternEnum pattern, void (IAlarmOutput::*play)())
+	{
+		for (uint8_t i = 0; i < Count; i++)
+		{
+			if (Sinks[i].Patterns & pattern)
+			{
+				(Sinks[i].Output->*play)();
+			}
+			else
+			{
+				Sinks[i].Output->Stop();
+			}
+		}
+	}
+};
+#endif
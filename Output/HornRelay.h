@@ -0,0 +1,50 @@
+// HornRelay.h
+
+#ifndef _HORNRELAY_h
+#define _HORNRELAY_h
+
+#include <stdint.h>
+
+#include "../IAlarmOutput.h"
+#include "../Hal/Hal.h"
+
+// External horn, switched by a relay or MOSFET on RelayPin, active high.
+// Only sounds the full alarm, the other patterns are left to the buzzer.
+template<const uint8_t RelayPin>
+class HornRelay : public virtual IAlarmOutput
+{
+private:
+	typedef FastPin<RelayPin> Pin;
+
+public:
+	HornRelay()
+		: IAlarmOutput()
+	{
+		Pin::Low();
+		Pin::SetOutput();
+	}
+
+	bool Setup()
+	{
+		Pin::Low();
+		Pin::SetOutput();
+
+		return true;
+	}
+
+	virtual uint8_t GetPatterns()
+	{
+		return PatternEnum::Alarm;
+	}
+
+	virtual void PlayAlarm()
+	{
+		Pin::High();
+	}
+
+	virtual void Stop()
+	{
+		Pin::Low();
+	}
+};
+#endif
@@ -0,0 +1,809 @@
+#if !defined(__AVR__)
+/* Bounded model check of AlarmManager timing, with the real InputReader on the Linux HAL and a scripted motion sensor.
+	Every sequence of ignition edges, motion pulses and battery level changes on a discretised timeline is run, up to SlotCount slots,
+	from each root state, at each phase against the coarse tick, with both task orders in the base scheduler.
+	Invariants:
+	- Arm: ignition held on for ArmBoundMillis leaves NotArmed.
+	- Disarm: ignition held off for DisarmBoundMillis reaches NotArmed, outputs silenced.
+	- Motion: motion while Armed, past the rung's grace, climbs the ladder within MotionBoundMillis.
+	- Stuck: the manager task is never disabled while a transition, deadline or motion event is pending.
+	- Livelock: a quiescent point is reached within MaxPassesPerInstant passes.
+	Worst-case latency per transition is reported, not just pass/fail,
+	and the manager passes each input event costs in each state, to show IsEventRelevant() at work. */
+
+#include "Test.h"
+
+#include <TaskScheduler.h>
+
+#include "../Hal/Hal.h"
+#include "../AlarmManager.h"
+#include "../Input/InputReader.h"
+
+// Storage from WatchdogRecovery.cpp. Zeroed, so there is no snapshot to resume.
+uint8_t ResetFlags;
+RecoverySnapshot RecoveryState;
+
+static const uint8_t ArmPin = 2;
+static const uint32_t DebounceMillis = 300;
+
+static const uint8_t SlotCount = 8;
+static const uint32_t SlotMillis = 150;
+static const uint8_t PhaseCount = 3;
+static const uint32_t PhaseMillis[PhaseCount] = { 0, 5, 11 };
+
+// Worst case: debounce measured on the coarse clock, a tick for the reader and one for the manager pass.
+static const uint32_t ArmBoundMillis = DebounceMillis + (3 * Timebase::CoarseTickMillis) + MIN_RUN_PERIOD_MILLIS;
+static const uint32_t DisarmBoundMillis = ArmBoundMillis;
+// A tick for the sensor task to forward it and one for the manager pass.
+static const uint32_t MotionBoundMillis = (2 * Timebase::CoarseTickMillis) + MIN_RUN_PERIOD_MILLIS;
+// Time after the last slot for every bound to expire.
+static const uint32_t SettleMillis = ArmBoundMillis + SlotMillis;
+
+static const uint16_t MaxPassesPerInstant = 64;
+static const uint8_t MaxReportedViolations = 8;
+
+// AlarmManager::StateEnum.
+enum ManagerStateEnum : uint8_t
+{
+	Disabled,
+	WakingUp,
+	NotArmed,
+	Arming,
+	ArmingFailed,
+	Armed,
+	StateCount
+};
+
+static const char* const StateNames[StateCount] = { "Disabled", "WakingUp", "NotArmed", "Arming", "ArmingFailed", "Armed" };
+
+enum InputEnum : uint8_t
+{
+	Idle,
+	Ignition,
+	Motion,
+	Battery,
+	InputCount
+};
+
+static const char* const InputNames[InputCount] = { "Idle", "Ignition", "Motion", "Battery" };
+static const char InputCodes[InputCount] = { '.', 'I', 'M', 'B' };
+
+enum RootEnum : uint8_t
+{
+	RootNotArmed,
+	RootArmed,
+	RootEarlyWarning,
+	RootAlarm,
+	RootArmingFailed,
+	RootCount
+};
+
+static const char* const RootNames[RootCount] = { "NotArmed", "Armed", "EarlyWarning", "Alarm", "ArmingFailed" };
+
+// Latency per transition, across all runs.
+enum TransitionEnum : uint8_t
+{
+	ArmToArming,
+	DisarmFromArming,
+	DisarmFromArmingFailed,
+	DisarmFromArmed,
+	MotionClimbFromRung0,
+	MotionClimbFromRung1,
+	TransitionCount
+};
+
+static const char* const TransitionNames[TransitionCount] =
+{
+	"Ignition on -> Arming",
+	"Ignition off, Arming -> NotArmed",
+	"Ignition off, ArmingFailed -> NotArmed",
+	"Ignition off, Armed -> NotArmed (silent)",
+	"Motion, Armed rung 0 -> climb",
+	"Motion, Armed rung 1 -> climb"
+};
+
+static const uint32_t TransitionBounds[TransitionCount] =
+{
+	ArmBoundMillis,
+	DisarmBoundMillis,
+	DisarmBoundMillis,
+	DisarmBoundMillis,
+	MotionBoundMillis,
+	MotionBoundMillis
+};
+
+struct TransitionStats
+{
+	uint32_t Count;
+	uint32_t WorstMillis;
+};
+
+static TransitionStats Stats[TransitionCount];
+
+// Manager passes in the burst after each input event, by source and by state at the event.
+// A relevant event costs one pass, an ignored one none. Armed reflex steps run inside OnEvent, without a pass.
+struct EventPassStats
+{
+	uint32_t Events;
+	uint32_t Passes;
+};
+
+static EventPassStats EventPasses[InputCount][StateCount];
+static uint32_t RunCount = 0;
+static uint32_t ViolationCount = 0;
+
+// Plays are recorded with the manager's time, Stop is a silent pattern.
+class RecordingOutput : public IAlarmOutput
+{
+public:
+	uint8_t Pattern = 0;
+	uint32_t PatternMillis = 0;
+
+	virtual void Stop()
+	{
+		Record(0);
+	}
+
+	virtual void PlayError()
+	{
+		Record(PatternEnum::Error);
+	}
+
+	virtual void PlayArmed()
+	{
+		Record(PatternEnum::Armed);
+	}
+
+	virtual void PlayArming()
+	{
+		Record(PatternEnum::Arming);
+	}
+
+	virtual void PlayArmingFailed()
+	{
+		Record(PatternEnum::ArmingFailed);
+	}
+
+	virtual void PlayNotArmed()
+	{
+		Record(PatternEnum::NotArmed);
+	}
+
+	virtual void PlayEarlyWarning()
+	{
+		Record(PatternEnum::EarlyWarning);
+	}
+
+	virtual void PlayAlarm()
+	{
+		Record(PatternEnum::Alarm);
+	}
+
+	bool IsSounding()
+	{
+		return Pattern == PatternEnum::EarlyWarning || Pattern == PatternEnum::Alarm;
+	}
+
+private:
+	void Record(const uint8_t pattern)
+	{
+		Pattern = pattern;
+		PatternMillis = Timebase::Millis();
+	}
+};
+
+// Counts its passes, the manager is otherwise unchanged.
+class CountingManager : public AlarmManager
+{
+public:
+	uint32_t Passes = 0;
+
+public:
+	CountingManager(Scheduler* scheduler)
+		: AlarmManager(scheduler)
+	{
+	}
+
+	bool Callback()
+	{
+		Passes++;
+
+		return AlarmManager::Callback();
+	}
+};
+
+// Level toggled by the script, the event goes through the model's battery tap.
+class ScriptedBatteryMonitor : public IBatteryMonitor
+{
+public:
+	uint8_t EnergyLevel = EnergyLevelFull;
+
+	virtual uint8_t GetEnergyLevel()
+	{
+		return EnergyLevel;
+	}
+};
+
+// Between an input and the manager, attributes the following passes to the input.
+class EventTap : public IEventListener
+{
+private:
+	CountingManager* Manager = nullptr;
+	uint8_t Input = InputEnum::Idle;
+
+	static EventPassStats* Open;
+	static uint32_t OpenPasses;
+	static CountingManager* OpenManager;
+
+public:
+	void Setup(CountingManager* manager, const uint8_t input)
+	{
+		Manager = manager;
+		Input = input;
+	}
+
+	virtual void OnEvent()
+	{
+		Close();
+
+		Open = &EventPasses[Input][Manager->GetState()];
+		Open->Events++;
+		OpenPasses = Manager->Passes;
+		OpenManager = Manager;
+
+		Manager->OnEvent();
+	}
+
+	// At each quiescent point, or at the next event.
+	static void Close()
+	{
+		if (Open != nullptr)
+		{
+			Open->Passes += OpenManager->Passes - OpenPasses;
+			Open = nullptr;
+		}
+	}
+};
+
+EventPassStats* EventTap::Open = nullptr;
+uint32_t EventTap::OpenPasses = 0;
+CountingManager* EventTap::OpenManager = nullptr;
+
+// Motion interrupt latched by Pulse, forwarded from the task as MovementSensor does.
+class ScriptedMovementSensor : Task, public virtual IMovementSensor
+{
+public:
+	static const uint8_t HistorySize = 8;
+
+private:
+	IEventListener* Listener = nullptr;
+	uint32_t History[HistorySize];
+	uint16_t Count = 0;
+	bool Enabled = false;
+	bool Pending = false;
+
+public:
+	ScriptedMovementSensor(Scheduler* scheduler)
+		: Task(0, TASK_FOREVER, scheduler, false)
+	{
+	}
+
+	void Setup(IEventListener* listener)
+	{
+		Listener = listener;
+	}
+
+	bool IsEnabled()
+	{
+		return Enabled;
+	}
+
+	void Pulse()
+	{
+		if (Enabled)
+		{
+			Pending = true;
+			Task::enableIfNot();
+			Task::forceNextIteration();
+		}
+	}
+
+	bool Callback()
+	{
+		if (Pending && Enabled)
+		{
+			History[Count % HistorySize] = Timebase::Millis();
+			Count++;
+			Listener->OnEvent();
+		}
+		Pending = false;
+		Task::disable();
+
+		return true;
+	}
+
+	virtual void Enable()
+	{
+		Enabled = true;
+	}
+
+	virtual void Disable()
+	{
+		Enabled = false;
+		Pending = false;
+	}
+
+	virtual bool HasRecentSignificantMotion(const uint32_t period)
+	{
+		return Count > 0 && (Timebase::Millis() - History[(Count - 1) % HistorySize]) < period;
+	}
+
+	virtual uint16_t GetMotionEventCount()
+	{
+		return Count;
+	}
+
+	virtual uint16_t GetMotionDensity(const uint32_t period)
+	{
+		uint16_t Density = 0;
+
+		for (uint8_t i = 0; i < HistorySize && i < Count; i++)
+		{
+			if (Timebase::Millis() - History[(Count - 1 - i) % HistorySize] < period)
+			{
+				Density++;
+			}
+		}
+
+		return Density;
+	}
+};
+
+class Model
+{
+private:
+	typedef InputReader<ArmPin> ReaderType;
+
+	Scheduler Base;
+	Scheduler High;
+
+	RecordingOutput Outputs;
+	ScriptedBatteryMonitor Battery;
+	WatchdogRecovery Recovery;
+	PersistentLog Log;
+	CountingManager Manager;
+
+	EventTap Taps[InputCount];
+
+	// Allocated in the explored task order.
+	ReaderType* Reader = nullptr;
+	ScriptedMovementSensor* Sensor = nullptr;
+
+	// Scenario, for reports.
+	uint8_t Root;
+	uint8_t Phase;
+	bool SensorFirst;
+	const uint8_t* Inputs = nullptr;
+
+	// Physical ignition, on is pin low.
+	bool IgnitionOn = false;
+	uint32_t IgnitionChangedMillis = 0;
+
+	uint8_t LastState = Disabled;
+	uint8_t LastPattern = 0;
+
+	// Motion the ladder must climb on.
+	bool MotionPending = false;
+	uint32_t MotionMillis = 0;
+	uint8_t MotionRung = 0;
+
+	bool Failed = false;
+
+public:
+	Model(const uint8_t root, const uint8_t phase, const bool sensorFirst)
+		: Manager(&High)
+		, Root(root)
+		, Phase(phase)
+		, SensorFirst(sensorFirst)
+	{
+		Base.setHighPriorityScheduler(&High);
+
+		if (SensorFirst)
+		{
+			Sensor = new ScriptedMovementSensor(&Base);
+			Reader = new ReaderType(&Base);
+		}
+		else
+		{
+			Reader = new ReaderType(&Base);
+			Sensor = new ScriptedMovementSensor(&Base);
+		}
+	}
+
+	~Model()
+	{
+		EventTap::Close();
+
+		delete Reader;
+		delete Sensor;
+	}
+
+	bool HasFailed()
+	{
+		return Failed;
+	}
+
+	// Setup as the sketch does, then drives the model into the root state.
+	bool Start()
+	{
+		SetIgnition(Root != RootNotArmed);
+
+		for (uint8_t i = 0; i < InputCount; i++)
+		{
+			Taps[i].Setup(&Manager, i);
+		}
+
+		Sensor->Setup(&Taps[InputEnum::Motion]);
+		if (!Log.Setup()
+			|| !Reader->Setup(&Taps[InputEnum::Ignition])
+			|| !Manager.Setup(&Outputs, Sensor, Reader, &Battery, &Log, &Recovery))
+		{
+			return false;
+		}
+		Timebase::Setup();
+
+		RunFor(SlotMillis);
+		if (Root == RootNotArmed)
+		{
+			return Manager.GetState() == NotArmed;
+		}
+
+		if (Root == RootArmingFailed)
+		{
+			// Motion late in the arming period.
+			RunFor(ArmBoundMillis + (ARM_PERIOD_MILLIS / 2));
+			Sensor->Pulse();
+			RunFor((ARM_PERIOD_MILLIS / 2) + MotionBoundMillis);
+
+			return Manager.GetState() == ArmingFailed;
+		}
+
+		RunFor(ArmBoundMillis + ARM_PERIOD_MILLIS + MotionBoundMillis);
+		if (Root >= RootEarlyWarning)
+		{
+			PulseMotion();
+			RunFor(MotionBoundMillis);
+		}
+		if (Root >= RootAlarm)
+		{
+			// Past the early warning grace, on the coarse clock.
+			RunFor(pgm_read_dword(&DefaultLadder[1].GraceMillis) + Timebase::CoarseTickMillis);
+			PulseMotion();
+			RunFor(MotionBoundMillis);
+		}
+
+		return Manager.GetState() == Armed && Manager.GetEscalationRung() == Root - RootArmed;
+	}
+
+	void Run(const uint8_t* inputs)
+	{
+		Inputs = inputs;
+
+		RunFor(PhaseMillis[Phase]);
+
+		for (uint8_t i = 0; i < SlotCount && !Failed; i++)
+		{
+			switch (inputs[i])
+			{
+			case InputEnum::Ignition:
+				SetIgnition(!IgnitionOn);
+				break;
+			case InputEnum::Motion:
+				PulseMotion();
+				break;
+			case InputEnum::Battery:
+				// Full and low in turns, published straight away as BatteryMonitor does.
+				Battery.EnergyLevel = Battery.EnergyLevel == IBatteryMonitor::EnergyLevelFull ? 0 : IBatteryMonitor::EnergyLevelFull;
+				Taps[InputEnum::Battery].OnEvent();
+				break;
+			default:
+				break;
+			}
+
+			RunFor(SlotMillis);
+		}
+
+		RunFor(SettleMillis);
+	}
+
+private:
+	void SetIgnition(const bool on)
+	{
+		IgnitionOn = on;
+		IgnitionChangedMillis = HalFake.Millis;
+		HalFakeSetPin(ArmPin, !on);
+	}
+
+	void PulseMotion()
+	{
+		const uint8_t Rung = Manager.GetEscalationRung();
+
+		// Only rungs that climb on one event, once their grace is over.
+		if (!MotionPending
+			&& Manager.GetState() == Armed
+			&& Sensor->IsEnabled()
+			&& (Rung + 1U) < ESCALATION_LADDER_SIZE(DefaultLadder)
+			&& pgm_read_byte(&DefaultLadder[Rung].MotionCount) == 1
+			&& (Timebase::Millis() - Outputs.PatternMillis) >= pgm_read_dword(&DefaultLadder[Rung].GraceMillis))
+		{
+			MotionPending = true;
+			MotionMillis = HalFake.Millis;
+			MotionRung = Rung;
+		}
+
+		Sensor->Pulse();
+	}
+
+	// Runs the schedulers, skipping idle stretches. Invariants are checked at every quiescent point.
+	void RunFor(const uint32_t millis)
+	{
+		const uint32_t Until = HalFake.Millis + millis;
+
+		while (!Failed)
+		{
+			uint16_t Passes = 0;
+			do
+			{
+				Base.execute();
+				Observe();
+				if (++Passes > MaxPassesPerInstant)
+				{
+					Violation("livelock, tasks due at once for too many passes");
+
+					return;
+				}
+			} while (Base.timeUntilNextIteration() == 0);
+
+			EventTap::Close();
+			CheckBounds();
+			CheckStuck();
+
+			if (HalFake.Millis >= Until)
+			{
+				return;
+			}
+
+			uint32_t Step = Until - HalFake.Millis;
+			const long Next = Base.timeUntilNextIteration();
+			if (Next > 0 && (uint32_t)Next < Step)
+			{
+				Step = Next;
+			}
+			const uint32_t Deadline = GetNextBound();
+			if (Deadline > HalFake.Millis && Deadline - HalFake.Millis < Step)
+			{
+				Step = Deadline - HalFake.Millis;
+			}
+
+			HalFake.Millis += Step;
+		}
+	}
+
+	// Records transition latencies as they happen.
+	void Observe()
+	{
+		const uint8_t State = Manager.GetState();
+		const uint32_t SinceIgnition = HalFake.Millis - IgnitionChangedMillis;
+
+		if (State != LastState)
+		{
+			if (LastState == NotArmed && State == Arming && IgnitionOn)
+			{
+				Record(TransitionEnum::ArmToArming, SinceIgnition);
+			}
+			else if (State == NotArmed && !IgnitionOn)
+			{
+				switch (LastState)
+				{
+				case Arming:
+					Record(TransitionEnum::DisarmFromArming, SinceIgnition);
+					break;
+				case ArmingFailed:
+					Record(TransitionEnum::DisarmFromArmingFailed, SinceIgnition);
+					break;
+				case Armed:
+					Record(TransitionEnum::DisarmFromArmed, SinceIgnition);
+					break;
+				default:
+					break;
+				}
+			}
+
+			LastState = State;
+		}
+
+		if (MotionPending && (State != Armed || Manager.GetEscalationRung() != MotionRung))
+		{
+			MotionPending = false;
+
+			if (State == Armed && Manager.GetEscalationRung() > MotionRung)
+			{
+				Record(MotionRung == 0 ? TransitionEnum::MotionClimbFromRung0 : TransitionEnum::MotionClimbFromRung1,
+					HalFake.Millis - MotionMillis);
+			}
+		}
+
+		LastPattern = Outputs.Pattern;
+	}
+
+	uint32_t GetNextBound()
+	{
+		uint32_t Next = IgnitionChangedMillis + (IgnitionOn ? ArmBoundMillis : DisarmBoundMillis);
+
+		if (MotionPending && MotionMillis + MotionBoundMillis < Next)
+		{
+			Next = MotionMillis + MotionBoundMillis;
+		}
+
+		return Next;
+	}
+
+	void CheckBounds()
+	{
+		const uint8_t State = Manager.GetState();
+		const uint32_t SinceIgnition = HalFake.Millis - IgnitionChangedMillis;
+
+		if (IgnitionOn && SinceIgnition > ArmBoundMillis && State == NotArmed)
+		{
+			Violation("ignition on, still NotArmed");
+		}
+		else if (!IgnitionOn && SinceIgnition > DisarmBoundMillis
+			&& (State != NotArmed || Outputs.Pattern != IAlarmOutput::PatternEnum::NotArmed))
+		{
+			Violation("ignition off, not disarmed and silent");
+		}
+		else if (MotionPending && HalFake.Millis - MotionMillis > MotionBoundMillis)
+		{
+			Violation("motion while Armed, ladder didn't climb");
+		}
+	}
+
+	// The manager is the only task in the high priority layer.
+	void CheckStuck()
+	{
+		if (High.timeUntilNextIteration() >= 0)
+		{
+			return;
+		}
+
+		const uint8_t State = Manager.GetState();
+		const bool ArmSignal = Reader->IsArmSignalOn();
+		const uint8_t Rung = Manager.GetEscalationRung();
+
+		if ((State == WakingUp || State == Arming || State == ArmingFailed)
+			|| (State == NotArmed && ArmSignal)
+			|| (State == Armed && (!ArmSignal || MotionPending || pgm_read_dword(&DefaultLadder[Rung].DurationMillis) > 0)))
+		{
+			Violation("manager task disabled with work pending");
+		}
+	}
+
+	void Record(const TransitionEnum transition, const uint32_t latency)
+	{
+		Stats[transition].Count++;
+		if (latency > Stats[transition].WorstMillis)
+		{
+			Stats[transition].WorstMillis = latency;
+		}
+	}
+
+	void Violation(const char* invariant)
+	{
+		Failed = true;
+		ViolationCount++;
+
+		if (ViolationCount > MaxReportedViolations)
+		{
+			return;
+		}
+
+		printf("Violation: %s at %u ms, state %s rung %u\n", invariant, (unsigned)HalFake.Millis,
+			StateNames[Manager.GetState() < StateCount ? Manager.GetState() : 0], Manager.GetEscalationRung());
+		printf("  root %s, phase %u ms, %s first, inputs:", RootNames[Root], (unsigned)PhaseMillis[Phase],
+			SensorFirst ? "sensor" : "reader");
+		for (uint8_t i = 0; Inputs != nullptr && i < SlotCount; i++)
+		{
+			printf(" %c", InputCodes[Inputs[i]]);
+		}
+		printf("\n");
+	}
+};
+
+static void CheckAllInterleavings()
+{
+	uint8_t Inputs[SlotCount];
+	uint32_t Sequences = 1;
+
+	for (uint8_t i = 0; i < SlotCount; i++)
+	{
+		Sequences *= InputEnum::InputCount;
+	}
+
+	for (uint8_t Root = 0; Root < RootCount; Root++)
+	{
+		for (uint8_t Phase = 0; Phase < PhaseCount; Phase++)
+		{
+			for (uint8_t Order = 0; Order < 2; Order++)
+			{
+				for (uint32_t Sequence = 0; Sequence < Sequences; Sequence++)
+				{
+					uint32_t Digits = Sequence;
+					for (uint8_t i = 0; i < SlotCount; i++)
+					{
+						Inputs[i] = Digits % InputEnum::InputCount;
+						Digits /= InputEnum::InputCount;
+					}
+
+					HalFakeReset();
+					Model Instance(Root, Phase, Order != 0);
+
+					CHECK(Instance.Start());
+					Instance.Run(Inputs);
+					RunCount++;
+				}
+			}
+		}
+	}
+
+	CHECK(ViolationCount == 0);
+
+	printf("%u runs, %u slots of %u ms, %u violations.\n", (unsigned)RunCount, SlotCount, (unsigned)SlotMillis,
+		(unsigned)ViolationCount);
+	printf("%-42s %8s %8s %8s\n", "Transition", "Count", "Worst ms", "Bound ms");
+	for (uint8_t i = 0; i < TransitionCount; i++)
+	{
+		printf("%-42s %8u %8u %8u\n", TransitionNames[i], (unsigned)Stats[i].Count, (unsigned)Stats[i].WorstMillis,
+			(unsigned)TransitionBounds[i]);
+
+		// Every transition must have been reached, or the search is too shallow.
+		CHECK(Stats[i].Count > 0);
+	}
+
+	printf("%-26s", "Manager passes per event");
+	for (uint8_t State = NotArmed; State < StateCount; State++)
+	{
+		printf(" %12s", StateNames[State]);
+	}
+	printf("\n");
+	for (uint8_t Input = InputEnum::Ignition; Input < InputEnum::InputCount; Input++)
+	{
+		printf("%-26s", InputNames[Input]);
+		for (uint8_t State = NotArmed; State < StateCount; State++)
+		{
+			const EventPassStats& Cell = EventPasses[Input][State];
+			if (Cell.Events == 0)
+			{
+				printf(" %12s", "-");
+			}
+			else
+			{
+				printf(" %12.2f", (double)Cell.Passes / Cell.Events);
+			}
+		}
+		printf("\n");
+	}
+
+	// Battery levels are applied inside OnEvent, they never need a pass.
+	for (uint8_t State = NotArmed; State < StateCount; State++)
+	{
+		CHECK(EventPasses[InputEnum::Battery][State].Passes == 0);
+	}
+}
+
+int main()
+{
+	RUN_TEST(CheckAllInterleavings);
+
+	return TEST_RESULT();
+}
+#endif
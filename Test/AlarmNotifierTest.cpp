@@ -0,0 +1,509 @@
+#if !defined(__AVR__)
+// AlarmNotifier on the USART model, against a modem model that parses frames and acks them.
+// Framing, checksum, ack and sequence matching, retries, coalescing, the queue, and USART awake time per notification.
+
+#define ALARM_NOTIFIER
+
+#include "Test.h"
+
+#include <string.h>
+
+#include <TaskScheduler.h>
+
+#include "../Hal/Hal.h"
+#include "../Notification/AlarmNotifier.h"
+
+static const uint8_t UsartBit = 1 << (uint8_t)PeripheralEnum::Usart0;
+
+// Frame layout, see AlarmNotifier.h.
+static const uint8_t FrameSize = 11;
+
+// Wire time of a frame at NOTIFY_BAUD_RATE, the USART model sends it at once.
+static const uint32_t FrameWireMillis = ((FrameSize * 10UL * 1000UL) / NOTIFY_BAUD_RATE) + 1;
+
+// Module side processing before the ack.
+static const uint32_t TurnaroundMillis = 5;
+
+// Ack deadline, as set by the notifier.
+static const uint32_t AckTimeoutMillis = FrameWireMillis + NOTIFY_ACK_TIMEOUT_MILLIS;
+
+// The notifier sleeps on the coarse clock, its deadlines may run a tick late.
+static const uint32_t SlackMillis = Timebase::CoarseTickMillis;
+
+// Frame out and acked.
+static const uint32_t DeliveryMillis = FrameWireMillis + TurnaroundMillis + 2;
+
+class FixedMovementSensor : public IMovementSensor
+{
+public:
+	uint16_t MotionEventCount = 0;
+
+	virtual uint16_t GetMotionEventCount()
+	{
+		return MotionEventCount;
+	}
+};
+
+class FixedBatteryMonitor : public IBatteryMonitor
+{
+public:
+	uint16_t MilliVolts = 3900;
+
+	virtual uint16_t GetMilliVolts()
+	{
+		return MilliVolts;
+	}
+};
+
+// GSM/LoRa module stand-in: collects frames from TX, checks them and acks on RX after the wire time and turnaround.
+class ModemModel
+{
+public:
+	enum AckEnum : uint8_t
+	{
+		Correct,
+		Silent,
+		WrongSequence
+	};
+
+	static const uint8_t Capacity = 16;
+
+	AckEnum Ack = AckEnum::Correct;
+
+	uint8_t Frames[Capacity][FrameSize];
+	uint8_t FrameCount = 0;
+	uint8_t ChecksumErrors = 0;
+
+private:
+	uint8_t Frame[FrameSize];
+	uint8_t FrameIndex = 0;
+
+	bool AckPending = false;
+	uint8_t AckSequence = 0;
+	uint32_t AckDueMillis = 0;
+
+public:
+	void Service()
+	{
+		uint8_t Value;
+
+		while (HalFakeReadUsart(Value))
+		{
+			if (FrameIndex == 0 && Value != AlarmNotifier::Sync)
+			{
+				continue;
+			}
+
+			Frame[FrameIndex++] = Value;
+			if (FrameIndex == FrameSize)
+			{
+				FrameIndex = 0;
+				OnFrame();
+			}
+		}
+
+		if (AckPending && (int32_t)(HalFake.Millis - AckDueMillis) >= 0)
+		{
+			AckPending = false;
+
+			// Noise first, the parser must skip it.
+			HalFakeWriteUsart(0x00);
+			HalFakeWriteUsart(AlarmNotifier::AckSync);
+			HalFakeWriteUsart(AckSequence);
+		}
+	}
+
+	uint8_t GetSequence(const uint8_t index)
+	{
+		return Frames[index][1];
+	}
+
+	uint8_t GetEvent(const uint8_t index)
+	{
+		return Frames[index][2];
+	}
+
+	uint32_t GetTimestamp(const uint8_t index)
+	{
+		uint32_t Timestamp;
+		memcpy(&Timestamp, &Frames[index][3], sizeof(uint32_t));
+
+		return Timestamp;
+	}
+
+	uint8_t GetMotionDensity(const uint8_t index)
+	{
+		return Frames[index][7];
+	}
+
+	uint16_t GetBatteryMilliVolts(const uint8_t index)
+	{
+		uint16_t MilliVolts;
+		memcpy(&MilliVolts, &Frames[index][8], sizeof(uint16_t));
+
+		return MilliVolts;
+	}
+
+private:
+	void OnFrame()
+	{
+		uint8_t Checksum = 0;
+		for (uint8_t i = 0; i < FrameSize - 1; i++)
+		{
+			Checksum ^= Frame[i];
+		}
+
+		if (Checksum != Frame[FrameSize - 1])
+		{
+			ChecksumErrors++;
+
+			return;
+		}
+
+		if (FrameCount < Capacity)
+		{
+			memcpy(Frames[FrameCount], Frame, FrameSize);
+		}
+		FrameCount++;
+
+		if (Ack != AckEnum::Silent)
+		{
+			AckPending = true;
+			AckSequence = Ack == AckEnum::Correct ? Frame[1] : Frame[1] + 1;
+			AckDueMillis = HalFake.Millis + FrameWireMillis + TurnaroundMillis;
+		}
+	}
+};
+
+struct NotifierFixture
+{
+	Scheduler Base;
+	FixedMovementSensor Sensor;
+	FixedBatteryMonitor Battery;
+	AlarmNotifier Notifier;
+	ModemModel Modem;
+
+	// Milliseconds with USART0 powered.
+	uint32_t AwakeMillis = 0;
+
+	NotifierFixture()
+		: Notifier(&Base)
+	{
+	}
+
+	bool Setup()
+	{
+		const bool Success = Notifier.Setup(&Sensor, &Battery);
+		Timebase::Setup();
+
+		return Success;
+	}
+
+	// Interrupts are taken after each pass too, the transmitter starts at once.
+	void Run(const uint32_t millis)
+	{
+		for (uint32_t i = 0; i < millis; i++)
+		{
+			Base.execute();
+			HalFakeRunInterrupts();
+			Modem.Service();
+
+			if (HalFake.PoweredMask & UsartBit)
+			{
+				AwakeMillis++;
+			}
+			HalFake.Millis++;
+		}
+		Base.execute();
+		HalFakeRunInterrupts();
+		Modem.Service();
+	}
+
+	bool IsAwake()
+	{
+		return (HalFake.PoweredMask & UsartBit) != 0 || HalFake.UsartEnabled || HalFake.FineRequests != 0;
+	}
+};
+
+static void TestSetupPowersDown()
+{
+	NotifierFixture Fixture;
+
+	CHECK(!Fixture.Notifier.Setup(nullptr, &Fixture.Battery));
+	CHECK(Fixture.Setup());
+
+	// TX idles high for the module: PORT set, then output.
+	CHECK(!Fixture.IsAwake());
+	CHECK(HalFake.PinPullup[1] && HalFake.PinOutput[1]);
+	CHECK(HalFake.PinPullup[0]);
+	CHECK(Fixture.Base.timeUntilNextIteration() < 0);
+}
+
+static void TestFrame()
+{
+	NotifierFixture Fixture;
+
+	CHECK(Fixture.Setup());
+	Fixture.Sensor.MotionEventCount = 3;
+
+	Fixture.Notifier.PlayArmed();
+	Fixture.Run(NOTIFY_COALESCE_MILLIS - 1);
+	CHECK(Fixture.Modem.FrameCount == 0);
+	CHECK(!Fixture.IsAwake());
+
+	Fixture.Run(SlackMillis);
+	CHECK(Fixture.Modem.FrameCount == 1);
+	CHECK(HalFake.UsartBaudRate == NOTIFY_BAUD_RATE);
+	CHECK(Fixture.Modem.ChecksumErrors == 0);
+	CHECK(Fixture.Modem.GetSequence(0) == 0);
+	CHECK(Fixture.Modem.GetEvent(0) == AlarmNotifier::EventEnum::Armed);
+	CHECK(Fixture.Modem.GetTimestamp(0) >= NOTIFY_COALESCE_MILLIS);
+	CHECK(Fixture.Modem.GetTimestamp(0) < NOTIFY_COALESCE_MILLIS + SlackMillis);
+	CHECK(Fixture.Modem.GetMotionDensity(0) == (3 * 60000UL) / Fixture.Modem.GetTimestamp(0));
+	CHECK(Fixture.Modem.GetBatteryMilliVolts(0) == 3900);
+
+	// Acked: counted, USART off and the clock released.
+	CHECK(Fixture.IsAwake());
+	CHECK(Timebase::IsFine());
+	Fixture.Run(DeliveryMillis);
+	CHECK(Fixture.Notifier.GetSentCount() == 1);
+	CHECK(Fixture.Notifier.GetDroppedCount() == 0);
+	CHECK(!Fixture.IsAwake());
+	CHECK(Fixture.Base.timeUntilNextIteration() < 0);
+
+	// Next frame, next sequence. Density saturates.
+	Fixture.Sensor.MotionEventCount = 1003;
+	Fixture.Notifier.PlayAlarm();
+	Fixture.Run(NOTIFY_COALESCE_MILLIS + SlackMillis + DeliveryMillis);
+	CHECK(Fixture.Modem.FrameCount == 2);
+	CHECK(Fixture.Modem.GetSequence(1) == 1);
+	CHECK(Fixture.Modem.GetEvent(1) == AlarmNotifier::EventEnum::Alarm);
+	CHECK(Fixture.Modem.GetMotionDensity(1) == UINT8_MAX);
+	CHECK(Fixture.Notifier.GetSentCount() == 2);
+}
+
+static void TestCoalesce()
+{
+	NotifierFixture Fixture;
+
+	CHECK(Fixture.Setup());
+
+	// Changes in the window are sent as one, with the last state.
+	Fixture.Notifier.PlayArmed();
+	Fixture.Run(NOTIFY_COALESCE_MILLIS / 2);
+	Fixture.Notifier.PlayEarlyWarning();
+	Fixture.Notifier.PlayAlarm();
+	Fixture.Run(NOTIFY_COALESCE_MILLIS + SlackMillis);
+	CHECK(Fixture.Modem.FrameCount == 1);
+	CHECK(Fixture.Modem.GetEvent(0) == AlarmNotifier::EventEnum::Alarm);
+	CHECK(Fixture.Notifier.GetSentCount() == 1);
+
+	// A -> B -> A in the window sends nothing, and never wakes the USART.
+	const uint32_t TxBytes = HalFake.UsartTxBytes;
+	const uint32_t AwakeMillis = Fixture.AwakeMillis;
+	Fixture.Notifier.PlayEarlyWarning();
+	Fixture.Run(NOTIFY_COALESCE_MILLIS / 2);
+	Fixture.Notifier.PlayAlarm();
+	Fixture.Run(NOTIFY_COALESCE_MILLIS * 2);
+	CHECK(Fixture.Modem.FrameCount == 1);
+	CHECK(HalFake.UsartTxBytes == TxBytes);
+	CHECK(Fixture.AwakeMillis == AwakeMillis);
+	CHECK(Fixture.Base.timeUntilNextIteration() < 0);
+
+	// The same state again is no change either.
+	Fixture.Notifier.PlayAlarm();
+	Fixture.Run(NOTIFY_COALESCE_MILLIS * 2);
+	CHECK(Fixture.Modem.FrameCount == 1);
+}
+
+static void TestRetry()
+{
+	NotifierFixture Fixture;
+
+	CHECK(Fixture.Setup());
+	Fixture.Modem.Ack = ModemModel::AckEnum::Silent;
+
+	Fixture.Notifier.PlayArmed();
+	Fixture.Run(NOTIFY_COALESCE_MILLIS + SlackMillis);
+	CHECK(Fixture.Modem.FrameCount == 1);
+
+	// Powered down between attempts.
+	Fixture.Run(AckTimeoutMillis + 1);
+	CHECK(!Fixture.IsAwake());
+
+	Fixture.Run(NOTIFY_RETRY_PERIOD_MILLIS + SlackMillis);
+	CHECK(Fixture.Modem.FrameCount == 2);
+
+	Fixture.Run(NOTIFY_MAX_ATTEMPTS * (NOTIFY_RETRY_PERIOD_MILLIS + AckTimeoutMillis + SlackMillis));
+	CHECK(Fixture.Modem.FrameCount == NOTIFY_MAX_ATTEMPTS);
+	for (uint8_t i = 0; i < NOTIFY_MAX_ATTEMPTS; i++)
+	{
+		CHECK(Fixture.Modem.GetSequence(i) == 0);
+		CHECK(Fixture.Modem.GetEvent(i) == AlarmNotifier::EventEnum::Armed);
+		CHECK(Fixture.Modem.GetTimestamp(i) == Fixture.Modem.GetTimestamp(0));
+	}
+	CHECK(Fixture.Notifier.GetSentCount() == 0);
+	CHECK(Fixture.Notifier.GetDroppedCount() == 1);
+	CHECK(!Fixture.IsAwake());
+	CHECK(Fixture.Base.timeUntilNextIteration() < 0);
+}
+
+static void TestAckSequence()
+{
+	NotifierFixture Fixture;
+
+	CHECK(Fixture.Setup());
+
+	// An ack for another frame is no ack.
+	Fixture.Modem.Ack = ModemModel::AckEnum::WrongSequence;
+	Fixture.Notifier.PlayArmed();
+	Fixture.Run(NOTIFY_COALESCE_MILLIS + SlackMillis + AckTimeoutMillis + 1);
+	CHECK(Fixture.Modem.FrameCount == 1);
+	CHECK(Fixture.Notifier.GetSentCount() == 0);
+	CHECK(!Fixture.IsAwake());
+
+	Fixture.Modem.Ack = ModemModel::AckEnum::Correct;
+	Fixture.Run(NOTIFY_RETRY_PERIOD_MILLIS + SlackMillis + DeliveryMillis);
+	CHECK(Fixture.Modem.FrameCount == 2);
+	CHECK(Fixture.Modem.GetSequence(1) == 0);
+	CHECK(Fixture.Notifier.GetSentCount() == 1);
+	CHECK(Fixture.Notifier.GetDroppedCount() == 0);
+	CHECK(!Fixture.IsAwake());
+}
+
+static void TestQueueKeepsHeadInFlight()
+{
+	const AlarmNotifier::EventEnum Events[] =
+	{
+		AlarmNotifier::EventEnum::EarlyWarning,
+		AlarmNotifier::EventEnum::Alarm,
+		AlarmNotifier::EventEnum::NotArmed,
+		AlarmNotifier::EventEnum::ArmingFailed,
+		AlarmNotifier::EventEnum::Error
+	};
+	const uint8_t EventCount = sizeof(Events) / sizeof(Events[0]);
+
+	NotifierFixture Fixture;
+
+	CHECK(Fixture.Setup());
+	Fixture.Modem.Ack = ModemModel::AckEnum::Silent;
+
+	// Head waits for its retry.
+	Fixture.Notifier.PlayArmed();
+	Fixture.Run(NOTIFY_COALESCE_MILLIS + SlackMillis + AckTimeoutMillis + 1);
+	CHECK(Fixture.Modem.FrameCount == 1);
+
+	// More changes than the queue holds, one per window.
+	for (uint8_t i = 0; i < EventCount; i++)
+	{
+		switch (Events[i])
+		{
+		case AlarmNotifier::EventEnum::EarlyWarning:
+			Fixture.Notifier.PlayEarlyWarning();
+			break;
+		case AlarmNotifier::EventEnum::Alarm:
+			Fixture.Notifier.PlayAlarm();
+			break;
+		case AlarmNotifier::EventEnum::NotArmed:
+			Fixture.Notifier.PlayNotArmed();
+			break;
+		case AlarmNotifier::EventEnum::ArmingFailed:
+			Fixture.Notifier.PlayArmingFailed();
+			break;
+		default:
+			Fixture.Notifier.PlayError();
+			break;
+		}
+		Fixture.Run(NOTIFY_COALESCE_MILLIS + SlackMillis);
+	}
+
+	// Newest replaced twice.
+	CHECK(Fixture.Notifier.GetDroppedCount() == EventCount - (NOTIFY_QUEUE_CAPACITY - 1));
+
+	// The head is retried unchanged, the rest follow in the same burst.
+	Fixture.Modem.Ack = ModemModel::AckEnum::Correct;
+	Fixture.Run(NOTIFY_RETRY_PERIOD_MILLIS + SlackMillis + (NOTIFY_QUEUE_CAPACITY * DeliveryMillis));
+
+	const uint8_t Retried = Fixture.Modem.FrameCount - NOTIFY_QUEUE_CAPACITY;
+	CHECK(Fixture.Notifier.GetSentCount() == NOTIFY_QUEUE_CAPACITY);
+	for (uint8_t i = 0; i <= Retried; i++)
+	{
+		CHECK(Fixture.Modem.GetSequence(i) == 0);
+		CHECK(Fixture.Modem.GetEvent(i) == AlarmNotifier::EventEnum::Armed);
+	}
+	CHECK(Fixture.Modem.GetEvent(Retried + 1) == Events[0]);
+	CHECK(Fixture.Modem.GetEvent(Retried + 2) == Events[1]);
+	CHECK(Fixture.Modem.GetEvent(Retried + 3) == Events[EventCount - 1]);
+	CHECK(Fixture.Modem.GetSequence(Retried + 3) == EventCount);
+	CHECK(!Fixture.IsAwake());
+}
+
+// Benchmark: USART powered time per notification, single frames and bursts.
+static void TestAwakeTime()
+{
+	static const uint8_t Notifications = 8;
+
+	NotifierFixture Fixture;
+
+	CHECK(Fixture.Setup());
+
+	for (uint8_t i = 0; i < Notifications; i++)
+	{
+		if (i % 2 == 0)
+		{
+			Fixture.Notifier.PlayAlarm();
+		}
+		else
+		{
+			Fixture.Notifier.PlayArmed();
+		}
+		Fixture.Run(NOTIFY_COALESCE_MILLIS + SlackMillis + AckTimeoutMillis);
+	}
+	CHECK(Fixture.Notifier.GetSentCount() == Notifications);
+
+	const uint32_t SingleMillis = Fixture.AwakeMillis / Notifications;
+	CHECK(SingleMillis <= DeliveryMillis);
+
+	// A burst of queued frames shares one power up.
+	Fixture.Modem.Ack = ModemModel::AckEnum::Silent;
+	Fixture.Notifier.PlayAlarm();
+	Fixture.Run(NOTIFY_COALESCE_MILLIS + SlackMillis + AckTimeoutMillis + 1);
+	for (uint8_t i = 0; i < NOTIFY_QUEUE_CAPACITY - 1; i++)
+	{
+		if (i % 2 == 0)
+		{
+			Fixture.Notifier.PlayArmed();
+		}
+		else
+		{
+			Fixture.Notifier.PlayAlarm();
+		}
+		Fixture.Run(NOTIFY_COALESCE_MILLIS + SlackMillis);
+	}
+
+	const uint32_t AwakeMillis = Fixture.AwakeMillis;
+	const uint16_t Sent = Fixture.Notifier.GetSentCount();
+	Fixture.Modem.Ack = ModemModel::AckEnum::Correct;
+	Fixture.Run(NOTIFY_RETRY_PERIOD_MILLIS);
+	CHECK(Fixture.Notifier.GetSentCount() - Sent == NOTIFY_QUEUE_CAPACITY);
+
+	const uint32_t BurstMillis = (Fixture.AwakeMillis - AwakeMillis) / NOTIFY_QUEUE_CAPACITY;
+	CHECK(BurstMillis <= SingleMillis);
+
+	printf("USART awake per notification: %u ms single, %u ms in a burst of %u (frame %u ms on the wire, %u ms turnaround).\n",
+		(unsigned)SingleMillis, (unsigned)BurstMillis, NOTIFY_QUEUE_CAPACITY, (unsigned)FrameWireMillis, (unsigned)TurnaroundMillis);
+}
+
+int main()
+{
+	RUN_TEST(TestSetupPowersDown);
+	RUN_TEST(TestFrame);
+	RUN_TEST(TestCoalesce);
+	RUN_TEST(TestRetry);
+	RUN_TEST(TestAckSequence);
+	RUN_TEST(TestQueueKeepsHeadInFlight);
+	RUN_TEST(TestAwakeTime);
+
+	return TEST_RESULT();
+}
+#endif
@@ -0,0 +1,387 @@
+#if !defined(__AVR__)
+// AlarmOutputGroup fan-out, with the firmware's sink masks: every command and every AlarmManager state reaches every sink,
+// as its pattern if the sink plays it, as Stop otherwise.
+
+#define ALARM_NOTIFIER
+
+#include "Test.h"
+
+#include <TaskScheduler.h>
+
+#include "../Hal/Hal.h"
+#include "../AlarmManager.h"
+#include "../Output/AlarmOutputGroup.h"
+#include "../Output/HornRelay.h"
+#include "../Notification/AlarmNotifier.h"
+
+// Storage from WatchdogRecovery.cpp. Zeroed, so there is no snapshot to resume.
+uint8_t ResetFlags;
+RecoverySnapshot RecoveryState;
+
+static const uint8_t StopCommand = 0;
+
+// Records the commands it gets, playing the patterns it was given.
+class RecordingSink : public IAlarmOutput
+{
+public:
+	static const uint8_t Capacity = 8;
+
+	const uint8_t Patterns;
+
+	uint8_t Commands[Capacity];
+	uint8_t Count = 0;
+	uint8_t EnergyLevel = 0;
+	bool Primed = false;
+
+	RecordingSink(const uint8_t patterns)
+		: IAlarmOutput()
+		, Patterns(patterns)
+	{
+	}
+
+	void Clear()
+	{
+		Count = 0;
+	}
+
+	// The only command since Clear.
+	bool Got(const uint8_t command)
+	{
+		return Count == 1 && Commands[0] == command;
+	}
+
+	virtual uint8_t GetPatterns()
+	{
+		return Patterns;
+	}
+
+	virtual void Buzz(const uint32_t durationMillis)
+	{
+		Record(PatternEnum::Generic);
+	}
+
+	virtual void Stop()
+	{
+		Record(StopCommand);
+	}
+
+	virtual void SetEnergyLevel(const uint8_t level)
+	{
+		EnergyLevel = level;
+	}
+
+	virtual void SetPrimed(const bool primed)
+	{
+		Primed = primed;
+	}
+
+	virtual void PlayError()
+	{
+		Record(PatternEnum::Error);
+	}
+
+	virtual void PlayArmed()
+	{
+		Record(PatternEnum::Armed);
+	}
+
+	virtual void PlayArming()
+	{
+		Record(PatternEnum::Arming);
+	}
+
+	virtual void PlayArmingFailed()
+	{
+		Record(PatternEnum::ArmingFailed);
+	}
+
+	virtual void PlayNotArmed()
+	{
+		Record(PatternEnum::NotArmed);
+	}
+
+	virtual void PlayEarlyWarning()
+	{
+		Record(PatternEnum::EarlyWarning);
+	}
+
+	virtual void PlayAlarm()
+	{
+		Record(PatternEnum::Alarm);
+	}
+
+private:
+	void Record(const uint8_t command)
+	{
+		if (Count < Capacity)
+		{
+			Commands[Count] = command;
+		}
+		Count++;
+	}
+};
+
+class ScriptedInputReader : public IInputReader
+{
+public:
+	bool ArmSignal = false;
+
+	virtual bool IsArmSignalOn()
+	{
+		return ArmSignal;
+	}
+};
+
+class ScriptedMovementSensor : public IMovementSensor
+{
+public:
+	uint16_t MotionEventCount = 0;
+	uint32_t LastMotionMillis = 0;
+
+	void Move()
+	{
+		MotionEventCount++;
+		LastMotionMillis = Timebase::Millis();
+	}
+
+	virtual bool HasRecentSignificantMotion(const uint32_t period)
+	{
+		return MotionEventCount > 0 && (Timebase::Millis() - LastMotionMillis) < period;
+	}
+
+	virtual uint16_t GetMotionEventCount()
+	{
+		return MotionEventCount;
+	}
+
+	virtual uint16_t GetMotionDensity(const uint32_t period)
+	{
+		return HasRecentSignificantMotion(period) ? 1 : 0;
+	}
+};
+
+// The sketch's sinks: light and buzzer, aux light, horn and notifier.
+struct GroupFixture
+{
+	static const uint8_t SinkCount = 5;
+
+	Scheduler Base;
+	HornRelay<7> Horn;
+	AlarmNotifier Notifier;
+
+	RecordingSink Light;
+	RecordingSink Buzzer;
+	RecordingSink AuxLight;
+	RecordingSink HornSink;
+	RecordingSink NotifierSink;
+
+	RecordingSink* Sinks[SinkCount];
+
+	AlarmOutputGroup<SinkCount> Outputs;
+
+	GroupFixture()
+		: Notifier(&Base)
+		, Light(IAlarmOutput::AllPatterns)
+		, Buzzer(IAlarmOutput::AllPatterns)
+		, AuxLight(IAlarmOutput::AllPatterns)
+		, HornSink(Horn.GetPatterns())
+		, NotifierSink(Notifier.GetPatterns())
+		, Sinks{ &Light, &Buzzer, &AuxLight, &HornSink, &NotifierSink }
+	{
+	}
+
+	bool Setup()
+	{
+		// Aux light narrowed when added, as a second LED channel for the loud patterns.
+		return Outputs.Add(&Light)
+			&& Outputs.Add(&Buzzer)
+			&& Outputs.Add(&AuxLight, IAlarmOutput::PatternEnum::EarlyWarning | IAlarmOutput::PatternEnum::Alarm)
+			&& Outputs.Add(&HornSink)
+			&& Outputs.Add(&NotifierSink);
+	}
+
+	uint8_t GetSinkPatterns(const uint8_t index)
+	{
+		return index == 2
+			? (Sinks[index]->Patterns & (IAlarmOutput::PatternEnum::EarlyWarning | IAlarmOutput::PatternEnum::Alarm))
+			: Sinks[index]->Patterns;
+	}
+
+	void Clear()
+	{
+		for (uint8_t i = 0; i < SinkCount; i++)
+		{
+			Sinks[i]->Clear();
+		}
+	}
+
+	// Every sink got pattern if it plays it, Stop otherwise, and nothing else.
+	bool Reached(const uint8_t pattern)
+	{
+		bool Success = true;
+
+		for (uint8_t i = 0; i < SinkCount; i++)
+		{
+			const uint8_t Expected = (GetSinkPatterns(i) & pattern) ? pattern : StopCommand;
+
+			if (!Sinks[i]->Got(Expected))
+			{
+				printf("  sink %u: pattern 0x%02X, expected 0x%02X, got %u commands, first 0x%02X\n",
+					i, pattern, Expected, Sinks[i]->Count, Sinks[i]->Count > 0 ? Sinks[i]->Commands[0] : 0xFF);
+				Success = false;
+			}
+		}
+
+		Clear();
+
+		return Success;
+	}
+};
+
+static void TestAdd()
+{
+	GroupFixture Fixture;
+
+	CHECK(Fixture.Setup());
+	CHECK(Fixture.Outputs.GetCount() == GroupFixture::SinkCount);
+
+	// Full.
+	CHECK(!Fixture.Outputs.Add(&Fixture.Light));
+	CHECK(Fixture.Outputs.GetCount() == GroupFixture::SinkCount);
+
+	AlarmOutputGroup<1> Single;
+	CHECK(!Single.Add(nullptr));
+	CHECK(Single.GetCount() == 0);
+	CHECK(Single.GetPatterns() == 0);
+
+	// Union of the sink masks.
+	CHECK(Fixture.Outputs.GetPatterns() == IAlarmOutput::AllPatterns);
+	CHECK(Fixture.HornSink.Patterns == IAlarmOutput::PatternEnum::Alarm);
+	CHECK(!(Fixture.NotifierSink.Patterns & IAlarmOutput::PatternEnum::Arming));
+	CHECK(!(Fixture.NotifierSink.Patterns & IAlarmOutput::PatternEnum::Generic));
+}
+
+static void TestEveryCommandReachesEverySink()
+{
+	GroupFixture Fixture;
+
+	CHECK(Fixture.Setup());
+
+	Fixture.Outputs.PlayError();
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::Error));
+
+	Fixture.Outputs.PlayNotArmed();
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::NotArmed));
+
+	// Not sent by the notifier, nor played by the horn: both get Stop.
+	Fixture.Outputs.PlayArming();
+	CHECK(Fixture.NotifierSink.Got(StopCommand));
+	CHECK(Fixture.HornSink.Got(StopCommand));
+	CHECK(Fixture.Light.Got(IAlarmOutput::PatternEnum::Arming));
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::Arming));
+
+	Fixture.Outputs.PlayArmingFailed();
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::ArmingFailed));
+
+	Fixture.Outputs.PlayArmed();
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::Armed));
+
+	Fixture.Outputs.PlayEarlyWarning();
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::EarlyWarning));
+
+	Fixture.Outputs.PlayAlarm();
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::Alarm));
+
+	Fixture.Outputs.Buzz(100);
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::Generic));
+}
+
+static void TestStopAndSettingsReachEverySink()
+{
+	GroupFixture Fixture;
+
+	CHECK(Fixture.Setup());
+
+	Fixture.Outputs.Stop();
+	CHECK(Fixture.Reached(StopCommand));
+
+	Fixture.Outputs.SetEnergyLevel(42);
+	Fixture.Outputs.SetPrimed(true);
+	for (uint8_t i = 0; i < GroupFixture::SinkCount; i++)
+	{
+		CHECK(Fixture.Sinks[i]->EnergyLevel == 42);
+		CHECK(Fixture.Sinks[i]->Primed);
+		CHECK(Fixture.Sinks[i]->Count == 0);
+	}
+}
+
+// The manager through every state, with the group as its outputs.
+static void TestEveryStateDrivesEverySink()
+{
+	GroupFixture Fixture;
+	Scheduler High;
+	ScriptedInputReader Reader;
+	ScriptedMovementSensor Sensor;
+	IBatteryMonitor Battery;
+	WatchdogRecovery Recovery;
+	PersistentLog Log;
+	AlarmManager Manager(&High);
+
+	CHECK(Fixture.Setup());
+	CHECK(Log.Setup());
+
+	// WakingUp.
+	CHECK(Manager.Setup(&Fixture.Outputs, &Sensor, &Reader, &Battery, &Log, &Recovery));
+	CHECK(Fixture.Reached(StopCommand));
+
+	RunScheduler(High, MIN_RUN_PERIOD_MILLIS);
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::NotArmed));
+
+	Reader.ArmSignal = true;
+	Manager.OnEvent();
+	RunScheduler(High, MIN_RUN_PERIOD_MILLIS);
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::Arming));
+
+	// Motion in the arming period.
+	RunScheduler(High, ARM_PERIOD_MILLIS / 2);
+	Sensor.Move();
+	RunScheduler(High, ARM_PERIOD_MILLIS / 2);
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::ArmingFailed));
+
+	RunScheduler(High, REARM_WAIT_PERIOD_MILLIS + MIN_RUN_PERIOD_MILLIS);
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::Arming));
+
+	RunScheduler(High, ARM_PERIOD_MILLIS);
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::Armed));
+
+	Sensor.Move();
+	Manager.OnEvent();
+	RunScheduler(High, MIN_RUN_PERIOD_MILLIS);
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::EarlyWarning));
+
+	RunScheduler(High, pgm_read_dword(&DefaultLadder[1].GraceMillis));
+	Sensor.Move();
+	Manager.OnEvent();
+	RunScheduler(High, MIN_RUN_PERIOD_MILLIS);
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::Alarm));
+
+	Reader.ArmSignal = false;
+	Manager.OnEvent();
+	RunScheduler(High, MIN_RUN_PERIOD_MILLIS);
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::NotArmed));
+
+	// Disabled, on a failed setup. The log is the only dependency the Disabled state does without.
+	CHECK(!Manager.Setup(&Fixture.Outputs, &Sensor, &Reader, &Battery, nullptr, &Recovery));
+	CHECK(Fixture.Reached(IAlarmOutput::PatternEnum::Error));
+}
+
+int main()
+{
+	RUN_TEST(TestAdd);
+	RUN_TEST(TestEveryCommandReachesEverySink);
+	RUN_TEST(TestStopAndSettingsReachEverySink);
+	RUN_TEST(TestEveryStateDrivesEverySink);
+
+	return TEST_RESULT();
+}
+#endif
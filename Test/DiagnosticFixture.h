@@ -0,0 +1,98 @@
+// DiagnosticFixture.h
+
+#ifndef _DIAGNOSTICFIXTURE_h
+#define _DIAGNOSTICFIXTURE_h
+
+#define DIAGNOSTIC_PORT
+
+#include <TaskSchedulerDeclarations.h>
+
+#include "../Hal/Hal.h"
+#include "../AlarmManager.h"
+#include "../Diagnostics/DiagnosticPort.h"
+
+// The firmware's AlarmManager and DiagnosticPort over fixed sensor readings, on the Linux HAL.
+// Shared by DiagnosticPortTest and DiagnosticStandIn, include from one translation unit.
+
+// Storage from WatchdogRecovery.cpp. Zeroed, so there is no snapshot to resume.
+uint8_t ResetFlags;
+RecoverySnapshot RecoveryState;
+
+class FixedMovementSensor : public IMovementSensor
+{
+public:
+	uint16_t MotionEventCount = 0;
+	uint16_t RotationEventCount = 0;
+	MovementSensorConfiguration Configuration = { -502, -185, 1162, 2, 1 };
+
+	virtual uint16_t GetMotionEventCount()
+	{
+		return MotionEventCount;
+	}
+
+	virtual uint16_t GetRotationEventCount()
+	{
+		return RotationEventCount;
+	}
+
+	virtual void GetConfiguration(MovementSensorConfiguration& configuration)
+	{
+		configuration = Configuration;
+	}
+};
+
+class FixedBatteryMonitor : public IBatteryMonitor
+{
+public:
+	uint16_t MilliVolts = 3900;
+
+	virtual uint16_t GetMilliVolts()
+	{
+		return MilliVolts;
+	}
+};
+
+struct DiagnosticFixture
+{
+	// USART0 RXD.
+	static const uint8_t RxPin = 0;
+
+	Scheduler Base;
+	Scheduler High;
+
+	IAlarmOutput Outputs;
+	IInputReader Reader;
+	FixedMovementSensor Sensor;
+	FixedBatteryMonitor Battery;
+	WatchdogRecovery Recovery;
+	PersistentLog Log;
+
+	AlarmManager Manager;
+	DiagnosticPort Port;
+
+	DiagnosticFixture()
+		: Manager(&High)
+		, Port(&Base)
+	{
+		Base.setHighPriorityScheduler(&High);
+	}
+
+	bool Setup()
+	{
+		// Idle line, USART off as the sketch leaves it.
+		HalFakeSetPin(RxPin, true);
+		HalPower::Disable(PeripheralEnum::Usart0);
+
+		return Log.Setup()
+			&& Manager.Setup(&Outputs, &Sensor, &Reader, &Battery, &Log, &Recovery)
+			&& Port.Setup(&Manager, &Sensor, &Battery, &Log);
+	}
+
+	// A byte arriving while the port sleeps is only seen as the falling edge of its start bit.
+	void Break()
+	{
+		HalFakeSetPin(RxPin, false);
+		HalFakeSetPin(RxPin, true);
+	}
+};
+#endif
@@ -0,0 +1,254 @@
+#if !defined(__AVR__)
+// DiagnosticPort protocol on the USART model: break wake-up, framing, checksums, payloads and idle power-down.
+
+#include "Test.h"
+
+#include <TaskScheduler.h>
+
+#include "DiagnosticFixture.h"
+
+static const uint8_t UsartBit = 1 << (uint8_t)PeripheralEnum::Usart0;
+
+static void SendRequest(const uint8_t command, const uint8_t argument)
+{
+	HalFakeWriteUsart(DiagnosticPort::RequestSync);
+	HalFakeWriteUsart(command);
+	HalFakeWriteUsart(argument);
+	HalFakeWriteUsart(DiagnosticPort::RequestSync ^ command ^ argument);
+}
+
+// Takes everything sent on TX, returns the byte count.
+static uint8_t ReadResponse(uint8_t* frame, const uint8_t capacity)
+{
+	uint8_t Size = 0;
+	uint8_t Value;
+
+	while (HalFakeReadUsart(Value))
+	{
+		if (Size < capacity)
+		{
+			frame[Size] = Value;
+		}
+		Size++;
+	}
+
+	return Size;
+}
+
+// One complete response frame, with a valid checksum.
+static bool IsResponse(const uint8_t* frame, const uint8_t size, const uint8_t command, const uint8_t length)
+{
+	if (size != 3 + length + 1 || frame[0] != DiagnosticPort::ResponseSync || frame[1] != command || frame[2] != length)
+	{
+		return false;
+	}
+
+	uint8_t Checksum = 0;
+	for (uint8_t i = 0; i < size - 1; i++)
+	{
+		Checksum ^= frame[i];
+	}
+
+	return Checksum == frame[size - 1];
+}
+
+static void Wake(DiagnosticFixture& fixture)
+{
+	fixture.Break();
+	RunScheduler(fixture.Base, 2);
+}
+
+static void TestSleepsUntilBreak()
+{
+	DiagnosticFixture Context;
+
+	CHECK(Context.Setup());
+	RunScheduler(Context.Base, 100);
+
+	// Off by default, requests go nowhere.
+	CHECK(!HalFake.UsartEnabled);
+	CHECK((HalFake.PoweredMask & UsartBit) == 0);
+	CHECK(HalFake.PinChangeEnabled[DiagnosticFixture::RxPin]);
+	SendRequest(DiagnosticPort::CommandEnum::Ping, 0);
+	CHECK(HalFake.UsartRxDropped == 4);
+
+	// Powers up once RX is back high.
+	HalFakeSetPin(DiagnosticFixture::RxPin, false);
+	RunScheduler(Context.Base, 5);
+	CHECK(!HalFake.UsartEnabled);
+	CHECK(!HalFake.PinChangeEnabled[DiagnosticFixture::RxPin]);
+
+	HalFakeSetPin(DiagnosticFixture::RxPin, true);
+	RunScheduler(Context.Base, 1);
+	CHECK(HalFake.UsartEnabled && HalFake.UsartReceiving);
+	CHECK(HalFake.UsartBaudRate == 38400);
+	CHECK((HalFake.PoweredMask & UsartBit) != 0);
+	CHECK(HalFake.FineRequests != 0);
+}
+
+static void TestPing()
+{
+	DiagnosticFixture Context;
+	uint8_t Frame[32];
+
+	CHECK(Context.Setup());
+	Wake(Context);
+
+	SendRequest(DiagnosticPort::CommandEnum::Ping, 0);
+	RunScheduler(Context.Base, 1);
+
+	const uint8_t Size = ReadResponse(Frame, sizeof(Frame));
+	CHECK(IsResponse(Frame, Size, DiagnosticPort::CommandEnum::Ping, 1));
+	CHECK(Frame[3] == DiagnosticPort::ProtocolVersion);
+}
+
+static void TestPayloads()
+{
+	DiagnosticFixture Context;
+	uint8_t Frame[32];
+	uint8_t Size;
+
+	CHECK(Context.Setup());
+	Context.Sensor.MotionEventCount = 0x1234;
+	Context.Sensor.RotationEventCount = 7;
+	HalFake.FreeRam = 600;
+	HalFake.StackHeadroom = 400;
+	Wake(Context);
+
+	SendRequest(DiagnosticPort::CommandEnum::State, 0);
+	RunScheduler(Context.Base, 1);
+	Size = ReadResponse(Frame, sizeof(Frame));
+	CHECK(IsResponse(Frame, Size, DiagnosticPort::CommandEnum::State, 7));
+	CHECK(Frame[3] == Context.Manager.GetState());
+	CHECK(Frame[8] == 0);
+
+	// Little-endian.
+	SendRequest(DiagnosticPort::CommandEnum::Counters, 0);
+	RunScheduler(Context.Base, 1);
+	Size = ReadResponse(Frame, sizeof(Frame));
+	CHECK(IsResponse(Frame, Size, DiagnosticPort::CommandEnum::Counters, 16));
+	CHECK(Frame[7] == 0x34 && Frame[8] == 0x12);
+	CHECK(Frame[9] == (600 & 0xFF) && Frame[10] == (600 >> 8));
+	CHECK(Frame[11] == (400 & 0xFF) && Frame[12] == (400 >> 8));
+	CHECK(Frame[13] == (3900 & 0xFF) && Frame[14] == (3900 >> 8));
+	CHECK(Frame[15] == 2 && Frame[16] == 0);
+	CHECK(Frame[17] == 7 && Frame[18] == 0);
+
+	SendRequest(DiagnosticPort::CommandEnum::SensorConfig, 0);
+	RunScheduler(Context.Base, 1);
+	Size = ReadResponse(Frame, sizeof(Frame));
+	CHECK(IsResponse(Frame, Size, DiagnosticPort::CommandEnum::SensorConfig, sizeof(MovementSensorConfiguration)));
+	CHECK((int16_t)(Frame[3] | (Frame[4] << 8)) == -502);
+	CHECK(Frame[9] == 2 && Frame[10] == 1);
+}
+
+static void TestLogEntry()
+{
+	DiagnosticFixture Context;
+	uint8_t Frame[32];
+	uint8_t Size;
+
+	CHECK(Context.Setup());
+	Context.Log.Write(PersistentLog::CodeEnum::BrownOutReset, 3, 0xBEEF);
+	Wake(Context);
+
+	// Oldest first, the only entry is the last.
+	SendRequest(DiagnosticPort::CommandEnum::LogEntry, PersistentLog::Capacity - 1);
+	RunScheduler(Context.Base, 1);
+	Size = ReadResponse(Frame, sizeof(Frame));
+	CHECK(IsResponse(Frame, Size, DiagnosticPort::CommandEnum::LogEntry, 4));
+	CHECK(Frame[3] == PersistentLog::CodeEnum::BrownOutReset && Frame[4] == 3);
+	CHECK(Frame[5] == 0xEF && Frame[6] == 0xBE);
+
+	// Erased or past the end is an error, without payload.
+	SendRequest(DiagnosticPort::CommandEnum::LogEntry, 0);
+	RunScheduler(Context.Base, 1);
+	Size = ReadResponse(Frame, sizeof(Frame));
+	CHECK(IsResponse(Frame, Size, DiagnosticPort::CommandEnum::LogEntry | DiagnosticPort::ErrorFlag, 0));
+
+	SendRequest(DiagnosticPort::CommandEnum::LogEntry, PersistentLog::Capacity);
+	RunScheduler(Context.Base, 1);
+	Size = ReadResponse(Frame, sizeof(Frame));
+	CHECK(IsResponse(Frame, Size, DiagnosticPort::CommandEnum::LogEntry | DiagnosticPort::ErrorFlag, 0));
+
+	SendRequest(0x7F, 0);
+	RunScheduler(Context.Base, 1);
+	Size = ReadResponse(Frame, sizeof(Frame));
+	CHECK(IsResponse(Frame, Size, 0x7F | DiagnosticPort::ErrorFlag, 0));
+}
+
+static void TestFramingErrors()
+{
+	DiagnosticFixture Context;
+	uint8_t Frame[32];
+	uint8_t Size;
+
+	CHECK(Context.Setup());
+	Wake(Context);
+
+	// Bad checksum is not answered.
+	HalFakeWriteUsart(DiagnosticPort::RequestSync);
+	HalFakeWriteUsart(DiagnosticPort::CommandEnum::Ping);
+	HalFakeWriteUsart(0);
+	HalFakeWriteUsart(0);
+	RunScheduler(Context.Base, 1);
+	CHECK(ReadResponse(Frame, sizeof(Frame)) == 0);
+
+	// Noise before the sync byte is skipped.
+	HalFakeWriteUsart(0x00);
+	HalFakeWriteUsart(0x13);
+	SendRequest(DiagnosticPort::CommandEnum::Ping, 0);
+	RunScheduler(Context.Base, 1);
+	Size = ReadResponse(Frame, sizeof(Frame));
+	CHECK(IsResponse(Frame, Size, DiagnosticPort::CommandEnum::Ping, 1));
+
+	// Split across task runs.
+	HalFakeWriteUsart(DiagnosticPort::RequestSync);
+	HalFakeWriteUsart(DiagnosticPort::CommandEnum::Ping);
+	RunScheduler(Context.Base, 1);
+	HalFakeWriteUsart(0);
+	HalFakeWriteUsart(DiagnosticPort::RequestSync ^ DiagnosticPort::CommandEnum::Ping);
+	RunScheduler(Context.Base, 1);
+	Size = ReadResponse(Frame, sizeof(Frame));
+	CHECK(IsResponse(Frame, Size, DiagnosticPort::CommandEnum::Ping, 1));
+}
+
+static void TestIdlePowerDown()
+{
+	DiagnosticFixture Context;
+	uint8_t Frame[32];
+
+	CHECK(Context.Setup());
+	const uint8_t FineRequests = HalFake.FineRequests;
+	Wake(Context);
+
+	SendRequest(DiagnosticPort::CommandEnum::Ping, 0);
+	RunScheduler(Context.Base, DIAGNOSTIC_IDLE_TIMEOUT_MILLIS);
+	CHECK(HalFake.UsartEnabled);
+
+	RunScheduler(Context.Base, DIAGNOSTIC_IDLE_TIMEOUT_MILLIS);
+	CHECK(!HalFake.UsartEnabled);
+	CHECK((HalFake.PoweredMask & UsartBit) == 0);
+	CHECK(HalFake.FineRequests == FineRequests);
+	CHECK(HalFake.PinChangeEnabled[DiagnosticFixture::RxPin]);
+	ReadResponse(Frame, sizeof(Frame));
+
+	// And wakes again.
+	Wake(Context);
+	SendRequest(DiagnosticPort::CommandEnum::Ping, 0);
+	RunScheduler(Context.Base, 1);
+	CHECK(IsResponse(Frame, ReadResponse(Frame, sizeof(Frame)), DiagnosticPort::CommandEnum::Ping, 1));
+}
+
+int main()
+{
+	RUN_TEST(TestSleepsUntilBreak);
+	RUN_TEST(TestPing);
+	RUN_TEST(TestPayloads);
+	RUN_TEST(TestLogEntry);
+	RUN_TEST(TestFramingErrors);
+	RUN_TEST(TestIdlePowerDown);
+
+	return TEST_RESULT();
+}
+#endif
@@ -0,0 +1,52 @@
+#if !defined(__AVR__)
+// Device stand-in for the diagnostic client: the firmware's DiagnosticPort on the Linux HAL, with USART0 on a pseudo terminal.
+// Prints the pty path and serves until interrupted, in real time. See Tools/DiagnosticClient.py.
+
+#include <TaskScheduler.h>
+
+#include "DiagnosticFixture.h"
+#include "PtyLink.h"
+
+int main()
+{
+	HalFakeReset();
+
+	DiagnosticFixture Context;
+	if (!Context.Setup())
+	{
+		fprintf(stderr, "Setup failed.\n");
+
+		return 1;
+	}
+
+	PtyLink Link;
+	if (!Link.Open())
+	{
+		return 1;
+	}
+
+	for (;;)
+	{
+		uint8_t Buffer[HalFakeUsartBufferSize];
+		const ssize_t Count = Link.Read(Buffer, sizeof(Buffer));
+
+		for (ssize_t i = 0; i < Count; i++)
+		{
+			if (HalFake.UsartReceiving)
+			{
+				HalFakeWriteUsart(Buffer[i]);
+			}
+			else
+			{
+				// A pty carries no break, any byte wakes the port as on the real line.
+				Context.Break();
+			}
+		}
+
+		Link.Run(Context.Base);
+		Link.Flush();
+	}
+
+	return 0;
+}
+#endif
@@ -0,0 +1,87 @@
+// Arduino.h
+
+#ifndef _ARDUINO_h
+#define _ARDUINO_h
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../../Hal/Linux/HalFake.h"
+
+// Host stand-in for the Arduino core calls the firmware still makes, on the HalFake state.
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define LED_BUILTIN 13
+
+#define SDA 18
+#define SCL 19
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A6 20
+#define A7 21
+
+#ifndef _BV
+#define _BV(bit) (1 << (bit))
+#endif
+
+inline void noInterrupts()
+{
+	HalFake.InterruptsDisabled = true;
+}
+
+inline void interrupts()
+{
+	HalFake.InterruptsDisabled = false;
+}
+
+inline unsigned long millis()
+{
+	return HalFake.Millis;
+}
+
+inline void delay(const unsigned long ms)
+{
+	HalFake.Millis += ms;
+}
+
+inline void delayMicroseconds(const unsigned int us)
+{
+}
+
+inline void pinMode(const uint8_t pin, const uint8_t mode)
+{
+	if (pin < HalFakeState::PinCount)
+	{
+		HalFake.PinOutput[pin] = mode == OUTPUT;
+		HalFake.PinPullup[pin] = mode == INPUT_PULLUP;
+	}
+}
+
+inline void digitalWrite(const uint8_t pin, const uint8_t value)
+{
+	if (pin < HalFakeState::PinCount)
+	{
+		HalFake.PinWrites++;
+		HalFake.PinLevel[pin] = value != LOW;
+	}
+}
+
+inline int digitalRead(const uint8_t pin)
+{
+	return (pin < HalFakeState::PinCount && HalFake.PinLevel[pin]) ? HIGH : LOW;
+}
+
+inline long map(const long x, const long inMin, const long inMax, const long outMin, const long outMax)
+{
+	return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+#endif
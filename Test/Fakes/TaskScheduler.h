@@ -0,0 +1,177 @@
+// TaskScheduler.h
+
+#ifndef _TASKSCHEDULER_h
+#define _TASKSCHEDULER_h
+
+#include "TaskSchedulerDeclarations.h"
+
+#include "../../Timebase/Timebase.h"
+#include "../../Hal/Linux/HalFake.h"
+
+// Host stand-in implementation, include from a single translation unit.
+
+Task::Task(const uint32_t interval, const long iterations, Scheduler* scheduler, const bool enable)
+	: Owner(scheduler)
+	, Interval(interval)
+	, Iterations(iterations)
+	, Remaining(iterations)
+{
+	if (Owner != nullptr)
+	{
+		Owner->Add(this);
+	}
+
+	if (enable)
+	{
+		this->enable();
+	}
+}
+
+void Task::enable()
+{
+	Enabled = OnEnable();
+	Remaining = Iterations;
+	PreviousMillis = Timebase::Millis() - (Delay = Interval);
+}
+
+bool Task::enableIfNot()
+{
+	const bool WasEnabled = Enabled;
+
+	if (!WasEnabled)
+	{
+		enable();
+	}
+
+	return WasEnabled;
+}
+
+bool Task::disable()
+{
+	const bool WasEnabled = Enabled;
+	Enabled = false;
+
+	if (WasEnabled)
+	{
+		OnDisable();
+	}
+
+	return WasEnabled;
+}
+
+void Task::delay(const uint32_t delay)
+{
+	Delay = delay != 0 ? delay : Interval;
+	PreviousMillis = Timebase::Millis();
+}
+
+void Task::forceNextIteration()
+{
+	PreviousMillis = Timebase::Millis() - (Delay = Interval);
+}
+
+long Task::timeUntilNextIteration()
+{
+	if (!Enabled)
+	{
+		return -1;
+	}
+
+	const uint32_t Elapsed = Timebase::Millis() - PreviousMillis;
+
+	return Elapsed >= Delay ? 0 : (long)(Delay - Elapsed);
+}
+
+void Scheduler::Add(Task* task)
+{
+	if (Last == nullptr)
+	{
+		First = task;
+	}
+	else
+	{
+		Last->Next = task;
+	}
+	Last = task;
+}
+
+bool Scheduler::execute()
+{
+	bool Idle = true;
+
+	for (Task* Current = First; Current != nullptr; Current = Current->Next)
+	{
+		if (High != nullptr)
+		{
+			Idle &= High->execute();
+		}
+
+		// Interrupts are taken between tasks.
+		HalFakeRunInterrupts();
+
+		if (!Current->Enabled)
+		{
+			continue;
+		}
+
+		const uint32_t Now = Timebase::Millis();
+		const uint32_t Elapsed = Now - Current->PreviousMillis;
+
+		if (Elapsed < Current->Delay)
+		{
+			continue;
+		}
+
+		if (Current->Iterations >= 0)
+		{
+			if (Current->Remaining == 0)
+			{
+				Current->disable();
+
+				continue;
+			}
+			Current->Remaining--;
+		}
+
+		Current->StartDelay = Elapsed - Current->Delay;
+		Current->PreviousMillis += Current->Delay;
+		Current->Delay = Current->Interval;
+
+		Idle = !Current->Callback() && Idle;
+	}
+
+	if (First == nullptr && High != nullptr)
+	{
+		Idle &= High->execute();
+	}
+
+	return Idle;
+}
+
+long Scheduler::timeUntilNextIteration()
+{
+	long Next = -1;
+
+	for (Task* Current = First; Current != nullptr; Current = Current->Next)
+	{
+		const long Until = Current->timeUntilNextIteration();
+
+		if (Until >= 0 && (Next < 0 || Until < Next))
+		{
+			Next = Until;
+		}
+	}
+
+	if (High != nullptr)
+	{
+		const long Until = High->timeUntilNextIteration();
+
+		if (Until >= 0 && (Next < 0 || Until < Next))
+		{
+			Next = Until;
+		}
+	}
+
+	return Next;
+}
+#endif
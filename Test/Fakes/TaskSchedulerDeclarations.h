@@ -0,0 +1,99 @@
+// TaskSchedulerDeclarations.h
+
+#ifndef _TASKSCHEDULERDECLARATIONS_h
+#define _TASKSCHEDULERDECLARATIONS_h
+
+#include <stdint.h>
+
+// Host stand-in for the TaskScheduler subset in use: object callbacks, external time (Timebase::Millis),
+// and a high priority layer that runs in full between any two base tasks.
+// Timing follows TaskScheduler 3: a task runs once Millis() - previous >= delay,
+// delay() restarts the wait from now and forceNextIteration() makes it due at once.
+
+#define TASK_FOREVER (-1)
+
+class Scheduler;
+
+class Task
+{
+	friend class Scheduler;
+
+private:
+	Scheduler* Owner;
+	Task* Next = nullptr;
+
+	uint32_t Interval;
+	long Iterations;
+	long Remaining;
+	uint32_t PreviousMillis = 0;
+	uint32_t Delay = 0;
+	uint32_t StartDelay = 0;
+	bool Enabled = false;
+
+public:
+	Task(const uint32_t interval, const long iterations, Scheduler* scheduler, const bool enable);
+	virtual ~Task() {}
+
+	virtual bool Callback() = 0;
+
+	virtual bool OnEnable()
+	{
+		return true;
+	}
+
+	virtual void OnDisable()
+	{
+	}
+
+	void enable();
+	bool enableIfNot();
+	bool disable();
+	void delay(const uint32_t delay = 0);
+	void forceNextIteration();
+
+	bool isEnabled()
+	{
+		return Enabled;
+	}
+
+	// Lateness of the current run, with _TASK_TIMECRITICAL.
+	uint32_t getStartDelay()
+	{
+		return StartDelay;
+	}
+
+	// Time until the next run, 0 if due, -1 if disabled.
+	long timeUntilNextIteration();
+};
+
+class Scheduler
+{
+	friend class Task;
+
+private:
+	Task* First = nullptr;
+	Task* Last = nullptr;
+	Scheduler* High = nullptr;
+	bool Sleep = true;
+
+public:
+	void setHighPriorityScheduler(Scheduler* high)
+	{
+		High = high;
+	}
+
+	void allowSleep(const bool sleep)
+	{
+		Sleep = sleep;
+	}
+
+	// One pass over the chain. Returns true if no callback ran.
+	bool execute();
+
+	// Time until the next task is due, in this layer and the high layer. -1 if none is enabled.
+	long timeUntilNextIteration();
+
+private:
+	void Add(Task* task);
+};
+#endif
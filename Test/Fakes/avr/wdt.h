@@ -0,0 +1,46 @@
+// wdt.h
+
+#ifndef _AVR_WDT_h
+#define _AVR_WDT_h
+
+#include "../../../Hal/Linux/HalFake.h"
+
+// Host stand-in for avr-libc watchdog calls, and the MCUSR reset flags.
+// The watchdog never fires, tests read back the timeout and kicks.
+
+#ifndef _BV
+#define _BV(bit) (1 << (bit))
+#endif
+
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+
+#define WDTO_15MS 0
+#define WDTO_30MS 1
+#define WDTO_60MS 2
+#define WDTO_120MS 3
+#define WDTO_250MS 4
+#define WDTO_500MS 5
+#define WDTO_1S 6
+#define WDTO_2S 7
+#define WDTO_4S 8
+#define WDTO_8S 9
+
+inline void wdt_enable(const uint8_t timeout)
+{
+	HalFake.WatchdogTimeout = timeout;
+	HalFake.WatchdogEnabled = true;
+}
+
+inline void wdt_disable()
+{
+	HalFake.WatchdogEnabled = false;
+}
+
+inline void wdt_reset()
+{
+	HalFake.WatchdogKicks++;
+}
+#endif
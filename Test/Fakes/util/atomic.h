@@ -0,0 +1,28 @@
+// atomic.h
+
+#ifndef _UTIL_ATOMIC_h
+#define _UTIL_ATOMIC_h
+
+#include "../../../Hal/Linux/HalFake.h"
+
+// Host stand-in for avr-libc ATOMIC_BLOCK, holds the simulated interrupts.
+static inline bool HalFakeAtomicEnter()
+{
+	const bool WasDisabled = HalFake.InterruptsDisabled;
+	HalFake.InterruptsDisabled = true;
+
+	return WasDisabled;
+}
+
+static inline void HalFakeAtomicRestore(const bool* wasDisabled)
+{
+	HalFake.InterruptsDisabled = *wasDisabled;
+}
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+
+#define ATOMIC_BLOCK(type) \
+	for (bool HalFakeAtomicState __attribute__((__cleanup__(HalFakeAtomicRestore))) = HalFakeAtomicEnter(), \
+		HalFakeAtomicOnce = true; HalFakeAtomicOnce; HalFakeAtomicOnce = false)
+#endif
@@ -0,0 +1,16 @@
+// crc16.h
+
+#ifndef _UTIL_CRC16_h
+#define _UTIL_CRC16_h
+
+#include <stdint.h>
+
+// Host stand-in for avr-libc _crc_ccitt_update, the equivalent C code from its documentation.
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data)
+{
+	data ^= crc & 0xFF;
+	data ^= data << 4;
+
+	return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+}
+#endif
@@ -0,0 +1,377 @@
+#if !defined(__AVR__)
+// MovementSensor over both accelerometer drivers, against the device models through the TwiDriver.
+// Setup, wake, coalescing and sleep, with the supply current read back from the model.
+// The gyro confirmation stage while parked, with its charge per check from the model.
+// Vibration storm benchmark: passes, wakes and bus traffic per second at several pulse rates.
+
+#include "Test.h"
+
+#include <TaskScheduler.h>
+
+#include "../Hal/Hal.h"
+#include "../Hal/Linux/FakeMPU6050.h"
+#include "../Hal/Linux/FakeLIS3DH.h"
+#include "../MovementSensor/MovementSensor.h"
+
+static const uint8_t SensorPin = 3;
+
+class CountingListener : public IEventListener
+{
+public:
+	uint16_t Count = 0;
+
+	virtual void OnEvent()
+	{
+		Count++;
+	}
+};
+
+struct MPU6050Fixture
+{
+	typedef MovementSensor<SensorPin, MPU6050Sensor> SensorType;
+
+	static const uint32_t SleepNanoAmps = 5000;
+	static const uint32_t ActiveNanoAmps = 500000;
+
+	Scheduler Base;
+	TwiDriver Twi;
+	FakeMPU6050 Device;
+	SensorType Sensor;
+
+	MPU6050Fixture()
+		: Twi(&Base)
+		, Sensor(&Base, &Twi, 10, -20, 1162)
+	{
+	}
+
+	void CheckSetup()
+	{
+		// Setup sequence, then the offsets in one big-endian burst.
+		CHECK(Device.Registers[FakeMPU6050::RegisterPowerManagement1] == 0x09);
+		CHECK(Device.Registers[FakeMPU6050::RegisterPowerManagement2] == 0x07);
+		CHECK(Device.Registers[0x38] == 0xC0);
+		CHECK(Device.Registers[0x06] == 0x00 && Device.Registers[0x07] == 10);
+		CHECK(Device.Registers[0x08] == 0xFF && Device.Registers[0x09] == 0xEC);
+		CHECK(Device.Registers[0x0A] == 0x04 && Device.Registers[0x0B] == 0x8A);
+	}
+};
+
+struct LIS3DHFixture
+{
+	typedef MovementSensor<SensorPin, LIS3DHSensor> SensorType;
+
+	static const uint32_t SleepNanoAmps = 500;
+	static const uint32_t ActiveNanoAmps = 3000;
+
+	Scheduler Base;
+	TwiDriver Twi;
+	FakeLIS3DH Device;
+	SensorType Sensor;
+
+	LIS3DHFixture()
+		: Twi(&Base)
+		, Sensor(&Base, &Twi)
+	{
+	}
+
+	void CheckSetup()
+	{
+		// Powered down, wake-up on INT1 from any axis.
+		CHECK(Device.Registers[FakeLIS3DH::RegisterControl1] == 0x08);
+		CHECK(Device.Registers[0x22] == 0x40);
+		CHECK(Device.Registers[0x30] == 0x2A);
+	}
+};
+
+// Falling edge, then back to idle high.
+static void Pulse()
+{
+	HalFakeSetPin(SensorPin, false);
+	HalFakeSetPin(SensorPin, true);
+}
+
+template<typename Fixture>
+static bool SetupFixture(Fixture& fixture, CountingListener& listener)
+{
+	HalFakeSetPin(SDA, true);
+	HalFakeSetPin(SensorPin, true);
+	HalFakeAttachTwi(&fixture.Device);
+
+	return fixture.Twi.Setup() && fixture.Sensor.Setup(&listener);
+}
+
+template<typename Fixture>
+static void TestSetup()
+{
+	Fixture Context;
+	CountingListener Listener;
+
+	CHECK(SetupFixture(Context, Listener));
+	Context.CheckSetup();
+	CHECK(Context.Twi.GetErrorCount() == 0);
+
+	// Not listening before enabled.
+	CHECK(!HalFake.InterruptEnabled[SensorPin - 2]);
+}
+
+template<typename Fixture>
+static void TestSetupFailsWithoutDevice()
+{
+	Fixture Context;
+	CountingListener Listener;
+
+	HalFakeSetPin(SDA, true);
+	CHECK(Context.Twi.Setup());
+	CHECK(!Context.Sensor.Setup(&Listener));
+}
+
+template<typename Fixture>
+static void TestWakeAndSleep()
+{
+	Fixture Context;
+	CountingListener Listener;
+
+	CHECK(SetupFixture(Context, Listener));
+
+	Context.Sensor.Disable();
+	RunScheduler(Context.Base, 1);
+	CHECK(Context.Device.GetSupplyNanoAmps() == Fixture::SleepNanoAmps);
+
+	Context.Sensor.Enable();
+	RunScheduler(Context.Base, 1);
+	CHECK(Context.Device.GetSupplyNanoAmps() == Fixture::ActiveNanoAmps);
+	CHECK(HalFake.InterruptEnabled[SensorPin - 2]);
+	CHECK(HalFake.PinPullup[SensorPin]);
+
+	Context.Sensor.Disable();
+	RunScheduler(Context.Base, 1);
+	CHECK(Context.Device.GetSupplyNanoAmps() == Fixture::SleepNanoAmps);
+	CHECK(!HalFake.InterruptEnabled[SensorPin - 2]);
+
+	// Motion while asleep is not counted.
+	Pulse();
+	RunScheduler(Context.Base, MOTION_COALESCE_WINDOW_MILLIS);
+	CHECK(Listener.Count == 0);
+	CHECK(Context.Sensor.GetMotionEventCount() == 0);
+	CHECK(Context.Twi.GetErrorCount() == 0);
+}
+
+template<typename Fixture>
+static void TestCoalesce()
+{
+	Fixture Context;
+	CountingListener Listener;
+
+	CHECK(SetupFixture(Context, Listener));
+	Context.Sensor.Enable();
+	RunScheduler(Context.Base, 1);
+
+	// First motion is forwarded at once.
+	Pulse();
+	RunScheduler(Context.Base, 1);
+	CHECK(Listener.Count == 1);
+	CHECK(Context.Sensor.HasRecentSignificantMotion(10));
+
+	// More during the window are forwarded as one, when it ends.
+	Pulse();
+	RunScheduler(Context.Base, 10);
+	Pulse();
+	Pulse();
+	RunScheduler(Context.Base, MOTION_COALESCE_WINDOW_MILLIS - 20);
+	CHECK(Listener.Count == 1);
+	RunScheduler(Context.Base, 20);
+	CHECK(Listener.Count == 2);
+	CHECK(Context.Sensor.GetMotionEventCount() == 4);
+	CHECK(Context.Sensor.GetMotionDensity(1000) == 4);
+
+	// A quiet window goes back to listening, the next motion is forwarded at once.
+	RunScheduler(Context.Base, MOTION_COALESCE_WINDOW_MILLIS + 1);
+	CHECK(Listener.Count == 2);
+	CHECK(Context.Base.timeUntilNextIteration() < 0);
+
+	Pulse();
+	RunScheduler(Context.Base, 1);
+	CHECK(Listener.Count == 3);
+	CHECK(Context.Sensor.GetMotionEventCount() == 5);
+}
+
+template<typename Fixture>
+static void TestWakeRetriesOnBusError()
+{
+	Fixture Context;
+	CountingListener Listener;
+
+	CHECK(SetupFixture(Context, Listener));
+	Context.Sensor.Disable();
+	RunScheduler(Context.Base, 1);
+
+	HalFake.TwiFault = (uint8_t)HalFakeTwiFaultEnum::AddressNack;
+	Context.Sensor.Enable();
+	RunScheduler(Context.Base, 1);
+	CHECK(Context.Twi.GetErrorCount() == 1);
+	CHECK(!HalFake.InterruptEnabled[SensorPin - 2]);
+
+	// Configured again after the bus retry period.
+	RunScheduler(Context.Base, 20);
+	CHECK(Context.Device.GetSupplyNanoAmps() == Fixture::ActiveNanoAmps);
+	CHECK(HalFake.InterruptEnabled[SensorPin - 2]);
+
+	Pulse();
+	RunScheduler(Context.Base, 1);
+	CHECK(Listener.Count == 1);
+}
+
+// The sensor pin pulsed at several rates while parked, 10 s each.
+// The listener stands in for AlarmManager, each event wakes it.
+// Sensor passes are the scheduler passes that ran a callback, exact while the bus stays quiet.
+template<typename Fixture>
+static void TestVibrationStorm()
+{
+	static const uint16_t RatesHz[] = { 10, 100, 500, 1000 };
+	static const uint32_t StormSeconds = 10;
+	static const uint32_t WindowsPerSecond = 1000 / MOTION_COALESCE_WINDOW_MILLIS;
+
+	for (uint8_t r = 0; r < sizeof(RatesHz) / sizeof(RatesHz[0]); r++)
+	{
+		HalFakeReset();
+
+		Fixture Context;
+		CountingListener Listener;
+
+		CHECK(SetupFixture(Context, Listener));
+		Timebase::Setup();
+		Context.Sensor.Enable();
+		RunScheduler(Context.Base, 1);
+
+		const uint32_t PulsePeriodMillis = 1000 / RatesHz[r];
+		const uint32_t StartTransactions = HalFake.TwiTransactions;
+		uint32_t Passes = 0;
+
+		for (uint32_t i = 0; i < StormSeconds * 1000; i++)
+		{
+			if (i % PulsePeriodMillis == 0)
+			{
+				Pulse();
+			}
+
+			if (!Context.Base.execute())
+			{
+				Passes++;
+			}
+			HalFake.Millis++;
+		}
+
+		const uint32_t Transactions = HalFake.TwiTransactions - StartTransactions;
+
+		printf("Storm %4u Hz: %.1f sensor passes/s, %.1f manager wakes/s, %.1f TWI transactions/s.\n",
+			RatesHz[r], (double)Passes / StormSeconds, (double)Listener.Count / StormSeconds,
+			(double)Transactions / StormSeconds);
+
+		// Bounded by the coalescing window, not by the pulse rate.
+		CHECK(Context.Sensor.GetMotionEventCount() == StormSeconds * RatesHz[r]);
+		CHECK(Transactions == 0);
+		CHECK(Passes <= (StormSeconds * WindowsPerSecond) + 1);
+		CHECK(Listener.Count <= (StormSeconds * WindowsPerSecond) + 1);
+	}
+}
+
+// Runs one confirmation check from a parked (coarse) wake, observing the model every millisecond.
+// Returns the gyro on-time, charge is the model current above the listening accelerometer.
+static uint32_t RunGyroCheck(MPU6050Fixture& context, uint32_t& picoCoulombs)
+{
+	uint32_t OnMillis = 0;
+	bool SawFine = false;
+	picoCoulombs = 0;
+
+	Pulse();
+	for (uint32_t i = 0; i < 200; i++)
+	{
+		context.Base.execute();
+
+		const uint32_t NanoAmps = context.Device.GetSupplyNanoAmps();
+		if (NanoAmps > MPU6050Fixture::ActiveNanoAmps)
+		{
+			OnMillis++;
+			picoCoulombs += NanoAmps - MPU6050Fixture::ActiveNanoAmps;
+		}
+		SawFine |= Timebase::IsFine();
+
+		HalFake.Millis++;
+	}
+
+	// Fine time only for the check, the gyro back in standby.
+	CHECK(SawFine);
+	CHECK(!Timebase::IsFine());
+	CHECK(context.Device.Registers[FakeMPU6050::RegisterPowerManagement2] == 0x07);
+
+	return OnMillis;
+}
+
+static void TestGyroConfirmation()
+{
+	static const uint8_t RegisterGyroX = 0x43;
+	// 131 LSB per deg/s.
+	static const uint16_t ConfirmedRate = (GYRO_CONFIRMATION_THRESHOLD_DPS + 5) * 131;
+
+	MPU6050Fixture Context;
+	GyroConfirmation Confirmation(&Context.Base);
+	CountingListener Listener;
+
+	// Bias measured at rest, zero.
+	CHECK(SetupFixture(Context, Listener));
+	CHECK(Context.Sensor.SetupConfirmation(&Confirmation));
+	CHECK(Context.Device.Registers[FakeMPU6050::RegisterPowerManagement2] == 0x07);
+
+	// Parked.
+	Timebase::Setup();
+	Context.Sensor.Enable();
+	RunScheduler(Context.Base, 1);
+	CHECK(!Timebase::IsFine());
+
+	// Still: the wake is forwarded, no extra event.
+	uint32_t StillCharge = 0;
+	const uint32_t StillMillis = RunGyroCheck(Context, StillCharge);
+	CHECK(Listener.Count == 1);
+	CHECK(Context.Sensor.GetRotationEventCount() == 0);
+	CHECK(Context.Sensor.GetMotionEventCount() == 1);
+
+	// Start-up and 4 samples 2 ms apart, not stretched to coarse ticks.
+	CHECK(StillMillis >= 35 && StillMillis < 48);
+
+	// Rolling: confirmed on the first sample, weighs as an extra motion event.
+	Context.Device.Registers[RegisterGyroX] = ConfirmedRate >> 8;
+	Context.Device.Registers[RegisterGyroX + 1] = ConfirmedRate & 0xFF;
+
+	RunScheduler(Context.Base, MOTION_COALESCE_WINDOW_MILLIS);
+	uint32_t RollingCharge = 0;
+	const uint32_t RollingMillis = RunGyroCheck(Context, RollingCharge);
+	CHECK(Listener.Count == 3);
+	CHECK(Context.Sensor.GetRotationEventCount() == 1);
+	CHECK(Context.Sensor.GetMotionEventCount() == 3);
+	CHECK(RollingMillis >= 35 && RollingMillis < StillMillis);
+	CHECK(Context.Twi.GetErrorCount() == 0);
+
+	printf("Gyro check: still %u ms %u uC, rolling %u ms %u uC.\n",
+		(unsigned)StillMillis, (unsigned)(StillCharge / 1000000), (unsigned)RollingMillis, (unsigned)(RollingCharge / 1000000));
+}
+
+int main()
+{
+	RUN_TEST(TestSetup<MPU6050Fixture>);
+	RUN_TEST(TestSetupFailsWithoutDevice<MPU6050Fixture>);
+	RUN_TEST(TestWakeAndSleep<MPU6050Fixture>);
+	RUN_TEST(TestCoalesce<MPU6050Fixture>);
+	RUN_TEST(TestWakeRetriesOnBusError<MPU6050Fixture>);
+	RUN_TEST(TestGyroConfirmation);
+	RUN_TEST(TestVibrationStorm<MPU6050Fixture>);
+
+	RUN_TEST(TestSetup<LIS3DHFixture>);
+	RUN_TEST(TestSetupFailsWithoutDevice<LIS3DHFixture>);
+	RUN_TEST(TestWakeAndSleep<LIS3DHFixture>);
+	RUN_TEST(TestCoalesce<LIS3DHFixture>);
+	RUN_TEST(TestWakeRetriesOnBusError<LIS3DHFixture>);
+	RUN_TEST(TestVibrationStorm<LIS3DHFixture>);
+
+	return TEST_RESULT();
+}
+#endif
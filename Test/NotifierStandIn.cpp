@@ -0,0 +1,104 @@
+#if !defined(__AVR__)
+// Device stand-in for Tools/NotificationReceiver.py: the firmware's AlarmNotifier on the Linux HAL, with USART0 on a pseudo terminal.
+// Prints the pty path, plays a fixed sequence of alarm states in real time, then the USART awake time per notification.
+
+#define ALARM_NOTIFIER
+
+#include <TaskScheduler.h>
+
+#include "../Notification/AlarmNotifier.h"
+#include "PtyLink.h"
+
+static const uint8_t UsartBit = 1 << (uint8_t)PeripheralEnum::Usart0;
+
+class FixedBatteryMonitor : public IBatteryMonitor
+{
+public:
+	virtual uint16_t GetMilliVolts()
+	{
+		return 3900;
+	}
+};
+
+struct ScriptStep
+{
+	uint32_t Millis;
+	void (IAlarmOutput::*Play)();
+};
+
+// Four notifications: Armed, Alarm (early warning coalesced), NotArmed, Armed.
+// Armed and back to NotArmed within the window sends nothing.
+static const ScriptStep Script[] =
+{
+	{ 1000, &IAlarmOutput::PlayArmed },
+	{ 4000, &IAlarmOutput::PlayEarlyWarning },
+	{ 4500, &IAlarmOutput::PlayAlarm },
+	{ 8000, &IAlarmOutput::PlayNotArmed },
+	{ 11000, &IAlarmOutput::PlayArmed },
+	{ 11400, &IAlarmOutput::PlayNotArmed },
+	{ 14000, &IAlarmOutput::PlayArmed }
+};
+static const uint8_t ScriptSize = sizeof(Script) / sizeof(Script[0]);
+static const uint8_t Notifications = 4;
+
+int main()
+{
+	HalFakeReset();
+
+	Scheduler Base;
+	IMovementSensor Sensor;
+	FixedBatteryMonitor Battery;
+	AlarmNotifier Notifier(&Base);
+
+	if (!Notifier.Setup(&Sensor, &Battery))
+	{
+		fprintf(stderr, "Setup failed.\n");
+
+		return 1;
+	}
+	Timebase::Setup();
+
+	PtyLink Link;
+	if (!Link.Open())
+	{
+		return 1;
+	}
+
+	uint8_t Step = 0;
+	uint32_t AwakeMillis = 0;
+
+	// Until the script is done and the last frame is acked or dropped.
+	while (Step < ScriptSize || Base.timeUntilNextIteration() >= 0)
+	{
+		uint8_t Buffer[HalFakeUsartBufferSize];
+		const ssize_t Count = Link.Read(Buffer, sizeof(Buffer));
+
+		for (ssize_t i = 0; i < Count; i++)
+		{
+			HalFakeWriteUsart(Buffer[i]);
+		}
+
+		if (Step < ScriptSize && HalFake.Millis >= Script[Step].Millis)
+		{
+			(Notifier.*Script[Step].Play)();
+			Step++;
+		}
+
+		const uint32_t Start = HalFake.Millis;
+		const bool Awake = (HalFake.PoweredMask & UsartBit) != 0;
+		Link.Run(Base);
+		HalFakeRunInterrupts();
+		Link.Flush();
+
+		if (Awake)
+		{
+			AwakeMillis += HalFake.Millis - Start;
+		}
+	}
+
+	printf("Sent %u, dropped %u. USART awake %u ms, %u ms per notification.\n",
+		Notifier.GetSentCount(), Notifier.GetDroppedCount(), (unsigned)AwakeMillis, (unsigned)(AwakeMillis / Notifications));
+
+	return Notifier.GetSentCount() == Notifications ? 0 : 1;
+}
+#endif
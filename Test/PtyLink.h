@@ -0,0 +1,123 @@
+// PtyLink.h
+
+#ifndef _PTYLINK_h
+#define _PTYLINK_h
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <TaskSchedulerDeclarations.h>
+
+#include "../Hal/Hal.h"
+
+// USART0 of the Linux HAL on a pseudo terminal, for the host stand-ins. Runs in real time.
+class PtyLink
+{
+private:
+	int Master = -1;
+	int Slave = -1;
+	uint32_t StartMillis = 0;
+
+	static const uint8_t BitsPerByte = 10;
+	uint32_t FlushMillis = 0;
+	uint32_t BitCredit = 0;
+
+public:
+	// Prints the pty path on stdout.
+	bool Open()
+	{
+		Master = posix_openpt(O_RDWR | O_NOCTTY);
+		if (Master < 0 || grantpt(Master) != 0 || unlockpt(Master) != 0)
+		{
+			perror("posix_openpt");
+
+			return false;
+		}
+
+		// Held open, so the pty survives clients coming and going. Raw, bytes pass unchanged.
+		Slave = open(ptsname(Master), O_RDWR | O_NOCTTY);
+		struct termios Attributes;
+		if (Slave < 0 || tcgetattr(Slave, &Attributes) != 0)
+		{
+			perror("ptsname");
+
+			return false;
+		}
+		cfmakeraw(&Attributes);
+		tcsetattr(Slave, TCSANOW, &Attributes);
+
+		printf("%s\n", ptsname(Master));
+		fflush(stdout);
+
+		StartMillis = GetWallMillis();
+
+		return true;
+	}
+
+	// Waits up to a millisecond for bytes from the client.
+	ssize_t Read(uint8_t* buffer, const size_t size)
+	{
+		struct pollfd Request = { Master, POLLIN, 0 };
+
+		if (poll(&Request, 1, 1) > 0 && (Request.revents & POLLIN))
+		{
+			return read(Master, buffer, size);
+		}
+
+		return 0;
+	}
+
+	// Sends what the USART transmitted, paced at its baud rate, 10 bits a byte.
+	// The USART model takes bytes at once, so the line time is spent here.
+	void Flush()
+	{
+		BitCredit += ((HalFake.Millis - FlushMillis) * HalFake.UsartBaudRate) / 1000;
+		FlushMillis = HalFake.Millis;
+
+		uint8_t Value;
+		while (BitCredit >= BitsPerByte && HalFakeReadUsart(Value))
+		{
+			BitCredit -= BitsPerByte;
+			if (write(Master, &Value, 1) != 1)
+			{
+				break;
+			}
+		}
+
+		// An idle line saves no time for the next burst.
+		if (HalFake.UsartTxCount == 0)
+		{
+			BitCredit = 0;
+		}
+	}
+
+	// Simulated time follows the wall clock, one scheduler pass per millisecond.
+	void Run(Scheduler& scheduler)
+	{
+		const uint32_t Now = GetWallMillis() - StartMillis;
+
+		do
+		{
+			scheduler.execute();
+			if (HalFake.Millis < Now)
+			{
+				HalFake.Millis++;
+			}
+		} while (HalFake.Millis < Now);
+	}
+
+private:
+	static uint32_t GetWallMillis()
+	{
+		struct timespec Now;
+		clock_gettime(CLOCK_MONOTONIC, &Now);
+
+		return (uint32_t)((Now.tv_sec * 1000UL) + (Now.tv_nsec / 1000000UL));
+	}
+};
+#endif
@@ -0,0 +1,51 @@
+// Test.h
+
+#ifndef _TEST_h
+#define _TEST_h
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <TaskSchedulerDeclarations.h>
+
+#include "../Hal/Linux/HalFake.h"
+
+// Minimal host test harness, one binary per module.
+// CHECK reports and counts failures, RUN_TEST resets the simulated hardware first.
+
+static uint16_t TestFailures = 0;
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			TestFailures++; \
+		} \
+	} while (0)
+
+#define RUN_TEST(test) \
+	do \
+	{ \
+		const uint16_t Failures = TestFailures; \
+		HalFakeReset(); \
+		test(); \
+		printf("%s %s\n", TestFailures == Failures ? "PASS" : "FAIL", #test); \
+	} while (0)
+
+#define TEST_RESULT() (TestFailures == 0 ? 0 : 1)
+
+// Runs the scheduler for the given simulated time, one pass per millisecond, taking interrupts on each pass.
+static inline void RunScheduler(Scheduler& scheduler, const uint32_t millis)
+{
+	for (uint32_t i = 0; i <= millis; i++)
+	{
+		scheduler.execute();
+		if (i < millis)
+		{
+			HalFake.Millis++;
+		}
+	}
+}
+#endif
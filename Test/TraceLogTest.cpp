@@ -0,0 +1,180 @@
+#if !defined(__AVR__)
+// TraceLog records on the USART model: encoding, drain from the TX interrupt, overflow and flush.
+// With a path argument, also writes one record of each message there for the decoder check (make TraceDecoderTest).
+
+#define DEBUG_LOG
+
+#include "Test.h"
+
+#include <TaskScheduler.h>
+
+#include "../Hal/Hal.h"
+#include "../Diagnostics/TraceLog.h"
+
+// Takes everything sent on TX, returns the byte count.
+static uint16_t ReadSent(uint8_t* buffer, const uint16_t capacity)
+{
+	uint16_t Size = 0;
+	uint8_t Value;
+
+	while (HalFakeReadUsart(Value))
+	{
+		if (Size < capacity)
+		{
+			buffer[Size] = Value;
+		}
+		Size++;
+	}
+
+	return Size;
+}
+
+static void TestRecordEncoding()
+{
+	uint8_t Sent[32];
+
+	TraceLog::Setup(115200);
+	CHECK(HalFake.UsartEnabled && !HalFake.UsartReceiving);
+	CHECK(HalFake.UsartBaudRate == 115200);
+
+	HalFake.Millis = 0x01020304;
+	TraceLog::Write<TraceEnum::AlarmState>((uint32_t)1200, (uint8_t)3);
+
+	// Only queued, the interrupt sends it.
+	CHECK(HalFake.UsartTxCount == 0);
+	CHECK(HalFake.UsartTransmitInterruptEnabled);
+	HalFakeRunInterrupts();
+	CHECK(!HalFake.UsartTransmitInterruptEnabled);
+
+	const uint8_t Expected[] = { TraceLog::Sync, (uint8_t)TraceEnum::AlarmState, 9,
+		0x04, 0x03, 0x02, 0x01,
+		0xB0, 0x04, 0x00, 0x00,
+		0x03 };
+	CHECK(ReadSent(Sent, sizeof(Sent)) == sizeof(Expected));
+	CHECK(memcmp(Sent, Expected, sizeof(Expected)) == 0);
+}
+
+static void TestFormatWidths()
+{
+	CHECK(TraceFormatSize("No arguments.") == 0);
+	CHECK(TraceFormatSize("100%% %hhu") == 1);
+	CHECK(TraceFormatSize("%02hhX %hd %lu %u") == 9);
+	CHECK(TraceFormatSize(TraceFormats[(uint8_t)TraceEnum::EventLatency]) == 3);
+	CHECK(TraceFormatSize(TraceFormats[(uint8_t)TraceEnum::SensorOffsets]) == 6);
+}
+
+static void TestOverflow()
+{
+	uint8_t Sent[128];
+
+	TraceLog::Setup(115200);
+
+	// Eleven 7 byte records fill the ring, the interrupt never runs meanwhile.
+	for (uint8_t i = 0; i < 12; i++)
+	{
+		TraceLog::Write<TraceEnum::MemoryWarning>();
+	}
+	TraceLog::Write<TraceEnum::EscalationRung>((uint8_t)2);
+	HalFakeRunInterrupts();
+	CHECK(ReadSent(Sent, sizeof(Sent)) == 9 * 7);
+
+	// Drop count comes first once there is room.
+	TraceLog::Write<TraceEnum::EscalationRung>((uint8_t)4);
+	HalFakeRunInterrupts();
+	CHECK(ReadSent(Sent, sizeof(Sent)) == 9 + 8);
+	CHECK(Sent[1] == (uint8_t)TraceEnum::Overflow && Sent[2] == 6);
+	CHECK(Sent[7] == 4 && Sent[8] == 0);
+	CHECK(Sent[10] == (uint8_t)TraceEnum::EscalationRung && Sent[16] == 4);
+
+	// Then back to normal.
+	TraceLog::Write<TraceEnum::MemoryWarning>();
+	HalFakeRunInterrupts();
+	CHECK(ReadSent(Sent, sizeof(Sent)) == 7);
+}
+
+static void TestFlush()
+{
+	uint8_t Sent[64];
+
+	TraceLog::Setup(115200);
+	TraceLog::Write<TraceEnum::Battery>((uint16_t)3900, (uint8_t)200);
+	TraceLog::Write<TraceEnum::AlarmStart>();
+
+	TraceLog::Flush();
+	CHECK(!HalFake.UsartTransmitInterruptEnabled);
+	CHECK(ReadSent(Sent, sizeof(Sent)) == 10 + 7);
+}
+
+// Sent bytes to the capture, the TX model holds the transmitter while full.
+static void Flush(FILE* capture)
+{
+	uint8_t Value;
+
+	TraceLog::Flush();
+	while (HalFakeReadUsart(Value))
+	{
+		fputc(Value, capture);
+	}
+}
+
+// One record of each message, as the firmware call sites pass them.
+static bool WriteCapture(const char* path)
+{
+	FILE* Capture = fopen(path, "wb");
+	if (Capture == nullptr)
+	{
+		return false;
+	}
+
+	// Line noise before the first record.
+	fputc(0x00, Capture);
+	fputc(TraceLog::Sync, Capture);
+
+	HalFakeReset();
+	TraceLog::Setup(115200);
+
+	// Overflows the ring.
+	for (uint8_t i = 0; i < 13; i++)
+	{
+		TraceLog::Write<TraceEnum::BuzzerGeneric>();
+	}
+	Flush(Capture);
+
+	HalFake.Millis = 1000;
+	TraceLog::Write<TraceEnum::AlarmStart>();
+	TraceLog::Write<TraceEnum::AlarmState>((uint32_t)4000000000UL, (uint8_t)7);
+	TraceLog::Write<TraceEnum::EscalationRung>((uint8_t)3);
+	Flush(Capture);
+	TraceLog::Write<TraceEnum::ResumingRung>((uint8_t)2);
+	TraceLog::Write<TraceEnum::MemoryStatus>((uint16_t)412, (uint16_t)65000);
+	TraceLog::Write<TraceEnum::MemoryWarning>();
+	TraceLog::Write<TraceEnum::BuzzerError>();
+	Flush(Capture);
+	TraceLog::Write<TraceEnum::BuzzerArmed>();
+	TraceLog::Write<TraceEnum::BuzzerNotArmed>();
+	TraceLog::Write<TraceEnum::BuzzerEarlyWarning>();
+	TraceLog::Write<TraceEnum::Battery>((uint16_t)3712, (uint8_t)255);
+	Flush(Capture);
+	TraceLog::Write<TraceEnum::SensorRegister>((uint8_t)0x6B, (uint8_t)0x09, (uint8_t)0x0A);
+	TraceLog::Write<TraceEnum::SensorOffsets>((int16_t)-502, (int16_t)-185, (int16_t)1162);
+	TraceLog::Write<TraceEnum::EventLatency>((uint8_t)5, (uint16_t)48);
+	Flush(Capture);
+
+	return fclose(Capture) == 0;
+}
+
+int main(int argc, char** argv)
+{
+	RUN_TEST(TestRecordEncoding);
+	RUN_TEST(TestFormatWidths);
+	RUN_TEST(TestOverflow);
+	RUN_TEST(TestFlush);
+
+	if (argc > 1)
+	{
+		CHECK(WriteCapture(argv[1]));
+	}
+
+	return TEST_RESULT();
+}
+#endif
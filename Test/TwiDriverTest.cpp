@@ -0,0 +1,342 @@
+#if !defined(__AVR__)
+// TwiDriver against the TWI peripheral model: queue, completion from the task, error paths.
+
+#include "Test.h"
+
+#include <TaskScheduler.h>
+
+#include "../Hal/Hal.h"
+#include "../Hal/Linux/FakeMPU6050.h"
+#include "../Twi/TwiDriver.h"
+
+static const uint8_t Address = 0x68;
+static const uint8_t MissingAddress = 0x50;
+
+class RecordingListener : public ITwiListener
+{
+public:
+	static const uint8_t Capacity = 16;
+
+	uint8_t Tokens[Capacity];
+	bool Results[Capacity];
+	uint8_t Count = 0;
+	bool CalledFromInterrupt = false;
+
+	TwiDriver* Requeue = nullptr;
+	uint8_t RequeueValue = 0;
+
+	virtual void OnTwiComplete(const uint8_t token, const bool success)
+	{
+		CalledFromInterrupt |= HalFake.InterruptsDisabled;
+
+		if (Count < Capacity)
+		{
+			Tokens[Count] = token;
+			Results[Count] = success;
+		}
+		Count++;
+
+		if (Requeue != nullptr)
+		{
+			Requeue->WriteRegister(Address, 0x10, RequeueValue);
+			Requeue = nullptr;
+		}
+	}
+};
+
+static void TestRoundTrip()
+{
+	Scheduler Base;
+	TwiDriver Twi(&Base);
+	FakeMPU6050 Device(Address);
+	RecordingListener Listener;
+	uint8_t WhoAmI = 0;
+
+	HalFakeAttachTwi(&Device);
+	CHECK(Twi.Setup());
+
+	CHECK(Twi.WriteRegister(Address, FakeMPU6050::RegisterPowerManagement1, 0x01, &Listener, 1));
+	CHECK(Twi.ReadRegisters(Address, FakeMPU6050::RegisterWhoAmI, &WhoAmI, 1, &Listener, 2));
+
+	// Nothing moves until the interrupt runs.
+	CHECK(!Twi.IsIdle());
+	CHECK(Device.Registers[FakeMPU6050::RegisterPowerManagement1] == 0x40);
+
+	HalFakeRunInterrupts();
+	CHECK(Twi.IsIdle());
+	CHECK(Device.Registers[FakeMPU6050::RegisterPowerManagement1] == 0x01);
+	CHECK(WhoAmI == 0x68);
+
+	// Completion is reported by the task, not from the interrupt.
+	CHECK(Listener.Count == 0);
+	Base.execute();
+	CHECK(Listener.Count == 2);
+	CHECK(Listener.Tokens[0] == 1 && Listener.Results[0]);
+	CHECK(Listener.Tokens[1] == 2 && Listener.Results[1]);
+	CHECK(!Listener.CalledFromInterrupt);
+	CHECK(Twi.GetErrorCount() == 0);
+	CHECK(HalFake.TwiTransactions == 2);
+
+	// Task goes idle with the queue.
+	CHECK(Base.timeUntilNextIteration() < 0);
+}
+
+static void TestBurst()
+{
+	Scheduler Base;
+	TwiDriver Twi(&Base);
+	FakeMPU6050 Device(Address);
+	uint8_t Data[3] = { 0x11, 0x22, 0x33 };
+	uint8_t Buffer[3] = { 0, 0, 0 };
+
+	HalFakeAttachTwi(&Device);
+	Twi.Setup();
+
+	CHECK(Twi.WriteRegisters(Address, 0x20, Data, sizeof(Data)));
+	CHECK(Twi.ReadRegisters(Address, 0x20, Buffer, sizeof(Buffer)));
+	CHECK(Twi.Flush(10));
+
+	CHECK(Device.Registers[0x20] == 0x11 && Device.Registers[0x21] == 0x22 && Device.Registers[0x22] == 0x33);
+	CHECK(Buffer[0] == 0x11 && Buffer[1] == 0x22 && Buffer[2] == 0x33);
+	CHECK(HalFake.TwiBytes == 6);
+}
+
+static void TestQueueFreesSlotsWhenReported()
+{
+	Scheduler Base;
+	TwiDriver Twi(&Base);
+	FakeMPU6050 Device(Address);
+	RecordingListener Listener;
+
+	HalFakeAttachTwi(&Device);
+	Twi.Setup();
+
+	// One slot is kept empty.
+	CHECK(Twi.WriteRegister(Address, 0x10, 1, &Listener, 1));
+	CHECK(Twi.WriteRegister(Address, 0x11, 2, &Listener, 2));
+	CHECK(Twi.WriteRegister(Address, 0x12, 3, &Listener, 3));
+	CHECK(!Twi.WriteRegister(Address, 0x13, 4, &Listener, 4));
+
+	// Done on the bus, but not reported yet.
+	HalFakeRunInterrupts();
+	CHECK(Twi.IsIdle());
+	CHECK(!Twi.WriteRegister(Address, 0x13, 4, &Listener, 4));
+
+	// The listener may queue the next request from its completion.
+	Listener.Requeue = &Twi;
+	Listener.RequeueValue = 5;
+	Base.execute();
+	CHECK(Listener.Count == 3);
+	CHECK(!Twi.IsIdle());
+
+	HalFakeRunInterrupts();
+	Base.execute();
+	CHECK(Device.Registers[0x10] == 5);
+	CHECK(Twi.WriteRegister(Address, 0x13, 4));
+}
+
+static void TestEnqueueWhileInFlight()
+{
+	Scheduler Base;
+	TwiDriver Twi(&Base);
+	FakeMPU6050 Device(Address);
+	RecordingListener Listener;
+	uint8_t WhoAmI = 0;
+
+	HalFakeAttachTwi(&Device);
+	Twi.Setup();
+
+	CHECK(Twi.WriteRegister(Address, 0x10, 0xA5, &Listener, 1));
+
+	// Part way through the first transaction.
+	CHECK(HalFakeRunInterrupts(2) == 2);
+	CHECK(Twi.ReadRegisters(Address, FakeMPU6050::RegisterWhoAmI, &WhoAmI, 1, &Listener, 2));
+
+	HalFakeRunInterrupts();
+	Base.execute();
+	CHECK(Listener.Count == 2);
+	CHECK(Listener.Tokens[0] == 1 && Listener.Tokens[1] == 2);
+	CHECK(Device.Registers[0x10] == 0xA5);
+	CHECK(WhoAmI == 0x68);
+}
+
+static void TestNackFailsOnlyThatTransaction()
+{
+	Scheduler Base;
+	TwiDriver Twi(&Base);
+	FakeMPU6050 Device(Address);
+	RecordingListener Listener;
+
+	HalFakeAttachTwi(&Device);
+	Twi.Setup();
+
+	CHECK(Twi.WriteRegister(MissingAddress, 0x10, 1, &Listener, 1));
+	CHECK(Twi.WriteRegister(Address, 0x10, 2, &Listener, 2));
+	HalFake.TwiFault = (uint8_t)HalFakeTwiFaultEnum::DataNack;
+	RunScheduler(Base, 1);
+
+	CHECK(Listener.Count == 2);
+	CHECK(Listener.Tokens[0] == 1 && !Listener.Results[0]);
+	CHECK(Listener.Tokens[1] == 2 && !Listener.Results[1]);
+
+	HalFake.TwiFault = (uint8_t)HalFakeTwiFaultEnum::ArbitrationLost;
+	CHECK(Twi.WriteRegister(Address, 0x10, 3, &Listener, 3));
+	CHECK(Twi.WriteRegister(Address, 0x11, 4, &Listener, 4));
+	RunScheduler(Base, 1);
+
+	CHECK(Listener.Count == 4);
+	CHECK(!Listener.Results[2]);
+	CHECK(Listener.Results[3]);
+	CHECK(Device.Registers[0x11] == 4);
+	CHECK(Twi.GetErrorCount() == 3);
+	CHECK(!Listener.CalledFromInterrupt);
+}
+
+static void TestBusErrorRecoversFromTask()
+{
+	Scheduler Base;
+	TwiDriver Twi(&Base);
+	FakeMPU6050 Device(Address);
+	RecordingListener Listener;
+
+	HalFakeAttachTwi(&Device);
+	Twi.Setup();
+
+	// Slave holds SDA low.
+	HalFakeSetPin(SDA, false);
+	HalFake.TwiFault = (uint8_t)HalFakeTwiFaultEnum::BusError;
+
+	CHECK(Twi.WriteRegister(Address, 0x10, 1, &Listener, 1));
+	CHECK(Twi.WriteRegister(Address, 0x11, 2, &Listener, 2));
+
+	// The interrupt only releases the hardware, no SCL clocking there.
+	const uint32_t PinWrites = HalFake.PinWrites;
+	HalFakeRunInterrupts();
+	CHECK(HalFake.PinWrites == PinWrites);
+	CHECK(!HalFake.TwiInterruptEnabled);
+	CHECK(!Twi.IsIdle());
+	CHECK(Listener.Count == 0);
+
+	// Task clocks SCL, fails the stuck transaction and starts the next.
+	Base.execute();
+	CHECK(HalFake.PinWrites - PinWrites >= 18);
+	CHECK(Listener.Count == 1);
+	CHECK(Listener.Tokens[0] == 1 && !Listener.Results[0]);
+	CHECK(HalFake.TwiEnabled);
+
+	HalFakeSetPin(SDA, true);
+	RunScheduler(Base, 1);
+	CHECK(Listener.Count == 2);
+	CHECK(Listener.Tokens[1] == 2 && Listener.Results[1]);
+	CHECK(Device.Registers[0x11] == 2);
+}
+
+static void TestStallTimesOut()
+{
+	Scheduler Base;
+	TwiDriver Twi(&Base);
+	FakeMPU6050 Device(Address);
+	RecordingListener Listener;
+
+	HalFakeAttachTwi(&Device);
+	HalFakeSetPin(SDA, true);
+	Twi.Setup();
+
+	// An output holds fine time.
+	Timebase::RequestFine(Timebase::ClientEnum::Light);
+
+	HalFake.TwiFault = (uint8_t)HalFakeTwiFaultEnum::Stall;
+	CHECK(Twi.WriteRegister(Address, 0x10, 1, &Listener, 1));
+	CHECK(Twi.WriteRegister(Address, 0x11, 2, &Listener, 2));
+
+	RunScheduler(Base, 4);
+	CHECK(Listener.Count == 0);
+
+	// 5 ms timeout.
+	RunScheduler(Base, 2);
+	CHECK(Listener.Count == 2);
+	CHECK(!Listener.Results[0]);
+	CHECK(Listener.Results[1]);
+	CHECK(Device.Registers[0x10] == 0 && Device.Registers[0x11] == 2);
+}
+
+static void TestCoarseTransferCrossesTick()
+{
+	Scheduler Base;
+	TwiDriver Twi(&Base);
+	FakeMPU6050 Device(Address);
+	RecordingListener Listener;
+
+	HalFakeAttachTwi(&Device);
+	HalFakeSetPin(SDA, true);
+	Twi.Setup();
+	Timebase::Setup();
+	CHECK(!Timebase::IsFine());
+
+	// Started just before a tick, finished just after it: one tick seen, a healthy transfer.
+	RunScheduler(Base, Timebase::CoarseTickMillis - 1);
+	HalFake.TwiHeldUntilMillis = HalFake.Millis + 3;
+	CHECK(Twi.WriteRegister(Address, 0x10, 1, &Listener, 1));
+
+	RunScheduler(Base, 4);
+	CHECK(Listener.Count == 1);
+	CHECK(Listener.Results[0]);
+	CHECK(Device.Registers[0x10] == 1);
+	CHECK(Twi.GetErrorCount() == 0);
+
+	// A stall still times out, within two ticks and a pass.
+	HalFake.TwiFault = (uint8_t)HalFakeTwiFaultEnum::Stall;
+	CHECK(Twi.WriteRegister(Address, 0x11, 2, &Listener, 2));
+
+	RunScheduler(Base, Timebase::CoarseTickMillis);
+	CHECK(Listener.Count == 1);
+
+	RunScheduler(Base, (2 * Timebase::CoarseTickMillis) + 1);
+	CHECK(Listener.Count == 2);
+	CHECK(!Listener.Results[1]);
+	CHECK(Twi.GetErrorCount() == 1);
+}
+
+static void TestFlush()
+{
+	Scheduler Base;
+	TwiDriver Twi(&Base);
+	FakeMPU6050 Device(Address);
+	RecordingListener Listener;
+
+	HalFakeAttachTwi(&Device);
+	HalFakeSetPin(SDA, true);
+	Twi.Setup();
+
+	// Reports completion before returning.
+	CHECK(Twi.WriteRegister(Address, 0x10, 1, &Listener, 1));
+	CHECK(Twi.Flush(10));
+	CHECK(Listener.Count == 1);
+
+	CHECK(Twi.WriteRegister(MissingAddress, 0x10, 1));
+	CHECK(!Twi.Flush(10));
+
+	HalFake.TwiFault = (uint8_t)HalFakeTwiFaultEnum::Stall;
+	const uint32_t Start = HalFake.Millis;
+	CHECK(Twi.WriteRegister(Address, 0x10, 1, &Listener, 2));
+	CHECK(!Twi.Flush(10));
+	CHECK(HalFake.Millis - Start > 10);
+	CHECK(Twi.IsIdle());
+	CHECK(Listener.Count == 2 && !Listener.Results[1]);
+}
+
+int main()
+{
+	RUN_TEST(TestRoundTrip);
+	RUN_TEST(TestBurst);
+	RUN_TEST(TestQueueFreesSlotsWhenReported);
+	RUN_TEST(TestEnqueueWhileInFlight);
+	RUN_TEST(TestNackFailsOnlyThatTransaction);
+	RUN_TEST(TestBusErrorRecoversFromTask);
+	RUN_TEST(TestStallTimesOut);
+	RUN_TEST(TestCoarseTransferCrossesTick);
+	RUN_TEST(TestFlush);
+
+	return TEST_RESULT();
+}
+#endif
@@ -0,0 +1,99 @@
+// ClockGovernor.h
+
+#ifndef _CLOCKGOVERNOR_h
+#define _CLOCKGOVERNOR_h
+
+#if !defined(__AVR__)
+#include "../Hal/Linux/LinuxClockGovernor.h"
+#else
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/power.h>
+#include <util/atomic.h>
+
+/* CPU clock scaling, 8 MHz while outputs animate, 1 MHz while parked.
+	Driven by Timebase: fast in fine resolution, slow in coarse resolution.
+	Clock dependent peripherals that run in both are retuned here (TWI bit rate),
+	or read the current clock (Timer2 coarse tick, ADC prescaler).
+	WS2812 and buzzer timing only run with fine resolution, always at full clock.
+	Users release fine resolution only after their last clock timed output, the pixel outputs refuse to send while slow.
+	The trace log baud rate needs a fixed clock, so the clock never slows with DEBUG_LOG. */
+class ClockGovernor
+{
+public:
+	static const uint32_t TwiClockSpeed = 400000;
+
+	// 1 MHz.
+	static const uint8_t SlowShift = 3;
+
+public:
+	static uint8_t GetShift()
+	{
+		return CLKPR & 0x0F;
+	}
+
+	static bool IsSlow()
+	{
+		return GetShift() != 0;
+	}
+
+	static uint32_t GetCpuHz()
+	{
+		return F_CPU >> GetShift();
+	}
+
+	static void SetFast()
+	{
+		if (!IsSlow())
+		{
+			return;
+		}
+
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			// Bus runs slower than requested until the clock is up, never faster.
+			SetTwiBitRate(F_CPU);
+			clock_prescale_set(clock_div_1);
+		}
+	}
+
+	static void SetSlow()
+	{
+#ifndef DEBUG_LOG
+		if (IsSlow())
+		{
+			return;
+		}
+
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			clock_prescale_set((clock_div_t)SlowShift);
+			SetTwiBitRate(F_CPU >> SlowShift);
+		}
+#endif
+	}
+
+	// TWBR for TwiClockSpeed, or the fastest rate below it.
+	static uint8_t GetTwiBitRate(const uint32_t cpuHz)
+	{
+		const uint32_t Divider = cpuHz / TwiClockSpeed;
+
+		if (Divider <= 16)
+		{
+			return 0;
+		}
+
+		return (Divider - 16) / 2;
+	}
+
+private:
+	static void SetTwiBitRate(const uint32_t cpuHz)
+	{
+		if (TWCR & _BV(TWEN))
+		{
+			TWBR = GetTwiBitRate(cpuHz);
+		}
+	}
+};
+#endif
+#endif
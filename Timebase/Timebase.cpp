@@ -0,0 +1,22 @@
+#if defined(__AVR__)
+#include "Timebase.h"
+
+volatile uint32_t Timebase::CoarseMillis = 0;
+uint8_t Timebase::FineRequests = 0;
+
+ISR(TIMER2_COMPA_vect)
+{
+	Timebase::OnCoarseTick();
+}
+
+// TaskScheduler time source, with _TASK_EXTERNAL_TIME.
+unsigned long external_millis()
+{
+	return Timebase::Millis();
+}
+
+unsigned long external_micros()
+{
+	return Timebase::Millis() * 1000;
+}
+#endif
@@ -0,0 +1,147 @@
+// Timebase.h
+
+#ifndef _TIMEBASE_h
+#define _TIMEBASE_h
+
+#if !defined(__AVR__)
+// Off-target builds run on simulated time.
+#include "../Hal/Linux/LinuxTimebase.h"
+#else
+#include <stdint.h>
+#include <Arduino.h>
+#include <util/atomic.h>
+
+#include "ClockGovernor.h"
+#include "../Hal/Hal.h"
+
+// Millisecond clock with two resolutions.
+// Fine: Arduino's Timer0 millis(), waking the CPU every ~1 ms.
+// Coarse: Timer0 overflow interrupt is masked and Timer2 ticks every 16 ms instead.
+// Coarse is used while parked, fine only while an output requests it for animation.
+// Millis() is continuous and monotonic across switches, so the millisecond semantics are kept.
+// The CPU clock follows, slow in coarse (see ClockGovernor). Timer0 is frozen then, only Timer2 is rescaled.
+class Timebase
+{
+public:
+	enum ClientEnum : uint8_t
+	{
+		Light = 1 << 0,
+		Buzzer = 1 << 1,
+		Diagnostics = 1 << 2,
+		AuxLight = 1 << 3,
+		Notifier = 1 << 4,
+		Gyro = 1 << 5
+	};
+
+	// 8 MHz / 1024 or 1 MHz / 128 = 128 us per count, 125 counts = 16 ms.
+	static const uint8_t CoarseTickCounts = 125;
+	static const uint8_t CoarseTickMillis = 16;
+
+private:
+	// Milliseconds accumulated while Timer0 millis() was frozen.
+	static volatile uint32_t CoarseMillis;
+
+	static uint8_t FineRequests;
+
+public:
+	// Outputs may already have requested fine resolution during construction.
+	static void Setup()
+	{
+		if (FineRequests == 0)
+		{
+			EnterCoarse();
+		}
+	}
+
+	static uint32_t Millis()
+	{
+		uint32_t Coarse;
+
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			Coarse = CoarseMillis;
+		}
+
+		return millis() + Coarse;
+	}
+
+	static bool IsFine()
+	{
+		return FineRequests != 0;
+	}
+
+	static void RequestFine(const ClientEnum client)
+	{
+		if (FineRequests == 0)
+		{
+			EnterFine();
+		}
+		FineRequests |= client;
+	}
+
+	static void ReleaseFine(const ClientEnum client)
+	{
+		if (FineRequests != 0)
+		{
+			FineRequests &= ~client;
+			if (FineRequests == 0)
+			{
+				EnterCoarse();
+			}
+		}
+	}
+
+	static void OnCoarseTick()
+	{
+		CoarseMillis += CoarseTickMillis;
+	}
+
+private:
+	static void EnterCoarse()
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			// Freeze millis().
+			TIMSK0 &= ~_BV(TOIE0);
+
+			ClockGovernor::SetSlow();
+
+			HalPower::Enable(PeripheralEnum::Timer2);
+			TCCR2A = _BV(WGM21); // CTC.
+			if (ClockGovernor::IsSlow())
+			{
+				static_assert(ClockGovernor::SlowShift == 3, "Coarse tick prescaler assumes 1 MHz.");
+				TCCR2B = _BV(CS22) | _BV(CS20); // Prescaler 128.
+			}
+			else
+			{
+				TCCR2B = _BV(CS22) | _BV(CS21) | _BV(CS20); // Prescaler 1024.
+			}
+			OCR2A = CoarseTickCounts - 1;
+			TCNT2 = 0;
+			TIFR2 = _BV(OCF2A);
+			TIMSK2 = _BV(OCIE2A);
+		}
+	}
+
+	static void EnterFine()
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			// Keep the partial coarse tick.
+			CoarseMillis += ((uint16_t)TCNT2 * CoarseTickMillis) / CoarseTickCounts;
+
+			TIMSK2 = 0;
+			TCCR2B = 0;
+			HalPower::Disable(PeripheralEnum::Timer2);
+
+			ClockGovernor::SetFast();
+
+			// Drop the overflow that happened while masked, then resume millis().
+			TIFR0 = _BV(TOV0);
+			TIMSK0 |= _BV(TOIE0);
+		}
+	}
+};
+#endif
+#endif
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+# DiagnosticClient.py
+#
+# Host side of the DiagnosticPort protocol (see Diagnostics/DiagnosticPort.h), Linux only.
+# Talks to the device on a serial adapter, or to the pty printed by Test/build/DiagnosticStandIn.
+#	DiagnosticClient.py /dev/ttyUSB0 ping state counters config log latency:4 scheduling:0
+
+import argparse
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+REQUEST_SYNC = 0xA5
+RESPONSE_SYNC = 0x5A
+ERROR_FLAG = 0x80
+BAUD_RATE = termios.B38400
+
+# Command, default argument and payload layout, little-endian.
+COMMANDS = {
+	'ping': (0x01, '<B', ('Version',)),
+	'state': (0x02, '<BIBB', ('State', 'StateElapsed', 'MemoryWarning', 'EscalationRung')),
+	'counters': (0x03, '<IHHHHHH', ('Uptime', 'MotionEvents', 'FreeRam', 'StackHeadroom', 'BatteryMilliVolts', 'Requests', 'RotationEvents')),
+	'config': (0x04, '<hhhBB', ('XOffset', 'YOffset', 'ZOffset', 'MotionThreshold', 'MotionDuration')),
+	'log': (0x05, '<BBH', ('Code', 'State', 'Value')),
+	'latency': (0x06, '<H', ('MaxLatencyMillis',)),
+	'scheduling': (0x07, '<8H', tuple('Bucket%u' % i for i in range(8))),
+}
+
+LOG_CAPACITY = 32
+
+
+class DiagnosticError(Exception):
+	pass
+
+
+class DiagnosticPort:
+	def __init__(self, path, timeout=0.5):
+		self.Timeout = timeout
+		self.Fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+		tty.setraw(self.Fd)
+		attributes = termios.tcgetattr(self.Fd)
+		attributes[4] = attributes[5] = BAUD_RATE
+		termios.tcsetattr(self.Fd, termios.TCSANOW, attributes)
+
+	def close(self):
+		os.close(self.Fd)
+
+	# The port sleeps until RX goes low. A pty carries no break, a NUL byte wakes it too.
+	def wake(self):
+		try:
+			termios.tcsendbreak(self.Fd, 0)
+		except termios.error:
+			pass
+		os.write(self.Fd, b'\x00')
+		time.sleep(0.02)
+		termios.tcflush(self.Fd, termios.TCIFLUSH)
+
+	def request(self, command, argument=0):
+		frame = bytes((REQUEST_SYNC, command, argument, REQUEST_SYNC ^ command ^ argument))
+		os.write(self.Fd, frame)
+
+		deadline = time.monotonic() + self.Timeout
+		while self._read(1, deadline)[0] != RESPONSE_SYNC:
+			pass
+		header = bytes((RESPONSE_SYNC,)) + self._read(2, deadline)
+		body = self._read(header[2] + 1, deadline)
+
+		checksum = 0
+		for value in header + body[:-1]:
+			checksum ^= value
+		if checksum != body[-1]:
+			raise DiagnosticError('checksum mismatch')
+		if header[1] == (command | ERROR_FLAG):
+			return None
+		if header[1] != command:
+			raise DiagnosticError('response to 0x%02X, expected 0x%02X' % (header[1], command))
+
+		return body[:-1]
+
+	def _read(self, count, deadline):
+		data = b''
+		while len(data) < count:
+			remaining = deadline - time.monotonic()
+			if remaining <= 0 or not select.select([self.Fd], [], [], remaining)[0]:
+				raise DiagnosticError('no response')
+			data += os.read(self.Fd, count - len(data))
+
+		return data
+
+
+def decode(name, payload):
+	layout, fields = COMMANDS[name][1], COMMANDS[name][2]
+
+	return dict(zip(fields, struct.unpack(layout, payload)))
+
+
+def run(port, query):
+	name, _, argument = query.partition(':')
+	if name not in COMMANDS:
+		raise DiagnosticError('unknown command ' + name)
+	command = COMMANDS[name][0]
+
+	if name == 'log' and argument == '':
+		# Whole log, oldest first, erased entries are skipped.
+		for index in range(LOG_CAPACITY):
+			payload = port.request(command, index)
+			if payload is not None:
+				print('log[%u]' % index, decode(name, payload))
+		return
+
+	payload = port.request(command, int(argument or '0', 0))
+	print(query, 'failed' if payload is None else decode(name, payload))
+
+
+def main():
+	parser = argparse.ArgumentParser(description='DiagnosticPort client.')
+	parser.add_argument('device', help='serial device or pty')
+	parser.add_argument('queries', nargs='+', help='command[:argument], one of ' + ', '.join(COMMANDS))
+	arguments = parser.parse_args()
+
+	port = DiagnosticPort(arguments.device)
+	try:
+		port.wake()
+		for query in arguments.queries:
+			run(port, query)
+	except DiagnosticError as error:
+		print('error:', error, file=sys.stderr)
+		return 1
+	finally:
+		port.close()
+
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
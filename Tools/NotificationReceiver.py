@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+# NotificationReceiver.py
+#
+# GSM/LoRa module stand-in for the AlarmNotifier frames (see Notification/AlarmNotifier.h), Linux only.
+# Reads frames from a serial adapter, or from the pty printed by Test/build/NotifierStandIn, checks and acks them.
+#	NotificationReceiver.py /dev/ttyUSB0
+#	NotificationReceiver.py --ignore 1 --count 4 /dev/pts/3
+
+import argparse
+import os
+import select
+import struct
+import sys
+import termios
+import tty
+
+SYNC = 0xC3
+ACK_SYNC = 0x3C
+FRAME_SIZE = 11
+BAUD_RATE = termios.B9600
+
+EVENTS = {
+	1: 'Error',
+	2: 'NotArmed',
+	3: 'ArmingFailed',
+	4: 'Armed',
+	5: 'EarlyWarning',
+	6: 'Alarm',
+}
+
+
+def open_port(path):
+	fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+	tty.setraw(fd)
+	attributes = termios.tcgetattr(fd)
+	attributes[4] = attributes[5] = BAUD_RATE
+	termios.tcsetattr(fd, termios.TCSANOW, attributes)
+
+	return fd
+
+
+def read_frames(fd):
+	frame = bytearray()
+
+	while True:
+		readable, _, _ = select.select([fd], [], [])
+		if not readable:
+			continue
+
+		for value in os.read(fd, 64):
+			# Line noise between frames is skipped.
+			if not frame and value != SYNC:
+				continue
+
+			frame.append(value)
+			if len(frame) == FRAME_SIZE:
+				yield bytes(frame)
+				frame = bytearray()
+
+
+def checksum(frame):
+	value = 0
+	for byte in frame[:-1]:
+		value ^= byte
+
+	return value
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Receives and acks AlarmNotifier frames.')
+	parser.add_argument('port', help='serial device or pty')
+	parser.add_argument('--ignore', type=int, default=0, help='leave the first frames unacked, to see the retries')
+	parser.add_argument('--count', type=int, default=0, help='exit after this many notifications, 0 runs forever')
+	arguments = parser.parse_args()
+
+	fd = open_port(arguments.port)
+	ignored = 0
+	notifications = set()
+
+	for frame in read_frames(fd):
+		_, sequence, event, timestamp, density, milliVolts, check = struct.unpack('<BBBIBHB', frame)
+
+		if check != checksum(frame):
+			print('Checksum error: %s' % frame.hex(' '))
+			continue
+
+		acked = ignored >= arguments.ignore
+		print('#%u %s at %u ms, %u motion/min, %u mV%s' % (sequence, EVENTS.get(event, 'Event%u' % event),
+			timestamp, density, milliVolts, '' if acked else ', not acked'))
+		sys.stdout.flush()
+
+		if not acked:
+			ignored += 1
+			continue
+
+		os.write(fd, bytes((ACK_SYNC, sequence)))
+
+		# Retries of an acked frame, whose ack was lost, are not new.
+		notifications.add(sequence)
+		if arguments.count and len(notifications) >= arguments.count:
+			break
+
+	os.close(fd)
+
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+# TraceDecoder.py
+#
+# Host side of TraceLog (see Diagnostics/TraceLog.h): turns binary trace records back into text.
+# Format strings are read from the TRACE_MESSAGES list in TraceLog.h, IDs are their positions.
+#	TraceDecoder.py /dev/ttyUSB0		live, at 115200 baud.
+#	TraceDecoder.py capture.bin		recorded stream.
+
+import argparse
+import os
+import re
+import stat
+import struct
+import sys
+import termios
+import tty
+
+SYNC = 0x7E
+HEADER_SIZE = 3
+TIMESTAMP_SIZE = 4
+
+HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'Diagnostics', 'TraceLog.h')
+
+BAUD_RATES = {9600: termios.B9600, 38400: termios.B38400, 57600: termios.B57600, 115200: termios.B115200}
+
+MESSAGE = re.compile(r'X\((\w+),\s*"((?:[^"\\]|\\.)*)"\)')
+CONVERSION = re.compile(r'%([-+ #0-9]*)(hh|h|l)?([diuxXc%])')
+
+# Bytes per length modifier, plain int is 2 as on AVR.
+WIDTHS = {'hh': 1, 'h': 2, 'l': 4, None: 2}
+
+
+class Message:
+	def __init__(self, name, format):
+		self.Name = name
+		self.Format = format
+		self.Fields = []
+		for match in CONVERSION.finditer(format):
+			if match.group(3) == '%':
+				continue
+			width = WIDTHS[match.group(2)]
+			signed = match.group(3) in 'di'
+			self.Fields.append({1: 'bB', 2: 'hH', 4: 'iI'}[width][0 if signed else 1])
+		self.Layout = '<' + ''.join(self.Fields)
+		# Python has no length modifiers.
+		self.Text = CONVERSION.sub(lambda match: '%' + match.group(1) + match.group(3), format)
+
+	def decode(self, arguments):
+		if len(arguments) != struct.calcsize(self.Layout):
+			return '%s: %u argument bytes, format expects %u: %s' % (
+				self.Name, len(arguments), struct.calcsize(self.Layout), arguments.hex())
+
+		return self.Text % struct.unpack(self.Layout, arguments)
+
+
+def load_messages(path):
+	with open(path) as header:
+		source = header.read()
+
+	start = source.index('#define TRACE_MESSAGES(X)')
+	end = source.index('\n\n', start)
+
+	return [Message(name, format.encode().decode('unicode_escape'))
+		for name, format in MESSAGE.findall(source[start:end])]
+
+
+def decode(stream, messages, output):
+	buffer = b''
+
+	for chunk in stream:
+		buffer += chunk
+
+		while True:
+			# Resynchronize on the next sync byte with a known ID.
+			start = buffer.find(bytes((SYNC,)))
+			if start < 0:
+				buffer = b''
+				break
+			buffer = buffer[start:]
+			if len(buffer) < HEADER_SIZE:
+				break
+
+			id, length = buffer[1], buffer[2]
+			if id >= len(messages) or length < TIMESTAMP_SIZE:
+				buffer = buffer[1:]
+				continue
+			if len(buffer) < HEADER_SIZE + length:
+				break
+
+			record = buffer[HEADER_SIZE:HEADER_SIZE + length]
+			buffer = buffer[HEADER_SIZE + length:]
+
+			millis = struct.unpack('<I', record[:TIMESTAMP_SIZE])[0]
+			output.write('%10u %s\n' % (millis, messages[id].decode(record[TIMESTAMP_SIZE:])))
+			output.flush()
+
+
+def read_chunks(fd):
+	while True:
+		chunk = os.read(fd, 256)
+		if not chunk:
+			return
+		yield chunk
+
+
+def main():
+	parser = argparse.ArgumentParser(description='TraceLog decoder.')
+	parser.add_argument('source', help='serial device, or a file with the recorded stream')
+	parser.add_argument('--baud', type=int, default=115200, choices=sorted(BAUD_RATES), help='serial baud rate')
+	parser.add_argument('--header', default=HEADER, help='TraceLog.h with the message list')
+	arguments = parser.parse_args()
+
+	messages = load_messages(arguments.header)
+
+	fd = os.open(arguments.source, os.O_RDONLY | os.O_NOCTTY)
+	if stat.S_ISCHR(os.fstat(fd).st_mode) and os.isatty(fd):
+		tty.setraw(fd)
+		attributes = termios.tcgetattr(fd)
+		attributes[4] = attributes[5] = BAUD_RATES[arguments.baud]
+		termios.tcsetattr(fd, termios.TCSANOW, attributes)
+
+	try:
+		decode(read_chunks(fd), messages, sys.stdout)
+	except KeyboardInterrupt:
+		pass
+	finally:
+		os.close(fd)
+
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
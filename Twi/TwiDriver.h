@@ -0,0 +1,423 @@
+// TwiDriver.h
+
+#ifndef _TWIDRIVER_h
+#define _TWIDRIVER_h
+
+#define _TASK_OO_CALLBACKS
+#include <TaskSchedulerDeclarations.h>
+
+#include <Arduino.h>
+
+#include "../ITwiListener.h"
+#include "../Timebase/Timebase.h"
+#include "../Hal/Hal.h"
+
+class TwiDriver;
+extern TwiDriver* StaticTwiDriverReference;
+
+/* Interrupt driven I2C master, replaces the blocking Wire library.
+	Register transactions are queued and run from the TWI interrupt, the CPU is free (or idle sleeping) during transfers.
+	The interrupt only drives the bus, records the result and wakes the task.
+	The task reports completion to an ITwiListener, supervises the transaction timeout and recovers the bus on error. */
+class TwiDriver : Task
+{
+public:
+	static const uint32_t ClockSpeed = ClockGovernor::TwiClockSpeed;
+
+private:
+	static const uint32_t TimeoutMillis = 5;
+	// Coarse Millis() moves in 16 ms steps, two of them guarantee a full tick elapsed.
+	static const uint32_t CoarseTimeoutMillis = 2 * Timebase::CoarseTickMillis;
+	static const uint8_t QueueSize = 4;
+	static const uint8_t BusClearPulses = 9;
+
+	typedef FastPin<SDA> SdaPin;
+	typedef FastPin<SCL> SclPin;
+
+	struct Transaction
+	{
+		ITwiListener* Listener;
+		uint8_t* Data; // nullptr for inline Value.
+		uint8_t Address;
+		uint8_t Register;
+		uint8_t Length;
+		uint8_t Value; // Inline data for single byte writes.
+		uint8_t Token;
+		bool Read;
+		volatile bool Success;
+	};
+
+	enum PhaseEnum : uint8_t
+	{
+		Idle,
+		SendRegister,
+		WriteData,
+		ReadData
+	};
+
+	// Notified <= Head <= Tail, in ring order.
+	// [Head, Tail) is owned by the interrupt, [Notified, Head) waits for the task to report it.
+	Transaction Queue[QueueSize];
+	volatile uint8_t QueueHead = 0;
+	volatile uint8_t QueueTail = 0;
+	uint8_t QueueNotified = 0;
+
+	volatile PhaseEnum Phase = PhaseEnum::Idle;
+	volatile uint8_t DataIndex = 0;
+
+	// Set from the interrupt, handled by the task.
+	volatile bool RecoverPending = false;
+	volatile uint8_t StartCount = 0;
+
+	uint8_t SupervisedStart = 0;
+	uint32_t SupervisedMillis = 0;
+
+	volatile uint16_t ErrorCount = 0;
+
+public:
+	TwiDriver(Scheduler* scheduler)
+		: Task(0, TASK_FOREVER, scheduler, false)
+	{
+	}
+
+	bool Setup();
+
+	bool WriteRegister(const uint8_t address, const uint8_t reg, const uint8_t value,
+		ITwiListener* listener = nullptr, const uint8_t token = 0)
+	{
+		Transaction Entry;
+		Entry.Data = nullptr;
+		Entry.Value = value;
+
+		return Enqueue(Entry, address, reg, 1, false, listener, token);
+	}
+
+	// Data must remain valid until completion.
+	bool WriteRegisters(const uint8_t address, const uint8_t reg, uint8_t* data, const uint8_t length,
+		ITwiListener* listener = nullptr, const uint8_t token = 0)
+	{
+		Transaction Entry;
+		Entry.Data = data;
+
+		return Enqueue(Entry, address, reg, length, false, listener, token);
+	}
+
+	// Buffer must remain valid until completion.
+	bool ReadRegisters(const uint8_t address, const uint8_t reg, uint8_t* buffer, const uint8_t length,
+		ITwiListener* listener = nullptr, const uint8_t token = 0)
+	{
+		Transaction Entry;
+		Entry.Data = buffer;
+
+		return Enqueue(Entry, address, reg, length, true, listener, token);
+	}
+
+	// No transaction on the bus or waiting for it.
+	bool IsIdle()
+	{
+		return QueueHead == QueueTail;
+	}
+
+	uint16_t GetErrorCount()
+	{
+		return ErrorCount;
+	}
+
+	// Blocking wait for the queue to drain. Only for use during setup.
+	bool Flush(const uint32_t timeoutMillis)
+	{
+		const uint32_t Start = Timebase::Millis();
+		const uint16_t StartErrors = ErrorCount;
+
+		while (!IsIdle())
+		{
+			HalTwi::Poll();
+
+			if (RecoverPending)
+			{
+				Recover();
+			}
+			else if (Timebase::Millis() - Start > timeoutMillis)
+			{
+				Recover();
+				Notify();
+
+				return false;
+			}
+		}
+
+		Notify();
+
+		return ErrorCount == StartErrors;
+	}
+
+	bool Callback()
+	{
+		const uint32_t Now = Timebase::Millis();
+
+		// Restart the timeout on each new transaction.
+		const uint8_t Started = StartCount;
+		if (Started != SupervisedStart)
+		{
+			SupervisedStart = Started;
+			SupervisedMillis = Now;
+		}
+
+		if (RecoverPending || (!IsIdle() && (Now - SupervisedMillis >= GetTimeoutMillis())))
+		{
+			Recover();
+		}
+
+		Notify();
+
+		if (QueueNotified == QueueTail)
+		{
+			Task::disable();
+		}
+		else
+		{
+			// The interrupt wakes the task early on completion.
+			Task::delay(GetTimeoutMillis());
+		}
+
+		return true;
+	}
+
+	void OnInterrupt();
+
+private:
+	static void OnTwiInterrupt();
+
+	// Task context only.
+	bool Enqueue(Transaction& entry, const uint8_t address, const uint8_t reg, const uint8_t length, const bool read,
+		ITwiListener* listener, const uint8_t token)
+	{
+		const uint8_t Next = (QueueTail + 1) % QueueSize;
+
+		// Slots are free once reported.
+		if (Next == QueueNotified)
+		{
+			return false;
+		}
+
+		entry.Address = address;
+		entry.Register = reg;
+		entry.Length = length;
+		entry.Read = read;
+		entry.Listener = listener;
+		entry.Token = token;
+		entry.Success = false;
+
+		// Slot is written in full before it is published to the interrupt.
+		noInterrupts();
+		Transaction& Slot = Queue[QueueTail];
+		Slot = entry;
+		if (Slot.Data == nullptr)
+		{
+			Slot.Data = &Slot.Value;
+		}
+		const bool WasIdle = IsIdle();
+		QueueTail = Next;
+		if (WasIdle)
+		{
+			Start(false);
+			SupervisedStart = StartCount;
+			SupervisedMillis = Timebase::Millis();
+		}
+		interrupts();
+
+		if (!Task::isEnabled())
+		{
+			Task::enable();
+			Task::delay(GetTimeoutMillis());
+		}
+
+		return true;
+	}
+
+	static uint32_t GetTimeoutMillis()
+	{
+		return Timebase::IsFine() ? TimeoutMillis : CoarseTimeoutMillis;
+	}
+
+	// Reports finished transactions, in order.
+	void Notify()
+	{
+		while (QueueNotified != QueueHead)
+		{
+			const Transaction& Done = Queue[QueueNotified];
+			ITwiListener* Listener = Done.Listener;
+			const uint8_t Token = Done.Token;
+			const bool Success = Done.Success;
+
+			// Free the slot first, the listener may queue the next request.
+			QueueNotified = (QueueNotified + 1) % QueueSize;
+
+			if (Listener != nullptr)
+			{
+				Listener->OnTwiComplete(Token, Success);
+			}
+		}
+	}
+
+	// Interrupt context, or task with interrupts off.
+	void Start(const bool afterStop)
+	{
+		Phase = PhaseEnum::SendRegister;
+		DataIndex = 0;
+		StartCount++;
+
+		HalTwi::Start(afterStop);
+	}
+
+	// Interrupt context, or task with interrupts off.
+	// Completes the current transaction and starts the next one, if any.
+	void Complete(const bool success)
+	{
+		Queue[QueueHead].Success = success;
+		QueueHead = (QueueHead + 1) % QueueSize;
+
+		if (!success)
+		{
+			ErrorCount++;
+		}
+
+		if (IsIdle())
+		{
+			Phase = PhaseEnum::Idle;
+			HalTwi::Stop();
+		}
+		else
+		{
+			Start(true);
+		}
+
+		Task::forceNextIteration();
+	}
+
+	void Recover();
+};
+
+inline bool TwiDriver::Setup()
+{
+	StaticTwiDriverReference = this;
+
+	// Internal pull-ups, as Wire does.
+	SdaPin::SetInputPullup();
+	SclPin::SetInputPullup();
+
+	HalTwi::Attach(OnTwiInterrupt);
+	HalTwi::Enable(ClockGovernor::GetTwiBitRate(ClockGovernor::GetCpuHz()));
+
+	QueueHead = 0;
+	QueueTail = 0;
+	QueueNotified = 0;
+	Phase = PhaseEnum::Idle;
+	RecoverPending = false;
+
+	return true;
+}
+
+inline void TwiDriver::OnInterrupt()
+{
+	Transaction& Current = Queue[QueueHead];
+
+	switch ((TwiStatusEnum)HalTwi::GetStatus())
+	{
+	case TwiStatusEnum::Start:
+		HalTwi::Send(Current.Address << 1);
+		break;
+	case TwiStatusEnum::RepeatedStart:
+		HalTwi::Send((Current.Address << 1) | 0x01);
+		break;
+	case TwiStatusEnum::WriteAddressAck:
+		Phase = Current.Read ? PhaseEnum::ReadData : PhaseEnum::WriteData;
+		HalTwi::Send(Current.Register);
+		break;
+	case TwiStatusEnum::WriteDataAck:
+		if (Phase == PhaseEnum::ReadData)
+		{
+			// Register pointer set, restart for reading.
+			HalTwi::Start(false);
+		}
+		else if (DataIndex < Current.Length)
+		{
+			HalTwi::Send(Current.Data[DataIndex++]);
+		}
+		else
+		{
+			Complete(true);
+		}
+		break;
+	case TwiStatusEnum::ReadAddressAck:
+		HalTwi::Receive(Current.Length > 1);
+		break;
+	case TwiStatusEnum::ReadDataAck:
+		Current.Data[DataIndex++] = HalTwi::GetData();
+		// NACK the last byte.
+		HalTwi::Receive(DataIndex < (Current.Length - 1));
+		break;
+	case TwiStatusEnum::ReadDataNack:
+		Current.Data[DataIndex++] = HalTwi::GetData();
+		Complete(true);
+		break;
+	case TwiStatusEnum::ArbitrationLost:
+	case TwiStatusEnum::WriteAddressNack:
+	case TwiStatusEnum::WriteDataNack:
+	case TwiStatusEnum::ReadAddressNack:
+		Complete(false);
+		break;
+	case TwiStatusEnum::BusError:
+	default:
+		// Release the hardware with interrupts off, the task clears the bus.
+		HalTwi::Stop();
+		RecoverPending = true;
+		Task::forceNextIteration();
+		break;
+	}
+}
+
+// Task context only, busy waits for up to BusClearPulses SCL cycles.
+// Releases a stuck bus: resets the peripheral and clocks out a slave holding SDA low.
+inline void TwiDriver::Recover()
+{
+	noInterrupts();
+	HalTwi::Disable();
+	RecoverPending = false;
+	interrupts();
+
+	SdaPin::SetInputPullup();
+	SclPin::High();
+	SclPin::SetOutput();
+	for (uint8_t i = 0; i < BusClearPulses && !SdaPin::Read(); i++)
+	{
+		SclPin::Low();
+		delayMicroseconds(5);
+		SclPin::High();
+		delayMicroseconds(5);
+	}
+	SclPin::SetInputPullup();
+
+	HalTwi::Enable(ClockGovernor::GetTwiBitRate(ClockGovernor::GetCpuHz()));
+
+	noInterrupts();
+	if (!IsIdle())
+	{
+		// Fail the stuck transaction, the rest are kept.
+		Complete(false);
+	}
+	else
+	{
+		Phase = PhaseEnum::Idle;
+	}
+	interrupts();
+}
+
+// Interrupt glue, include this header only from the sketch.
+TwiDriver* StaticTwiDriverReference = nullptr;
+
+void TwiDriver::OnTwiInterrupt()
+{
+	StaticTwiDriverReference->OnInterrupt();
+}
+#endif
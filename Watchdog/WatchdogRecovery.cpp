@@ -0,0 +1,16 @@
+#if defined(__AVR__)
+#include "WatchdogRecovery.h"
+
+uint8_t ResetFlags __attribute__((section(".noinit")));
+RecoverySnapshot RecoveryState __attribute__((section(".noinit")));
+
+// Watchdog stays enabled after a watchdog reset, it must be disabled before setup() runs.
+void CaptureResetFlags(void) __attribute__((naked, used, section(".init3")));
+
+void CaptureResetFlags(void)
+{
+	ResetFlags = MCUSR;
+	MCUSR = 0;
+	wdt_disable();
+}
+#endif
@@ -0,0 +1,127 @@
+// WatchdogRecovery.h
+
+#ifndef _WATCHDOGRECOVERY_h
+#define _WATCHDOGRECOVERY_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/wdt.h>
+#include <util/crc16.h>
+
+// Reset cause, captured in .init3 before anything else runs (see WatchdogRecovery.cpp).
+extern uint8_t ResetFlags;
+
+// Alarm state snapshot, kept in .noinit so it survives watchdog and brown-out resets.
+// Timestamps are stored as elapsed periods, as millis() restarts from 0 after reset.
+// RAM is random after power-on, the magic word and CRC make an accidental match unlikely.
+struct RecoverySnapshot
+{
+	uint16_t Magic;
+	uint8_t State;
+	uint8_t Rung;
+	uint32_t RungElapsed;
+	uint16_t Crc;
+};
+
+extern RecoverySnapshot RecoveryState;
+
+class WatchdogRecovery
+{
+private:
+	static const uint16_t SnapshotMagic = 0x5AC3;
+	static const uint16_t CrcSeed = 0xFFFF;
+
+	// Longest blocking operation is the 1 second wait in SetupError().
+	static const uint8_t Timeout = WDTO_2S;
+
+public:
+	WatchdogRecovery()
+	{
+	}
+
+	bool Setup()
+	{
+		// Watchdog also covers the remaining setup, a hanging I2C bus will reset the device.
+		Enable();
+
+		return true;
+	}
+
+	void Enable()
+	{
+		wdt_enable(Timeout);
+	}
+
+	void Kick()
+	{
+		wdt_reset();
+	}
+
+	// Proper reset of all peripherals, unlike jumping to address 0.
+	void Reset()
+	{
+		wdt_enable(WDTO_15MS);
+		while (true)
+		{
+		}
+	}
+
+	bool WasWatchdogReset()
+	{
+		return ResetFlags & _BV(WDRF);
+	}
+
+	bool WasBrownOutReset()
+	{
+		return ResetFlags & _BV(BORF);
+	}
+
+	void Save(const uint8_t state, const uint8_t rung, const uint32_t rungElapsed)
+	{
+		RecoveryState.Magic = SnapshotMagic;
+		RecoveryState.State = state;
+		RecoveryState.Rung = rung;
+		RecoveryState.RungElapsed = rungElapsed;
+		RecoveryState.Crc = GetCrc();
+	}
+
+	// Only restores after a watchdog or brown-out reset, with a valid snapshot.
+	// Brown-out can be flagged along with power-on, RAM is not kept then.
+	bool Restore(uint8_t& state, uint8_t& rung, uint32_t& rungElapsed)
+	{
+		if ((WasWatchdogReset() || WasBrownOutReset())
+			&& !(ResetFlags & _BV(PORF))
+			&& RecoveryState.Magic == SnapshotMagic
+			&& RecoveryState.Crc == GetCrc())
+		{
+			state = RecoveryState.State;
+			rung = RecoveryState.Rung;
+			rungElapsed = RecoveryState.RungElapsed;
+
+			return true;
+		}
+		else
+		{
+			// Never trusted later either.
+			RecoveryState.Magic = 0;
+
+			return false;
+		}
+	}
+
+private:
+	// CRC-16/CCITT over everything before the CRC, magic included.
+	uint16_t GetCrc()
+	{
+		const uint8_t* Data = (const uint8_t*)&RecoveryState;
+		uint16_t Crc = CrcSeed;
+
+		for (uint8_t i = 0; i < offsetof(RecoverySnapshot, Crc); i++)
+		{
+			Crc = _crc_ccitt_update(Crc, Data[i]);
+		}
+
+		return Crc;
+	}
+};
+#endif